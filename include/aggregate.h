@@ -0,0 +1,91 @@
+#ifndef AGGREGATE_H
+#define AGGREGATE_H
+
+#include "types.h"
+#include "column_store.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace InMemoryDB {
+
+enum class AggregateFunction { NONE, COUNT, SUM, AVG, MIN, MAX };
+
+// One entry of a SELECT list: a plain column, or an aggregate over one.
+// COUNT(*) has an empty column name.
+struct SelectItem {
+    AggregateFunction function = AggregateFunction::NONE;
+    std::string column;
+
+    std::string label() const;  // e.g. "SUM(price)"
+};
+
+// Running state of one aggregate in one group
+struct AggregateState {
+    int64_t count = 0;  // non-NULL inputs, or rows for COUNT(*)
+    int64_t int_sum = 0;
+    double double_sum = 0;
+    Value extreme;  // MIN or MAX so far
+};
+
+// Groups of one worker. A slot holds the upper half of a group's hash and
+// its index plus one (0 is empty), so a probe stays within the slot array
+// until a fingerprint matches. Keys and states are flat, group-major.
+struct GroupTable {
+    std::vector<uint64_t> slots;
+    std::vector<uint64_t> hashes;  // per group
+    std::vector<Value> keys;
+    std::vector<AggregateState> states;
+    std::vector<std::vector<uint32_t>> partitions;  // group indexes, filled for the merge
+
+    size_t size() const { return hashes.size(); }
+};
+
+// Hash aggregation over a table's column vectors. Each worker
+// pre-aggregates the rows it is handed into a table of its own; finish()
+// then splits every worker's groups into partitions by hash and merges
+// the partitions in parallel.
+class HashAggregator {
+private:
+    struct Aggregate {
+        AggregateFunction function;
+        int column;  // -1 for COUNT(*)
+    };
+    struct Output {
+        bool is_key;
+        size_t index;  // into group_columns_ or aggregates_
+    };
+
+    const std::vector<ColumnVector>& data_;
+    std::vector<int> group_columns_;
+    std::vector<Aggregate> aggregates_;
+    std::vector<Output> outputs_;
+    std::vector<Column> result_columns_;
+    std::vector<GroupTable> tables_;  // per worker
+
+    size_t findGroup(GroupTable& table, uint64_t hash, size_t position) const;
+    void update(GroupTable& table, const size_t* positions, const uint32_t* groups, size_t count) const;
+    void mergeState(AggregateState& into, const AggregateState& from, AggregateFunction function) const;
+    void emit(const GroupTable& table, std::vector<Row>& rows) const;
+
+public:
+    explicit HashAggregator(const std::vector<ColumnVector>& data) : data_(data) {}
+
+    // Resolves the select list and GROUP BY columns; every plain column
+    // must be grouped on
+    bool bind(const std::vector<Column>& columns, const std::vector<SelectItem>& items,
+              const std::vector<std::string>& group_by, std::string& error);
+
+    void start(size_t workers);
+
+    // Adds the rows at positions to worker's groups
+    void consume(size_t worker, const size_t* positions, size_t count);
+
+    // Merges the workers' groups and fills result's columns and rows
+    void finish(size_t parallelism, QueryResult& result);
+};
+
+}
+
+#endif
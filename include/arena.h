@@ -0,0 +1,85 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace InMemoryDB {
+
+// Bump allocator for memory that lives no longer than one statement:
+// tokens of uncached statements and parser scratch. Deallocation is a
+// no-op; reset() rewinds to the first block but keeps every block, so a
+// session whose statements fit in what it already holds stops touching
+// the global heap. Each session owns one (see Session::arena).
+class QueryArena : public std::pmr::memory_resource {
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    static constexpr size_t kFirstBlock = 16 << 10;
+
+    std::vector<Block> blocks_;
+    size_t block_;             // block being filled
+    size_t offset_;            // bytes used in it
+    size_t used_;              // bytes handed out since reset()
+    size_t peak_;              // largest used_ seen at a reset()
+    size_t heap_allocations_;  // blocks taken from the global heap, ever
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+public:
+    QueryArena() : block_(0), offset_(0), used_(0), peak_(0), heap_allocations_(0) {}
+    QueryArena(const QueryArena&) = delete;
+    QueryArena& operator=(const QueryArena&) = delete;
+
+    void reset();
+
+    size_t used() const { return used_; }
+    size_t peak() const { return used_ > peak_ ? used_ : peak_; }
+    size_t capacity() const;
+    size_t heapAllocations() const { return heap_allocations_; }
+};
+
+// Global heap use by the calling thread since it started, counted by the
+// replacement operator new. Only this thread's counters are touched, so
+// counting adds no contention.
+struct HeapCounters {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+
+    static HeapCounters thread();
+};
+
+// Heap use of one top-level statement
+struct StatementAllocations {
+    uint64_t heap_allocations = 0;
+    uint64_t heap_bytes = 0;
+    size_t arena_bytes = 0;
+};
+
+// Brackets one top-level statement. The outermost scope on a thread
+// rewinds the session's arena on entry and, on exit, records what the
+// statement allocated in Session::last_statement. Nested scopes (EXECUTE
+// running a prepared statement) do nothing.
+class StatementScope {
+private:
+    bool outermost_;
+    HeapCounters start_;
+
+public:
+    StatementScope();
+    ~StatementScope();
+    StatementScope(const StatementScope&) = delete;
+    StatementScope& operator=(const StatementScope&) = delete;
+};
+
+}
+
+#endif
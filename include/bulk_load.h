@@ -0,0 +1,33 @@
+#ifndef BULK_LOAD_H
+#define BULK_LOAD_H
+
+#include "table.h"
+#include <memory>
+#include <string>
+
+namespace InMemoryDB {
+
+enum class CopyFormat { CSV, BINARY };
+
+struct CopyOptions {
+    CopyFormat format = CopyFormat::CSV;
+    bool header = false;   // CSV: the first line holds column names
+    char delimiter = ',';  // CSV only
+};
+
+// COPY table FROM path. The file is mapped and cut into chunks that are
+// parsed in parallel straight into column vectors, then appended in file
+// order with one table lock per chunk. In CSV an empty field is NULL (a
+// quoted "" is the empty string), and a quoted field may span lines;
+// chunks are cut only at line breaks outside quotes.
+// If the load fails, the rows it already added to txn are rolled back.
+bool copyFrom(Table& table, const std::string& path, const CopyOptions& options,
+              Transaction* txn, size_t& rows, std::string& error);
+
+// COPY table TO path: writes the rows txn sees, or every committed row
+bool copyTo(Table& table, const std::string& path, const CopyOptions& options,
+            std::shared_ptr<Transaction> txn, size_t& rows, std::string& error);
+
+}
+
+#endif
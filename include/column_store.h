@@ -0,0 +1,294 @@
+#ifndef COLUMN_STORE_H
+#define COLUMN_STORE_H
+
+#include "types.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace InMemoryDB {
+
+// Packed bit vector used for validity masks and boolean columns
+class Bitmap {
+private:
+    std::vector<uint64_t> words_;
+    size_t size_;
+
+public:
+    Bitmap() : size_(0) {}
+
+    void push_back(bool bit) {
+        if ((size_ & 63) == 0) words_.push_back(0);
+        if (bit) words_[size_ >> 6] |= uint64_t(1) << (size_ & 63);
+        size_++;
+    }
+
+    bool get(size_t i) const { return (words_[i >> 6] >> (i & 63)) & 1; }
+
+    void set(size_t i, bool bit) {
+        if (bit) {
+            words_[i >> 6] |= uint64_t(1) << (i & 63);
+        } else {
+            words_[i >> 6] &= ~(uint64_t(1) << (i & 63));
+        }
+    }
+
+    void clear() { words_.clear(); size_ = 0; }
+    void resize(size_t n) {
+        words_.resize((n + 63) / 64);
+        size_ = n;
+        if (n & 63) words_.back() &= (uint64_t(1) << (n & 63)) - 1;
+    }
+    void reserve(size_t n) { words_.reserve((n + 63) / 64); }
+    void append(const Bitmap& other) {
+        size_t shift = size_ & 63;
+        size_t other_words = (other.size_ + 63) / 64;
+        if (shift == 0) {
+            words_.insert(words_.end(), other.words_.begin(), other.words_.begin() + other_words);
+        } else {
+            for (size_t w = 0; w < other_words; ++w) {
+                words_.back() |= other.words_[w] << shift;
+                words_.push_back(other.words_[w] >> (64 - shift));
+            }
+        }
+        resize(size_ + other.size_);
+    }
+    void assign(const uint64_t* words, size_t n) {
+        words_.assign(words, words + (n + 63) / 64);
+        size_ = n;
+    }
+    size_t size() const { return size_; }
+    const uint64_t* words() const { return words_.data(); }
+};
+
+// Location of a string inside a block's string heap
+struct StringRef {
+    uint64_t offset;
+    uint32_t length;
+};
+
+// Integer and string columns are stored in blocks of this many rows (a
+// multiple of the scan batch size), each encoded on its own
+constexpr size_t kBlockShift = 14;
+constexpr size_t kBlockRows = size_t(1) << kBlockShift;
+constexpr size_t kBlockMask = kBlockRows - 1;
+
+enum class Encoding : uint8_t { PLAIN, RLE, BITPACK, DICTIONARY };
+constexpr size_t kEncodingCount = 4;
+
+const char* encodingName(Encoding encoding);
+
+// Fixed-width unsigned integers packed back to back into 64-bit words
+class PackedInts {
+private:
+    std::vector<uint64_t> words_;
+    unsigned width_ = 0;
+
+public:
+    static unsigned widthFor(uint32_t max_value);
+
+    void pack(const uint32_t* values, size_t n, unsigned width);
+    void clear() { words_.clear(); words_.shrink_to_fit(); width_ = 0; }
+
+    uint32_t get(size_t i) const {
+        if (width_ == 0) return 0;
+        size_t bit = i * width_;
+        size_t word = bit >> 6;
+        unsigned shift = bit & 63;
+        uint64_t value = words_[word] >> shift;
+        if (shift + width_ > 64) value |= words_[word + 1] << (64 - shift);
+        return static_cast<uint32_t>(value & ((uint64_t(1) << width_) - 1));
+    }
+    void unpack(size_t start, size_t count, uint32_t* out) const;
+
+    unsigned width() const { return width_; }
+    size_t bytes() const { return words_.size() * sizeof(uint64_t); }
+};
+
+// One block of an integer or string column. A block is appended to in
+// PLAIN form; once full it is encoded with whichever of the encodings
+// below is smallest (or left PLAIN if none helps):
+//   RLE         integers; run i repeats run_values[i] up to row run_ends[i]
+//   BITPACK     integers; row i is base + codes[i] (frame of reference)
+//   DICTIONARY  strings; row i is dictionary[codes[i]], and the dictionary
+//               is sorted so that codes compare like the strings do
+// NULL slots repeat the previous row's value so they cost nothing to
+// encode; the column's validity bitmap says which rows are NULL.
+struct ColumnBlock {
+    Encoding encoding = Encoding::PLAIN;
+    bool settled = false;  // full, and its encoding chosen
+
+    std::vector<int32_t> ints;        // PLAIN integers
+    std::vector<StringRef> strings;   // PLAIN strings, or the dictionary
+    std::string heap;                 // bytes of strings
+
+    std::vector<int32_t> run_values;
+    std::vector<uint32_t> run_ends;
+    int32_t base = 0;
+    PackedInts codes;
+
+    size_t bytes() const;
+};
+
+// Summary of one column over one block of rows, used to skip blocks a
+// predicate cannot match. Numbers (and booleans, as 0 and 1) use min/max,
+// strings min_string/max_string; the bounds mean nothing while
+// value_count is 0. Bounds only widen as rows are written, and deletes
+// leave them alone, until compaction recomputes them.
+struct ZoneMap {
+    size_t null_count = 0;
+    size_t value_count = 0;  // non-NULL rows
+    double min = 0.0;
+    double max = 0.0;
+    std::string min_string;
+    std::string max_string;
+
+    void add(double value) {
+        if (value_count++ == 0) {
+            min = max = value;
+        } else {
+            min = std::min(min, value);
+            max = std::max(max, value);
+        }
+    }
+    void add(std::string_view value) {
+        if (value_count++ == 0) {
+            min_string = max_string = value;
+        } else if (value < min_string) {
+            min_string = value;
+        } else if (value > max_string) {
+            max_string = value;
+        }
+    }
+};
+
+// Storage summary of one column, for SHOW STORAGE
+struct ColumnStorage {
+    size_t blocks[kEncodingCount] = {};  // by Encoding
+    size_t bytes = 0;                    // as stored
+    size_t plain_bytes = 0;              // if every block were PLAIN
+};
+
+// Typed storage for a single table column. Integers and strings live in
+// encoded blocks; doubles are a contiguous array and booleans a bitmap.
+// NULLs are tracked in a separate validity bitmap.
+class ColumnVector {
+private:
+    DataType type_;
+    size_t size_;
+    std::vector<ColumnBlock> blocks_;  // INTEGER and STRING columns
+    std::vector<ZoneMap> zones_;       // one per kBlockRows rows, every type
+    std::vector<double> doubles_;
+    Bitmap bools_;
+    Bitmap validity_;
+
+public:
+    explicit ColumnVector(DataType type);
+
+    DataType type() const { return type_; }
+    size_t size() const { return size_; }
+
+    // True if value can be stored in this column (after coercion)
+    bool accepts(const Value& value) const;
+
+    // Callers must check accepts() first
+    void append(const Value& value);
+
+    // Typed appends for loaders that parse straight into a column; each
+    // must match the column's type
+    void appendNull();
+    void appendInt(int32_t value) { pushInt(value); validity_.push_back(true); }
+    void appendDouble(double value) { pushDouble(value); validity_.push_back(true); }
+    void appendBool(bool value) { pushBool(value); validity_.push_back(true); }
+    void appendString(std::string_view value) { pushString(value); validity_.push_back(true); }
+
+    // Appends field `column` of every row, dispatching on the column type
+    // once for the whole batch; callers must check accepts() for each value
+    void appendColumn(const Row* rows, size_t count, size_t column);
+
+    // Appends every row of other, which must have the same type
+    void appendFrom(const ColumnVector& other);
+
+    // Writing to an encoded block decodes it; it stays PLAIN until the
+    // next compress()
+    void set(size_t row, const Value& value);
+    Value get(size_t row) const;
+
+    bool isNull(size_t row) const { return !validity_.get(row); }
+
+    // Used by compaction: copy a row to a lower position, drop the tail,
+    // reclaim string bytes no longer referenced by any row, re-encode
+    // blocks that were decoded for writing, and tighten zone maps
+    void moveRow(size_t from, size_t to);
+    void truncate(size_t n);
+    void compactHeap();
+    void compress();
+    void refreshZones();
+    void reserve(size_t n);
+
+    // Replaces the contents with n rows copied from raw arrays, as stored
+    // in a snapshot. values holds n ints, doubles or StringRefs into heap;
+    // for booleans it holds bitmap words. False if a string lies outside
+    // heap.
+    bool load(size_t n, const void* values, const uint64_t* validity, const char* heap, size_t heap_bytes);
+
+    ColumnStorage storage() const;
+
+    size_t blockCount() const { return zones_.size(); }
+    const ZoneMap& zone(size_t block) const { return zones_[block]; }
+
+    // Access for scan kernels. Rows [start, start + kBatchSize) with start
+    // a multiple of kBatchSize always lie in one block.
+    const ColumnBlock& blockOf(size_t row) const { return blocks_[row >> kBlockShift]; }
+    const double* doubleData() const { return doubles_.data(); }
+    const Bitmap& boolData() const { return bools_; }
+    const Bitmap& validity() const { return validity_; }
+    int32_t intAt(size_t row) const;
+    std::string_view stringAt(size_t row) const;
+
+private:
+    ColumnBlock& appendBlock();
+    ZoneMap& appendZone();
+    void finishAppend();
+    void pushInt(int32_t value);
+    void pushDouble(double value);
+    void pushBool(bool value);
+    void pushString(std::string_view value);
+    void pushNull();
+    void pushFrom(const ColumnVector& other, size_t row);
+    void retire(size_t row);
+    void cover(size_t row);
+    void rebuildZone(size_t block);
+    void encodeBlock(ColumnBlock& block);
+    void decodeBlock(ColumnBlock& block);
+    ColumnBlock& writableBlock(size_t row);
+    static StringRef appendToHeap(ColumnBlock& block, std::string_view s);
+};
+
+inline int32_t ColumnVector::intAt(size_t row) const {
+    const ColumnBlock& block = blockOf(row);
+    size_t offset = row & kBlockMask;
+    switch (block.encoding) {
+        case Encoding::BITPACK:
+            return static_cast<int32_t>(static_cast<uint32_t>(block.base) + block.codes.get(offset));
+        case Encoding::RLE: {
+            auto run = std::upper_bound(block.run_ends.begin(), block.run_ends.end(), offset);
+            return block.run_values[run - block.run_ends.begin()];
+        }
+        default:
+            return block.ints[offset];
+    }
+}
+
+inline std::string_view ColumnVector::stringAt(size_t row) const {
+    const ColumnBlock& block = blockOf(row);
+    size_t offset = row & kBlockMask;
+    const StringRef& ref = block.strings[block.encoding == Encoding::DICTIONARY ? block.codes.get(offset) : offset];
+    return std::string_view(block.heap.data() + ref.offset, ref.length);
+}
+
+}
+
+#endif
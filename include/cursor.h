@@ -0,0 +1,88 @@
+#ifndef CURSOR_H
+#define CURSOR_H
+
+#include "types.h"
+#include "predicate.h"
+#include "transaction.h"
+#include "explain.h"
+#include <memory>
+#include <vector>
+
+namespace InMemoryDB {
+
+class Table;
+
+// A batch of result rows. The rows vector is reused between calls to
+// next(), so only the first `size` entries are valid. Sequential cursors
+// return up to kBatchSize rows per batch, parallel ones up to kMorselSize.
+struct RowBatch {
+    std::vector<Row> rows;
+    size_t size = 0;
+};
+
+// Pull-based result stream
+class ResultCursor {
+public:
+    virtual ~ResultCursor() = default;
+    virtual const std::vector<Column>& columns() const = 0;
+
+    // Fills batch with the next rows; returns false once exhausted. A
+    // batch may be empty when no rows in the examined range matched.
+    virtual bool next(RowBatch& batch) = 0;
+};
+
+// Passes on the first limit rows of another cursor
+class LimitCursor : public ResultCursor {
+private:
+    std::shared_ptr<ResultCursor> input_;
+    size_t remaining_;
+
+public:
+    LimitCursor(std::shared_ptr<ResultCursor> input, size_t limit) : input_(std::move(input)), remaining_(limit) {}
+
+    const std::vector<Column>& columns() const override { return input_->columns(); }
+    bool next(RowBatch& batch) override;
+};
+
+// Streams a table scan a batch at a time. The table lock is only held,
+// shared, inside next(), while one batch (or, with parallelism > 1, one
+// morsel) is filtered and copied out. The cursor keeps the table alive.
+//
+// The cursor pins the table, which stops compaction from moving rows, so
+// row positions stay stable for its lifetime. Given a transaction it reads
+// that transaction's snapshot. Without one it sees the committed rows that
+// existed when it was opened; rows deleted since then are skipped and
+// in-place updates are visible.
+class TableCursor : public ResultCursor {
+private:
+    std::shared_ptr<Table> table_;
+    std::vector<Column> columns_;
+    std::vector<int> column_indices_;
+    std::unique_ptr<Predicate> where_;
+    std::shared_ptr<Transaction> txn_;  // keeps the snapshot registered
+    ReadView view_;
+
+    size_t position_;              // next row position to examine
+    size_t end_;                   // row count when the cursor was opened
+    bool use_candidates_;          // rows come from an index probe
+    std::vector<size_t> candidates_;
+    std::vector<size_t> selected_;     // scratch for the positions in one batch
+    PlanNode* access_;                 // profiled under EXPLAIN ANALYZE, or null
+
+    void fill(Row& row, size_t position) const;
+    void emit(RowBatch& batch, size_t position);
+    bool fetch(RowBatch& batch);
+
+public:
+    // Created through Table::openCursor(), which holds the table lock
+    TableCursor(std::shared_ptr<Table> table, std::vector<int> column_indices, std::unique_ptr<Predicate> where,
+                std::shared_ptr<Transaction> txn, PlanNode* access = nullptr);
+    ~TableCursor() override;
+
+    const std::vector<Column>& columns() const override { return columns_; }
+    bool next(RowBatch& batch) override;
+};
+
+}
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef EXPLAIN_H
+#define EXPLAIN_H
+
+#include "types.h"
+#include "profile.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace InMemoryDB {
+
+// A node of the plan EXPLAIN prints. Each operator describes itself with
+// one before it runs (see Table::explainAccess and HashJoin::explain);
+// under EXPLAIN ANALYZE it then runs charging the node's profile, and
+// relabels the node if it decided something else at run time.
+struct PlanNode {
+    std::string label;
+    double estimated_rows;  // negative without statistics
+    OperatorProfile profile;
+    std::vector<std::unique_ptr<PlanNode>> children;
+
+    explicit PlanNode(std::string label, double estimated_rows = -1)
+        : label(std::move(label)), estimated_rows(estimated_rows) {}
+
+    PlanNode* child(size_t i) const { return children[i].get(); }
+
+    // The child's profile charges what no scope covers on up to this one
+    void add(std::unique_ptr<PlanNode> child) {
+        child->profile.parent = &profile;
+        children.push_back(std::move(child));
+    }
+};
+
+// A new node with child under it
+std::unique_ptr<PlanNode> wrapPlan(std::string label, std::unique_ptr<PlanNode> child, double estimated_rows = -1);
+
+// One row per node, each child indented under its parent; analyzed adds
+// what each operator measured
+QueryResult explainResult(const PlanNode& root, bool analyzed);
+
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace InMemoryDB {
+
+// Hashing shared by the aggregation and join operators. Keys are hashed
+// from their native column representation, so equal keys hash equally
+// whichever operator or column they come from.
+
+constexpr uint64_t kHashSeed = 0x9e3779b97f4a7c15ull;
+constexpr uint64_t kNullHash = 0x6a09e667f3bcc909ull;
+
+// Final mixer of MurmurHash3; every input bit affects every output bit
+inline uint64_t mixHash(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+inline uint64_t combineHash(uint64_t hash, uint64_t value) {
+    return mixHash(hash ^ (value + kHashSeed + (hash << 6) + (hash >> 2)));
+}
+
+inline uint64_t hashDouble(double value) {
+    if (value == 0) {
+        value = 0;  // -0.0 equals 0.0
+    }
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// FNV-1a
+inline uint64_t hashString(std::string_view value) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : value) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef INDEX_H
+#define INDEX_H
+
+#include "types.h"
+#include "column_store.h"
+#include <memory>
+#include <vector>
+
+namespace InMemoryDB {
+
+// Row ids stored under one index key. The first few ids live inline so
+// that unique and low-duplicate keys never touch the heap.
+class RowIdList {
+private:
+    static constexpr uint32_t kInline = 3;
+    uint32_t size_;
+    int inline_[kInline];
+    std::vector<int> overflow_;
+
+public:
+    RowIdList() : size_(0) {}
+
+    void add(int row_id);
+    bool remove(int row_id);
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    int operator[](size_t i) const { return i < kInline ? inline_[i] : overflow_[i - kInline]; }
+
+    void appendTo(std::vector<int>& out) const {
+        for (size_t i = 0; i < size_; ++i) out.push_back((*this)[i]);
+    }
+};
+
+enum class IndexType { HASH, BTREE };
+
+// One end of a key range; a null value means the range is unbounded
+struct KeyBound {
+    const Value* value;
+    bool inclusive;
+};
+
+class Index {
+public:
+    virtual ~Index() = default;
+    virtual IndexType type() const = 0;
+    virtual void insert(const Value& key, int row_id) = 0;
+    virtual void remove(const Value& key, int row_id) = 0;
+    virtual std::vector<int> find(const Value& key) = 0;
+    virtual std::vector<int> findRange(const Value& start, const Value& end) = 0;
+
+    // Append matching row ids to out without allocating for the probe itself
+    virtual void findInto(const Value& key, std::vector<int>& out) const = 0;
+
+    // Append row ids in key order; false if the index cannot serve the range
+    virtual bool findRangeInto(const KeyBound& low, const KeyBound& high, std::vector<int>& out) const = 0;
+
+    // Index every non-NULL row of column that is not deleted; row_ids maps
+    // positions to row ids
+    virtual void build(const ColumnVector& column, const std::vector<int>& row_ids, const Bitmap& deleted) = 0;
+    virtual void clear() = 0;
+};
+
+// Open-addressing hash index keyed on the column's native type
+std::unique_ptr<Index> createHashIndex(DataType key_type);
+
+// B+tree index keyed on the column's native type; serves ranges
+std::unique_ptr<Index> createTreeIndex(DataType key_type);
+
+}
+
+#endif
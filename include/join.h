@@ -0,0 +1,86 @@
+#ifndef JOIN_H
+#define JOIN_H
+
+#include "table.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace InMemoryDB {
+
+enum class JoinType { INNER, LEFT };
+
+// SELECT over left [LEFT] JOIN right ON left.key = right.key. Each table
+// is known by its alias, or else its name; a column both tables have
+// must be qualified as name.column.
+//
+// WHERE conjuncts are pushed down to the table they refer to. If one side
+// is small and the other has an index on its key, the small side's rows
+// are looked up in the index (with statistics, an inner join filters the
+// side expected to be smaller first, so the other need not be scanned);
+// otherwise both sides are radix-partitioned on the key's hash so that
+// each partition's build table fits in L2, and the partitions are joined
+// in parallel. Rows come back in no particular order.
+class HashJoin {
+private:
+    struct Side {
+        std::shared_ptr<Table> table;
+        std::string name;
+        int key = -1;
+        std::unique_ptr<Predicate> where;  // conjuncts on this table only
+    };
+    struct Output {
+        bool right;
+        int column;
+    };
+    // A row of one input with the hash of its key
+    struct Entry {
+        uint64_t hash;
+        size_t position;
+    };
+    // Positions of a joined row; the right one is kNoRow for a left row
+    // without a match
+    using Match = std::pair<size_t, size_t>;
+    static constexpr size_t kNoRow = SIZE_MAX;
+
+    JoinType type_;
+    Side left_;
+    Side right_;
+    std::vector<Output> outputs_;
+    std::vector<Column> result_columns_;
+
+    bool resolve(const std::string& name, bool& right, int& column, std::string& error) const;
+    std::pair<std::shared_lock<std::shared_mutex>, std::shared_lock<std::shared_mutex>> lockTables() const;
+    bool rightFirst() const;
+    bool indexable(size_t outer_rows, const Side& inner) const;
+    std::string label(const Side* index_outer) const;
+    void indexJoin(const Side& outer, const std::vector<size_t>& outer_rows, const Side& inner,
+                   const ReadView& view, std::vector<Match>& matches) const;
+    void partition(const Side& side, const std::vector<size_t>& rows, size_t bits, std::vector<Entry>& entries,
+                   std::vector<size_t>& offsets, std::vector<size_t>* null_rows) const;
+    void hashJoin(const std::vector<size_t>& left_rows, const std::vector<size_t>& right_rows,
+                  std::vector<Match>& matches) const;
+
+public:
+    HashJoin(JoinType type, std::shared_ptr<Table> left, const std::string& left_name,
+             std::shared_ptr<Table> right, const std::string& right_name);
+
+    // Resolves the ON columns, the select list (empty for *) and the WHERE
+    // clause, whose conjuncts may each refer to one table only
+    bool bind(const std::string& left_key, const std::string& right_key, const std::vector<std::string>& columns,
+              std::unique_ptr<Predicate> where, std::string& error);
+
+    // EXPLAIN: the join with the access node of each table under it, left
+    // first. Under EXPLAIN ANALYZE, execute() is given it and profiles
+    // into it; a table looked up through its index is never scanned.
+    std::unique_ptr<PlanNode> explain() const;
+    QueryResult execute(const ReadView& view, PlanNode* plan = nullptr) const;
+};
+
+}
+
+#endif
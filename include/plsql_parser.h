@@ -2,64 +2,110 @@
 #define PLSQL_PARSER_H
 
 #include "types.h"
+#include "predicate.h"
+#include "transaction.h"
+#include "aggregate.h"
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace InMemoryDB {
 
 enum class TokenType {
-    SELECT, INSERT, UPDATE, DELETE, CREATE, DROP, TABLE,
-    FROM, WHERE, INTO, VALUES, SET,
-    IDENTIFIER, NUMBER, STRING_LITERAL,
-    SEMICOLON, COMMA, LPAREN, RPAREN,
+    SELECT, INSERT, UPDATE, DELETE, CREATE, DROP, TABLE, INDEX, ON, USING,
+    FROM, WHERE, GROUP, BY, ORDER, ASC, DESC, LIMIT, JOIN, INNER, LEFT, OUTER, INTO, VALUES, SET,
+    BEGIN, COMMIT, ROLLBACK, CHECKPOINT, COPY,
+    PREPARE, EXECUTE, DEALLOCATE, SHOW, ANALYZE, EXPLAIN,
+    IDENTIFIER, NUMBER, STRING_LITERAL, PARAMETER,
+    SEMICOLON, COMMA, LPAREN, RPAREN, STAR, MINUS,
     EQ, NE, LT, GT, LE, GE,
-    AND, OR, NOT,
+    AND, OR, NOT, BETWEEN,
     END_OF_FILE, INVALID
 };
 
+// A token's value is a view into the text it was lexed from (a string
+// literal's without its quotes), so that text must outlive the token
 struct Token {
     TokenType type;
-    std::string value;
+    std::string_view value;
     size_t position;
+    
+    std::string text() const { return std::string(value); }
 };
 
+// Token vectors of cached plans use the global heap; those of one-off
+// statements come from the session's arena
+using TokenList = std::pmr::vector<Token>;
+
+// Lexes on demand: each next() scans one token without allocating
 class PLSQLLexer {
 private:
-    std::string input_;
+    std::string_view input_;
     size_t position_;
     
 public:
-    PLSQLLexer(const std::string& input);
-    std::vector<Token> tokenize();
+    // input must outlive the lexer and its tokens
+    explicit PLSQLLexer(std::string_view input);
+    
+    Token next();  // END_OF_FILE once the input is exhausted
+    TokenList tokenize(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
     
 private:
-    char currentChar();
-    void advance();
     void skipWhitespace();
+    Token make(TokenType type, size_t start);
     Token readString();
     Token readNumber();
     Token readIdentifier();
+    Token readParameter();
 };
 
 class PLSQLParser {
 private:
-    std::vector<Token> tokens_;
+    const TokenList& tokens_;
     size_t current_;
+    const Row* parameters_;  // values of $1 .. $n, if any
+    enum class ExplainMode { NONE, PLAN, ANALYZE } explain_;
     
 public:
-    PLSQLParser(const std::vector<Token>& tokens);
+    // tokens, and parameters, must outlive the parser
+    PLSQLParser(const TokenList& tokens, const Row* parameters = nullptr);
     QueryResult parse();
     
 private:
-    Token currentToken();
+    const Token& currentToken() const;
     void advance();
     bool match(TokenType type);
+    bool expectEnd(std::string& error);
+    bool parseLiteral(Value& value);
+    std::unique_ptr<Predicate> parseOr(std::string& error);
+    std::unique_ptr<Predicate> parseAnd(std::string& error);
+    std::unique_ptr<Predicate> parseNot(std::string& error);
+    std::unique_ptr<Predicate> parseComparison(std::string& error);
+    bool parseSelectItem(SelectItem& item, std::string& error);
     QueryResult parseSelect();
     QueryResult parseInsert();
     QueryResult parseUpdate();
     QueryResult parseDelete();
     QueryResult parseCreate();
+    QueryResult parseCreateIndex();
     QueryResult parseDrop();
+    QueryResult parseDropIndex();
+    QueryResult parseSet();
+    QueryResult parseTransaction();
+    QueryResult parseCheckpoint();
+    QueryResult parseCopy();
+    QueryResult parsePrepare();
+    QueryResult parseExecute();
+    QueryResult parseDeallocate();
+    QueryResult parseShow();
+    QueryResult showStorage();
+    QueryResult showStatistics();
+    QueryResult parseAnalyze();
+    QueryResult parseExplain();
+    bool beginStatement(std::shared_ptr<Transaction>& txn, QueryResult& result);
+    void finishStatement(Transaction& txn, QueryResult& result);
 };
 
 }
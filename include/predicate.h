@@ -0,0 +1,93 @@
+#ifndef PREDICATE_H
+#define PREDICATE_H
+
+#include "types.h"
+#include "column_store.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace InMemoryDB {
+
+// Rows are filtered in batches of this many rows (a multiple of 64)
+constexpr size_t kBatchSize = 1024;
+constexpr size_t kBatchWords = kBatchSize / 64;
+static_assert(kBlockRows % kBatchSize == 0, "a batch must not span column blocks");
+
+// Parallel scans hand out work in morsels of this many rows
+constexpr size_t kMorselSize = 64 * kBatchSize;
+
+enum class CompareOp { EQ, NE, LT, LE, GT, GE };
+
+// Selection bitmaps for one batch. SQL three-valued logic is kept as two
+// masks: rows where the predicate is definitely true and definitely false.
+// Rows in neither are UNKNOWN (a NULL was involved).
+struct BatchMask {
+    uint64_t is_true[kBatchWords];
+    uint64_t is_false[kBatchWords];
+};
+
+// WHERE clause tree built by the parser. bind() resolves column names to
+// column offsets and coerces literals once; evaluate() then runs typed
+// compare kernels over a batch of rows.
+class Predicate {
+public:
+    enum class Kind { COMPARE, AND, OR, NOT };
+
+    static std::unique_ptr<Predicate> compare(const std::string& column, CompareOp op, const Value& literal);
+    static std::unique_ptr<Predicate> logical(Kind kind, std::unique_ptr<Predicate> left,
+                                              std::unique_ptr<Predicate> right = nullptr);
+
+    Kind kind() const { return kind_; }
+    const std::string& columnName() const { return column_name_; }
+    int columnIndex() const { return column_index_; }
+    CompareOp op() const { return op_; }
+    const Value& literal() const { return literal_; }
+    const std::vector<std::unique_ptr<Predicate>>& children() const { return children_; }
+
+    // Takes the conjuncts of an AND tree apart; any other node is one conjunct
+    static void splitConjuncts(std::unique_ptr<Predicate> where, std::vector<std::unique_ptr<Predicate>>& out);
+
+    // A column may be qualified as table.column, where table is the name
+    // the statement gives the table
+    bool bind(const std::vector<Column>& columns, std::string& error, const std::string& table = "");
+
+    // Evaluate rows [start, start + count); start must be a multiple of
+    // kBatchSize and count <= kBatchSize
+    void evaluate(const std::vector<ColumnVector>& data, size_t start, size_t count, BatchMask& mask) const;
+
+    // False if the zone maps of block prove that no row in it is true
+    bool mayMatch(const std::vector<ColumnVector>& data, size_t block) const { return mayMatch(data, block, false); }
+
+    // Evaluate a single row; true only if the predicate is definitely true
+    bool matches(const std::vector<ColumnVector>& data, size_t row) const { return evaluateRow(data, row) > 0; }
+
+    // SQL text of the predicate, as EXPLAIN shows it
+    std::string toString() const;
+
+private:
+    Kind kind_;
+    std::string column_name_;
+    int column_index_;
+    CompareOp op_;
+    Value literal_;
+    std::vector<std::unique_ptr<Predicate>> children_;
+
+    Predicate(Kind kind) : kind_(kind), column_index_(-1), op_(CompareOp::EQ) {}
+    void evaluateCompare(const ColumnVector& column, size_t start, size_t count, BatchMask& mask) const;
+    int evaluateRow(const std::vector<ColumnVector>& data, size_t row) const;  // 1 true, 0 false, -1 unknown
+    bool mayMatch(const std::vector<ColumnVector>& data, size_t block, bool negate) const;
+};
+
+// Flip a comparison so that "literal op column" becomes "column op' literal"
+CompareOp reverseCompareOp(CompareOp op);
+
+const char* compareOpName(CompareOp op);  // e.g. ">="
+
+// A literal as SQL would spell it
+std::string literalText(const Value& value);
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef PREPARED_STATEMENT_H
+#define PREPARED_STATEMENT_H
+
+#include "plsql_parser.h"
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace InMemoryDB {
+
+// A statement lexed and checked once and then executed any number of
+// times, with values bound to its $1 .. $n placeholders. The parser
+// executes as it parses, so the plan is the token stream: executing skips
+// lexing and token copies, and a placeholder reads its bound value
+// directly. Plans are immutable and may be shared between sessions.
+class PreparedStatement {
+private:
+    std::string sql_;
+    TokenList tokens_;  // views into sql_
+    size_t parameter_count_;
+
+public:
+    explicit PreparedStatement(std::string sql);
+    PreparedStatement(const PreparedStatement&) = delete;
+    PreparedStatement& operator=(const PreparedStatement&) = delete;
+
+    // Null, with error set, if the text is empty or a placeholder is $0
+    static std::shared_ptr<const PreparedStatement> prepare(std::string sql, std::string& error);
+
+    size_t parameterCount() const { return parameter_count_; }
+
+    // parameters[i] is bound to $(i + 1)
+    QueryResult execute(const Row& parameters = {}) const;
+};
+
+// Process-wide LRU cache of plans keyed on normalized SQL text (runs of
+// whitespace outside string literals collapsed), so repeats of an ad-hoc
+// statement are lexed only once. In a query or DML statement the literals
+// are replaced by placeholders too, so statements differing only in
+// their literals share a plan. A trailing ';' stays in the key, for the
+// parser to accept only one.
+class PlanCache {
+private:
+    using Entry = std::pair<std::string, std::shared_ptr<const PreparedStatement>>;
+
+    std::mutex mutex_;
+    std::list<Entry> lru_;  // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> entries_;
+    size_t capacity_;
+
+    void evict();
+
+public:
+    explicit PlanCache(size_t capacity) : capacity_(capacity) {}
+
+    static PlanCache& instance();
+    // With literals, also replaces each literal by the next $n and appends
+    // its value there, if the statement is a query or DML
+    static std::string normalize(const std::string& sql, Row* literals = nullptr);
+
+    // Returns the cached plan for sql, preparing and caching it on a miss;
+    // it is to be executed with literals, the values taken out of sql
+    std::shared_ptr<const PreparedStatement> get(const std::string& sql, Row& literals, std::string& error);
+
+    void setCapacity(size_t capacity);  // 0 disables caching
+    size_t capacity();
+    size_t size();
+};
+
+// Runs one SQL statement, through the plan cache
+QueryResult executeSql(const std::string& sql);
+
+}
+
+#endif
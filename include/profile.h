@@ -0,0 +1,65 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
+
+namespace InMemoryDB {
+
+// What one operator did under EXPLAIN ANALYZE. Wall time, heap bytes and
+// lock waits include those of the operators it runs; rows are its own.
+// Helpers that run an operator's parallelFor tasks charge it too, and an
+// operator entered by several workers at once adds up their wall times.
+struct OperatorProfile {
+    OperatorProfile* parent = nullptr;  // the operator this one feeds
+    std::atomic<uint64_t> loops{0};  // times the operator was entered
+    std::atomic<uint64_t> wall_ns{0};
+    std::atomic<uint64_t> rows_in{0};
+    std::atomic<uint64_t> rows_out{0};
+    std::atomic<uint64_t> heap_bytes{0};
+    std::atomic<uint64_t> lock_wait_ns{0};
+};
+
+// The profile charged on this thread; null unless EXPLAIN ANALYZE runs
+OperatorProfile* currentProfile();
+
+// Makes profile current on this thread while in scope, and charges it the
+// wall time and heap bytes in between. A null or already current profile
+// does nothing, so operators can open a scope unconditionally.
+class ProfileScope {
+private:
+    OperatorProfile* profile_;
+    OperatorProfile* previous_;
+    uint64_t start_ns_;
+    uint64_t start_bytes_;
+
+public:
+    explicit ProfileScope(OperatorProfile* profile);
+    ~ProfileScope();
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+// Runs a pool task on behalf of profile: it becomes current on the helper
+// thread and is charged the heap bytes the task allocates
+class ProfileTask {
+private:
+    OperatorProfile* profile_;
+    OperatorProfile* previous_;
+    uint64_t start_bytes_;
+
+public:
+    explicit ProfileTask(OperatorProfile* profile);
+    ~ProfileTask();
+    ProfileTask(const ProfileTask&) = delete;
+    ProfileTask& operator=(const ProfileTask&) = delete;
+};
+
+// Takes mutex shared. If it is held exclusively, the wait is charged to
+// the current profile; the uncontended path is one try_lock.
+std::shared_lock<std::shared_mutex> sharedLock(std::shared_mutex& mutex);
+
+}
+
+#endif
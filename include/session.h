@@ -0,0 +1,35 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "transaction.h"
+#include "arena.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace InMemoryDB {
+
+class PreparedStatement;
+
+// Per-session settings, changed with SET name = value. Each client thread
+// has its own session.
+struct Session {
+    size_t parallelism;  // threads a single query may use
+    std::shared_ptr<Transaction> transaction;  // set between BEGIN and COMMIT/ROLLBACK
+    std::unordered_map<std::string, std::shared_ptr<const PreparedStatement>> prepared;  // by PREPARE name
+    QueryArena arena;  // statement-lifetime allocations, rewound per statement
+    StatementAllocations last_statement;  // shown by SHOW ALLOCATIONS
+
+    Session() : parallelism(std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1) {}
+
+    static Session& current() {
+        thread_local Session session;
+        return session;
+    }
+};
+
+}
+
+#endif
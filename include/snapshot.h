@@ -0,0 +1,81 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace InMemoryDB {
+
+// Checkpoint files are laid out to be mapped. A 64-byte header (magic,
+// version, table count, log position, body size and CRC-32) is followed by
+// per-table sections whose arrays start on 8-byte boundaries. Loading
+// copies each column out of the mapping a storage block at a time and
+// encodes every full block once, rather than inserting row by row.
+constexpr uint32_t kSnapshotVersion = 1;
+
+class SnapshotWriter {
+private:
+    std::FILE* file_;
+    std::string path_;
+    uint64_t size_;  // body bytes written so far
+    uint32_t crc_;
+    int error_;      // errno of the first failed write, 0 if none
+
+public:
+    SnapshotWriter() : file_(nullptr), size_(0), crc_(0), error_(0) {}
+    ~SnapshotWriter();
+
+    bool open(const std::string& path, std::string& error);
+
+    void write(const void* data, size_t size);
+    void putU8(uint8_t value) { write(&value, 1); }
+    void putU32(uint32_t value) { write(&value, 4); }
+    void putU64(uint64_t value) { write(&value, 8); }
+    void putString(const std::string& value);
+    void align();  // pad to the next 8-byte boundary
+
+    // Writes the header and makes the file durable. log_lsn is the first
+    // log record not covered by the snapshot. Fails, removing the file, if
+    // any earlier write did.
+    bool finish(uint32_t table_count, uint64_t log_lsn, std::string& error);
+};
+
+// Maps a snapshot and reads it back. Reads past the end return zero values
+// or null arrays and clear ok().
+class SnapshotReader {
+private:
+    void* map_;
+    size_t map_size_;
+    const char* pos_;
+    const char* end_;
+    bool ok_;
+    uint32_t table_count_;
+    uint64_t log_lsn_;
+
+    bool take(size_t size);
+
+public:
+    SnapshotReader() : map_(nullptr), map_size_(0), pos_(nullptr), end_(nullptr), ok_(false),
+                       table_count_(0), log_lsn_(0) {}
+    ~SnapshotReader();
+
+    // Maps path and verifies its header and checksum
+    bool open(const std::string& path, std::string& error);
+
+    uint32_t tableCount() const { return table_count_; }
+    uint64_t logLsn() const { return log_lsn_; }
+
+    uint8_t getU8();
+    uint32_t getU32();
+    uint64_t getU64();
+    std::string getString();
+    const void* getArray(size_t size);  // points into the mapping
+    void align();
+
+    bool ok() const { return ok_; }
+};
+
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef SORT_H
+#define SORT_H
+
+#include "types.h"
+#include "column_store.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace InMemoryDB {
+
+// One ORDER BY item
+struct SortKey {
+    std::string column;
+    bool descending = false;
+};
+
+constexpr size_t kNoLimit = SIZE_MAX;
+
+// Normalized sort keys: each ORDER BY column is appended in an encoding
+// under which memcmp of whole keys orders rows as ORDER BY does. NULLs
+// sort last ascending and first descending.
+void appendSortKey(const Value& value, bool descending, std::string& out);
+void appendSortKey(const ColumnVector& column, size_t row, bool descending, std::string& out);
+
+// Orders the indexes 0 .. count - 1 by the keys key(i, out) appends, ties
+// in index order, and keeps the first limit. A limit much smaller than
+// count is served by a bounded heap per worker, so only limit keys are
+// kept; otherwise all keys are built and merge-sorted in parallel.
+std::vector<size_t> sortIndexes(size_t count, const std::function<void(size_t, std::string&)>& key, size_t limit,
+                                size_t parallelism);
+
+// ORDER BY and LIMIT over materialized rows; order names result columns
+bool sortRows(QueryResult& result, const std::vector<SortKey>& order, size_t limit, size_t parallelism,
+              std::string& error);
+
+}
+
+#endif
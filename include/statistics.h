@@ -0,0 +1,101 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include "types.h"
+#include "column_store.h"
+#include "predicate.h"
+#include "index.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace InMemoryDB {
+
+// Distinct-count sketch. A hash's top kBits pick one of 2^kBits registers,
+// which keeps the longest run of leading zeros seen in the remaining bits;
+// the estimate is off by about 1.6% whatever the count.
+class HyperLogLog {
+public:
+    static constexpr unsigned kBits = 12;
+    static constexpr size_t kRegisters = size_t(1) << kBits;
+
+    HyperLogLog() { registers_.fill(0); }
+
+    void add(uint64_t hash) {
+        uint64_t rest = hash << kBits;
+        uint8_t rank = rest ? static_cast<uint8_t>(__builtin_clzll(rest) + 1) : 64 - kBits + 1;
+        uint8_t& reg = registers_[hash >> (64 - kBits)];
+        if (rank > reg) reg = rank;
+    }
+    double estimate() const;
+
+private:
+    std::array<uint8_t, kRegisters> registers_;
+};
+
+// What ANALYZE knows about one column's live rows. Non-NULL values are
+// reservoir-sampled; the equi-depth histogram's bounds are taken from the
+// sorted sample, so each of its buckets holds about as many rows.
+struct ColumnStatistics {
+    static constexpr size_t kSampleSize = 30000;
+    static constexpr size_t kHistogramBuckets = 100;
+
+    size_t rows = 0;
+    size_t nulls = 0;
+    HyperLogLog distinct;
+    std::vector<Value> sample;
+    size_t sampled = 0;         // non-NULL values offered to the sample
+    std::vector<Value> bounds;  // bucket i spans bounds[i] .. bounds[i + 1]
+
+    // Adds the given rows of column; finish() then rebuilds the histogram
+    void add(const ColumnVector& column, const std::vector<size_t>& positions);
+    void finish();
+
+    double nullFraction() const { return rows ? static_cast<double>(nulls) / rows : 0.0; }
+    double distinctCount() const;
+
+    // Fraction of rows for which "column op literal" is true; the literal
+    // must already be coerced to the column's type, as bind() does
+    double selectivity(CompareOp op, const Value& literal) const;
+    double rangeSelectivity(const KeyBound& low, const KeyBound& high) const;
+
+private:
+    double equalFraction(const Value& literal) const;  // of non-NULL rows
+    double belowFraction(const Value& literal) const;  // of non-NULL rows
+};
+
+// Statistics of one table, published whole by ANALYZE. positions is how
+// far into the table ANALYZE got; later rows are added by the next
+// ANALYZE, unless rows were updated, deleted or moved since (rewrites
+// differs), which rebuilds everything.
+struct TableStatistics {
+    size_t rows = 0;
+    size_t positions = 0;
+    uint64_t modifications = 0;  // the table's counters when analyzed
+    uint64_t rewrites = 0;
+    std::vector<ColumnStatistics> columns;
+
+    // Fraction of rows a bound predicate is expected to match; conjuncts
+    // and disjuncts are taken to be independent
+    double selectivity(const Predicate* where) const;
+};
+
+enum class AccessMethod { SCAN, HASH_INDEX, BTREE_INDEX };
+
+// One way to produce the rows a WHERE clause may match. An index access
+// is a superset that the full predicate is rechecked on.
+struct AccessPlan {
+    AccessMethod method = AccessMethod::SCAN;
+    int column = -1;
+    KeyBound low{nullptr, true};  // a hash index probes low only
+    KeyBound high{nullptr, true};
+    double rows = -1;  // estimated rows produced; negative without statistics
+    double cost = 0;
+};
+
+const char* accessMethodName(AccessMethod method);
+
+}
+
+#endif
@@ -3,31 +3,92 @@
 
 #include "types.h"
 #include "table.h"
+#include "transaction.h"
+#include "wal.h"
+#include "snapshot.h"
 #include <unordered_map>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
 
 namespace InMemoryDB {
 
 class StorageEngine {
 private:
-    std::unordered_map<std::string, std::unique_ptr<Table>> tables_;
-    mutable std::mutex mutex_;
+    // The catalog is copy-on-write: lookups load the current snapshot
+    // without taking a lock, and DDL publishes a modified copy. Tables are
+    // shared, so a dropped table lives until its last user lets go.
+    using Catalog = std::unordered_map<std::string, std::shared_ptr<Table>>;
+    std::shared_ptr<const Catalog> catalog_;
+    std::mutex ddl_mutex_;  // serializes catalog writers
+
+    std::shared_ptr<const Catalog> snapshot() const { return std::atomic_load(&catalog_); }
+    void publish(std::shared_ptr<const Catalog> catalog) { std::atomic_store(&catalog_, std::move(catalog)); }
+
+    // Background compactor; reclaims deleted rows once a table's dead-row
+    // ratio reaches compaction_threshold_, and refreshes the statistics of
+    // analyzed tables once statistics_threshold_ of their rows were written
+    std::atomic<double> compaction_threshold_;
+    std::atomic<double> statistics_threshold_;
+    std::thread compactor_;
+    std::mutex compactor_mutex_;
+    std::condition_variable compactor_cv_;
+    std::atomic<bool> stopping_;
+    
+    WriteAheadLog wal_;
+    TransactionManager transactions_;
+    
+    void compactorLoop();
+    void logDDL(WalRecordType type, const WalWriter& record);
+    bool loadSnapshot(SnapshotReader& in, std::string& error);
+    void replay(WalRecordType type, WalReader& record,
+                std::unordered_map<std::string, std::unordered_map<RowId, RowId>>& row_ids);
+    void compactTable(const std::string& name);
+    void refreshStatistics(const std::string& name);
 
 public:
-    StorageEngine() = default;
-    ~StorageEngine() = default;
+    StorageEngine();
+    ~StorageEngine();
 
     // Table operations
     bool createTable(const std::string& name, const std::vector<Column>& columns);
     bool dropTable(const std::string& name);
-    Table* getTable(const std::string& name);
+    std::shared_ptr<Table> getTable(const std::string& name) const;
     std::vector<std::string> getTableNames() const;
 
-    // Transaction support
-    void beginTransaction();
-    void commit();
-    void rollback();
+    // Index operations; index names are unique across all tables
+    bool createIndex(const std::string& index_name, const std::string& table_name,
+                     const std::string& column_name, IndexType type);
+    bool dropIndex(const std::string& index_name);
+
+    // Compaction settings; a threshold of 1.0 or more disables it
+    void setCompactionThreshold(double dead_ratio) { compaction_threshold_ = dead_ratio; }
+    double getCompactionThreshold() const { return compaction_threshold_; }
+    void wakeCompactor() { compactor_cv_.notify_one(); }
+    
+    // Statistics of a table that has been analyzed are refreshed in the
+    // background once this fraction of its rows has been written
+    void setStatisticsThreshold(double fraction) { statistics_threshold_ = fraction; }
+    double getStatisticsThreshold() const { return statistics_threshold_; }
+
+    // Durability. openLog() replays the log at path, then logs every
+    // committed write and DDL statement to it; call it before any other
+    // statement runs.
+    bool openLog(const std::string& path, Durability durability, std::string& error);
+    
+    // Writes a snapshot of every table next to the log (<log>.snapshot)
+    // and drops the log records it covers. Commits continue meanwhile;
+    // DDL waits.
+    bool checkpoint(std::string& error);
+    WriteAheadLog& log() { return wal_; }
+    
+    // Transactions; old row versions are garbage-collected by the
+    // compactor once no running transaction can see them
+    std::shared_ptr<Transaction> beginTransaction() { return transactions_.begin(); }
+    bool commit(Transaction& txn, std::string& error) { return transactions_.commit(txn, error); }
+    void rollback(Transaction& txn) { transactions_.rollback(txn); }
 };
 
 }
@@ -2,40 +2,206 @@
 #define TABLE_H
 
 #include "types.h"
+#include "column_store.h"
+#include "predicate.h"
+#include "index.h"
+#include "cursor.h"
+#include "transaction.h"
+#include "wal.h"
+#include "snapshot.h"
+#include "aggregate.h"
+#include "sort.h"
+#include "statistics.h"
+#include "explain.h"
+#include <cstdint>
 #include <vector>
 #include <memory>
+#include <atomic>
 #include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 
 namespace InMemoryDB {
 
-class Table {
+// Readers (scans, cursors, index lookups) share the table lock; writers
+// and compaction take it exclusively. Tables are owned by shared_ptr so
+// that a cursor keeps its table alive after DROP TABLE.
+class Table : public std::enable_shared_from_this<Table> {
+    friend class TableCursor;
+    friend class HashJoin;
+
 private:
     std::string name_;
     std::vector<Column> columns_;
-    std::vector<Row> rows_;
-    mutable std::mutex mutex_;
+    std::vector<ColumnVector> data_;  // one typed vector per column
+    size_t row_count_;                // physical rows, including deleted ones
+    
+    // Deleted rows stay in place, marked here, until compaction reclaims them
+    Bitmap deleted_;
+    size_t dead_count_;
+    
+    // Incremental compaction state. Live rows from compact_read_ onwards are
+    // slid down to compact_write_; everything in between is marked deleted.
+    bool compacting_;
+    size_t compact_read_;
+    size_t compact_write_;
+    
+    // Open cursors; compaction waits while any are open
+    std::atomic<size_t> pin_count_;
+    
+    // Version timestamps per position (see transaction.h). Rows written
+    // outside a transaction begin at 0 and are visible to every snapshot.
+    std::vector<uint64_t> begin_ts_;
+    std::vector<uint64_t> end_ts_;
+    size_t ended_versions_;  // committed ended versions not yet collected
+    
+    // Slot map: row ids are handed out once and never reused. A deleted
+    // row's slot keeps kTombstone so stale ids resolve to nothing.
+    static constexpr uint32_t kTombstone = UINT32_MAX;
+    std::vector<RowId> row_ids_;   // position -> row id
+    std::vector<uint32_t> slots_;  // row id -> position
+    
+    std::vector<std::unique_ptr<Index>> indexes_;  // per column, null if not indexed
+    std::vector<std::string> index_names_;
+    mutable std::shared_mutex mutex_;
+    
+    // Statistics from the last ANALYZE, replaced whole. modifications_
+    // counts rows written; rewrites_ counts writes that change, end or move
+    // rows already written, which ANALYZE cannot just add to what it has.
+    std::shared_ptr<const TableStatistics> statistics_;
+    uint64_t modifications_;
+    uint64_t rewrites_;
+
+    int findColumn(const std::string& column_name) const;
+    bool accepts(const Row& row) const;
+    bool acceptsValues(const std::vector<int>& column_indices, const Row& values) const;
+    bool resolveColumns(const std::vector<std::string>& column_names, std::vector<int>& indices) const;
+    QueryResult scan(const std::vector<std::string>& column_names, const Predicate* where);
+    // Given an access node (see explainAccess), these profile the read
+    // into it and relabel it with the way the rows were actually read
+    void filterPositions(const Predicate* where, const ReadView& view, std::vector<size_t>& positions,
+                         PlanNode* access = nullptr) const;
+    bool filterByIndex(const Predicate* where, const ReadView& view, std::vector<size_t>& positions,
+                       PlanNode* access = nullptr) const;
+    void scanPositions(const Predicate* where, const ReadView& view, std::vector<size_t>& positions) const;
+    void filterRange(const Predicate* where, const ReadView& view, size_t begin, size_t end,
+                     std::vector<size_t>& positions) const;
+    bool visible(const ReadView& view, size_t position) const {
+        return view.visible(begin_ts_[position], end_ts_[position]);
+    }
+    void appendRow(const Row& row, uint64_t begin_ts);
+    void appendSlots(size_t count, Transaction* txn);  // bookkeeping for rows just appended to data_
+    bool endVersions(const std::vector<size_t>& positions, Transaction& txn);
+    std::vector<AccessPlan> planAccess(const Predicate* where) const;
+    bool probeIndexes(const Predicate* where, std::vector<int>& candidates, AccessPlan* used = nullptr) const;
+    double estimateRows(const Predicate* where) const;  // negative without statistics
+    std::string accessLabel(const AccessPlan& plan, const Predicate* where) const;
+    std::unique_ptr<PlanNode> accessNode(const Predicate* where) const;
+    void positionsOf(const std::vector<RowId>& row_ids, std::vector<size_t>& positions) const;
+    bool updatePositions(const std::vector<size_t>& positions, const std::vector<int>& column_indices,
+                         const Row& new_values);
+    void deletePositions(std::vector<size_t>& positions);
 
 public:
     Table(const std::string& name, const std::vector<Column>& columns);
     ~Table() = default;
 
-    // Data operations
-    bool insert(const Row& row);
-    bool update(const std::vector<int>& row_indices, const Row& new_values);
-    bool deleteRows(const std::vector<int>& row_indices);
+    // Data operations. Without a transaction, writes apply immediately and
+    // in place; with one, they create row versions that become visible when
+    // it commits. An update then ends the old version and appends a new one
+    // under a new row id.
+    bool insert(const Row& row, Transaction* txn = nullptr);
+    
+    // Bulk inserts under a single lock. Every row is validated before any
+    // is added, so a batch goes in whole or not at all. insertColumns takes
+    // one vector per table column, all of the same length.
+    bool insertBatch(const Row* rows, size_t count, Transaction* txn = nullptr);
+    bool insertBatch(const std::vector<Row>& rows, Transaction* txn = nullptr) {
+        return insertBatch(rows.data(), rows.size(), txn);
+    }
+    bool insertColumns(const std::vector<ColumnVector>& columns, Transaction* txn = nullptr);
+    bool update(const std::vector<RowId>& row_ids, const Row& new_values);
+    bool update(const std::vector<RowId>& row_ids, const std::vector<std::string>& column_names,
+                const Row& new_values);
+    bool deleteRows(const std::vector<RowId>& row_ids);
+    
+    // Filter and modify under a single lock; a null predicate matches every
+    // row. These fail, and doom txn, on a write-write conflict.
+    bool updateWhere(const Predicate* where, const std::vector<std::string>& column_names,
+                     const Row& new_values, size_t& affected, Transaction* txn = nullptr);
+    bool deleteWhere(const Predicate* where, size_t& affected, Transaction* txn = nullptr);
     
     // Query operations
     QueryResult select(const std::vector<std::string>& column_names = {});
-    QueryResult selectWhere(const std::string& condition);
+    QueryResult selectWhere(const Predicate& where, const std::vector<std::string>& column_names = {});
+    std::vector<RowId> findRows(const Predicate* where) const;
+    
+    // SELECT ... ORDER BY over the rows view sees that satisfy where
+    // (already bound), cut to limit rows; only the rows returned are copied
+    QueryResult selectOrdered(const std::vector<std::string>& column_names, const Predicate* where,
+                              const ReadView& view, const std::vector<SortKey>& order, size_t limit,
+                              PlanNode* plan = nullptr) const;
+    
+    // SELECT with aggregates and/or GROUP BY over the rows view sees that
+    // satisfy where (already bound); groups come back in no particular order
+    QueryResult aggregate(const std::vector<SelectItem>& items, const std::vector<std::string>& group_by,
+                          const Predicate* where, const ReadView& view, PlanNode* plan = nullptr) const;
+    
+    // Streaming scan; the cursor owns the (already bound) predicate and
+    // keeps txn, whose snapshot it reads, alive
+    std::unique_ptr<ResultCursor> openCursor(const std::vector<std::string>& column_names,
+                                             std::unique_ptr<Predicate> where = nullptr,
+                                             std::shared_ptr<Transaction> txn = nullptr,
+                                             PlanNode* access = nullptr);
+    
+    // EXPLAIN: the node for reading the rows where (already bound) matches,
+    // the way the calls above would read them. Under EXPLAIN ANALYZE they
+    // are given it (selectOrdered and aggregate as the child of their own
+    // node) and profile into it.
+    std::unique_ptr<PlanNode> explainAccess(const Predicate* where) const;
     
     // Metadata
     const std::string& getName() const { return name_; }
     const std::vector<Column>& getColumns() const { return columns_; }
-    size_t getRowCount() const { return rows_.size(); }
+    size_t getRowCount() const { return row_count_ - dead_count_; }
+    double deadRatio() const;
+    std::vector<ColumnStorage> storage() const;  // per column
+    
+    // Statistics. analyze() adds the rows appended since the last ANALYZE,
+    // or starts over if earlier rows changed; the statistics are stale once
+    // the rows written since exceed fraction of the rows analyzed.
+    void analyze();
+    std::shared_ptr<const TableStatistics> statistics() const { return std::atomic_load(&statistics_); }
+    bool statisticsStale(double fraction) const;
     
     // Index operations
-    void createIndex(const std::string& column_name);
-    void dropIndex(const std::string& column_name);
+    bool createIndex(const std::string& column_name, IndexType type = IndexType::HASH,
+                     const std::string& index_name = "");
+    bool dropIndex(const std::string& column_name);
+    bool hasIndex(const std::string& column_name) const;
+    std::string indexedColumn(const std::string& index_name) const;  // empty if no such index
+    
+    // Called by the transaction manager; a commit_ts of 0 rolls back
+    void finishWrites(const TableWrites& writes, uint64_t marker, uint64_t commit_ts);
+    
+    // Write-ahead logging of a transaction's committed writes, and replay
+    // of them at startup; ids maps logged row ids to replayed ones
+    void encodeWrites(const TableWrites& writes, WalWriter& out) const;
+    bool replayWrites(WalReader& in, std::unordered_map<RowId, RowId>& ids);
+    
+    // Checkpoints: write the rows view sees, with their row ids and the
+    // table's index definitions, or load them into this (empty) table
+    void writeSnapshot(SnapshotWriter& out, const ReadView& view) const;
+    bool loadSnapshot(SnapshotReader& in);
+    
+    // Marks versions that ended at or before oldest_snapshot deleted, so
+    // compaction can reclaim them; returns how many were collected
+    size_t collectGarbage(uint64_t oldest_snapshot);
+    
+    // Compaction. Each step holds the table lock for at most max_rows row
+    // moves; returns true while more work remains.
+    bool compactStep(size_t max_rows);
+    void compact();
 };
 
 }
@@ -0,0 +1,53 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace InMemoryDB {
+
+// Process-wide work-stealing thread pool. Each worker owns a deque: it
+// takes jobs from the back of its own deque and steals from the front of
+// the others when it runs dry.
+class ThreadPool {
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    std::atomic<size_t> pending_;
+    std::atomic<size_t> next_queue_;
+    bool stopping_;
+
+    bool tryPop(size_t self, std::function<void()>& job);
+    void workerLoop(size_t self);
+
+public:
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+
+    static ThreadPool& instance();
+    size_t size() const { return workers_.size(); }
+
+    void submit(std::function<void()> job);
+
+    // Runs body(0) .. body(count - 1) on up to parallelism threads, the
+    // caller included, and returns once all have finished. Tasks are
+    // claimed dynamically, so uneven tasks balance themselves.
+    void parallelFor(size_t count, size_t parallelism, const std::function<void(size_t)>& body);
+};
+
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef TRANSACTION_H
+#define TRANSACTION_H
+
+#include "types.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace InMemoryDB {
+
+class Table;
+class TransactionManager;
+class WriteAheadLog;
+
+// Every row version carries begin/end timestamps. Commit timestamps count
+// up from 1; a version written by a transaction that has not committed yet
+// carries that transaction's marker (high bit set) instead, which is
+// larger than any snapshot.
+constexpr uint64_t kUncommitted = uint64_t(1) << 63;
+constexpr uint64_t kInfinity = UINT64_MAX;              // end of a live version
+constexpr uint64_t kLatestSnapshot = kUncommitted - 1;  // sees everything committed
+
+// What one reader can see: versions committed at or before snapshot, plus
+// the reader's own uncommitted writes
+struct ReadView {
+    uint64_t snapshot = kLatestSnapshot;
+    uint64_t marker = 0;
+
+    bool visible(uint64_t begin, uint64_t end) const {
+        return (begin <= snapshot || begin == marker) && !(end <= snapshot || end == marker);
+    }
+};
+
+// Versions a transaction created and ended in one table, by row id
+struct TableWrites {
+    std::shared_ptr<Table> table;
+    std::vector<RowId> inserted;
+    std::vector<RowId> deleted;
+};
+
+// A snapshot-isolated transaction. It is used by one thread at a time; a
+// transaction destroyed while still active is rolled back.
+class Transaction {
+    friend class TransactionManager;
+
+private:
+    TransactionManager* manager_;
+    uint64_t id_;
+    uint64_t snapshot_;
+    bool active_;
+    bool doomed_;  // hit a write-write conflict; can only roll back
+    std::unordered_map<Table*, TableWrites> writes_;
+
+public:
+    Transaction(TransactionManager* manager, uint64_t id, uint64_t snapshot);
+    ~Transaction();
+
+    uint64_t marker() const { return kUncommitted | id_; }
+    uint64_t snapshot() const { return snapshot_; }
+    ReadView view() const { return ReadView{snapshot_, marker()}; }
+
+    bool active() const { return active_; }
+    bool doomed() const { return doomed_; }
+    void doom() { doomed_ = true; }
+
+    TableWrites& writesFor(const std::shared_ptr<Table>& table);
+};
+
+// Hands out snapshots and commit timestamps. Commits are published one at
+// a time, so a snapshot never sees half of a commit.
+class TransactionManager {
+private:
+    std::atomic<uint64_t> last_commit_;
+    std::atomic<uint64_t> next_id_;
+    mutable std::mutex mutex_;         // guards active_
+    std::multiset<uint64_t> active_;   // snapshots of running transactions
+    std::mutex commit_mutex_;
+    WriteAheadLog* wal_;  // null when commits are not logged
+
+    void finish(Transaction& txn);
+
+public:
+    TransactionManager();
+
+    // Committed writes are logged to wal once it is open
+    void setLog(WriteAheadLog* wal) { wal_ = wal; }
+
+    std::shared_ptr<Transaction> begin();
+
+    // Begins a transaction between two commits and reports the log
+    // position its snapshot corresponds to
+    std::shared_ptr<Transaction> beginAtLogPosition(uint64_t& lsn);
+    bool commit(Transaction& txn, std::string& error);
+    void rollback(Transaction& txn);
+
+    // Versions that ended at or before this timestamp are invisible to
+    // every running transaction and can be garbage-collected
+    uint64_t oldestSnapshot() const;
+};
+
+}
+
+#endif
@@ -1,17 +1,18 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+#include <cstdint>
+#include <cstring>
+#include <ostream>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <variant>
 #include <memory>
 #include <unordered_map>
 
 namespace InMemoryDB {
 
 // Data types
-using Value = std::variant<int, double, std::string, bool>;
-
 enum class DataType {
     INTEGER,
     DOUBLE,
@@ -19,6 +20,141 @@ enum class DataType {
     BOOLEAN
 };
 
+// A 16-byte tagged value: NULL, a 64-bit integer, a double, a boolean or a
+// string. Strings of up to 14 bytes are stored inline; longer ones live in
+// a heap buffer the value owns. Tables do not store Values (see
+// ColumnVector); they are what rows, literals and results are made of.
+class Value {
+public:
+    enum class Kind : uint8_t { NUL, INTEGER, DOUBLE, STRING, BOOLEAN };
+
+private:
+    static constexpr size_t kInlineCapacity = 14;
+    static constexpr uint8_t kLongString = 0xFF;
+
+    // Inline string bytes; or the number; or, for a long string, its
+    // buffer pointer followed by its 32-bit length
+    alignas(8) char data_[kInlineCapacity];
+    uint8_t length_;  // inline string length, or kLongString
+    Kind kind_;
+
+    template <typename T> T load(size_t offset = 0) const {
+        T value;
+        std::memcpy(&value, data_ + offset, sizeof(T));
+        return value;
+    }
+    template <typename T> void store(T value, size_t offset = 0) { std::memcpy(data_ + offset, &value, sizeof(T)); }
+
+    bool isLongString() const { return kind_ == Kind::STRING && length_ == kLongString; }
+    void assignString(std::string_view s);
+    void release() {
+        if (isLongString()) delete[] load<char*>();
+    }
+
+public:
+    // The payload is zeroed so that copying all of it never reads
+    // indeterminate bytes
+    Value() : data_{}, length_(0), kind_(Kind::NUL) {}
+    Value(int v) : data_{}, length_(0), kind_(Kind::INTEGER) { store<int64_t>(v); }
+    Value(int64_t v) : data_{}, length_(0), kind_(Kind::INTEGER) { store(v); }
+    Value(double v) : data_{}, length_(0), kind_(Kind::DOUBLE) { store(v); }
+    Value(bool v) : data_{}, length_(0), kind_(Kind::BOOLEAN) { store<uint8_t>(v); }
+    Value(std::string_view s) : data_{}, length_(0), kind_(Kind::NUL) { assignString(s); }
+    Value(const std::string& s) : Value(std::string_view(s)) {}
+    Value(const char* s) : Value(std::string_view(s)) {}
+
+    Value(const Value& other) : data_{}, length_(other.length_), kind_(other.kind_) {
+        if (other.isLongString()) {
+            assignString(other.asString());
+        } else {
+            std::memcpy(data_, other.data_, sizeof(data_));
+        }
+    }
+    Value(Value&& other) noexcept : length_(other.length_), kind_(other.kind_) {
+        std::memcpy(data_, other.data_, sizeof(data_));
+        other.kind_ = Kind::NUL;  // the buffer, if any, now belongs to this
+    }
+    Value& operator=(const Value& other) {
+        if (this != &other) {
+            Value copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+    Value& operator=(Value&& other) noexcept {
+        if (this != &other) {
+            release();
+            std::memcpy(data_, other.data_, sizeof(data_));
+            length_ = other.length_;
+            kind_ = other.kind_;
+            other.kind_ = Kind::NUL;
+        }
+        return *this;
+    }
+    ~Value() { release(); }
+
+    Kind kind() const { return kind_; }
+    bool isNull() const { return kind_ == Kind::NUL; }
+    bool isInt() const { return kind_ == Kind::INTEGER; }
+    bool isDouble() const { return kind_ == Kind::DOUBLE; }
+    bool isNumber() const { return kind_ == Kind::INTEGER || kind_ == Kind::DOUBLE; }
+    bool isString() const { return kind_ == Kind::STRING; }
+    bool isBool() const { return kind_ == Kind::BOOLEAN; }
+
+    // Accessors; each requires the matching kind (asDouble also takes an
+    // integer)
+    int64_t asInt() const { return load<int64_t>(); }
+    double asDouble() const { return kind_ == Kind::INTEGER ? static_cast<double>(asInt()) : load<double>(); }
+    bool asBool() const { return load<uint8_t>() != 0; }
+    std::string_view asString() const {
+        return isLongString() ? std::string_view(load<char*>(), load<uint32_t>(8))
+                              : std::string_view(data_, length_);
+    }
+
+    // Same kind and same contents; NULL equals NULL here
+    bool operator==(const Value& other) const;
+    bool operator!=(const Value& other) const { return !(*this == other); }
+};
+
+static_assert(sizeof(Value) == 16, "Value must stay 16 bytes");
+
+inline void Value::assignString(std::string_view s) {
+    kind_ = Kind::STRING;
+    if (s.size() <= kInlineCapacity) {
+        length_ = static_cast<uint8_t>(s.size());
+        if (!s.empty()) std::memcpy(data_, s.data(), s.size());
+        return;
+    }
+    char* buffer = new char[s.size()];
+    std::memcpy(buffer, s.data(), s.size());
+    length_ = kLongString;
+    store(buffer);
+    store(static_cast<uint32_t>(s.size()), 8);
+}
+
+inline bool Value::operator==(const Value& other) const {
+    if (kind_ != other.kind_) return false;
+    switch (kind_) {
+        case Kind::NUL: return true;
+        case Kind::INTEGER: return asInt() == other.asInt();
+        case Kind::DOUBLE: return asDouble() == other.asDouble();
+        case Kind::STRING: return asString() == other.asString();
+        case Kind::BOOLEAN: return asBool() == other.asBool();
+    }
+    return false;
+}
+
+inline std::ostream& operator<<(std::ostream& out, const Value& value) {
+    switch (value.kind()) {
+        case Value::Kind::NUL: return out << "NULL";
+        case Value::Kind::INTEGER: return out << value.asInt();
+        case Value::Kind::DOUBLE: return out << value.asDouble();
+        case Value::Kind::STRING: return out << value.asString();
+        case Value::Kind::BOOLEAN: return out << value.asBool();
+    }
+    return out;
+}
+
 // Column definition
 struct Column {
     std::string name;
@@ -33,14 +169,22 @@ struct Column {
 // Row data
 using Row = std::vector<Value>;
 
-// Query result
+// Stable identifier of a table row; unlike its position, it survives deletes
+using RowId = int;
+
+class ResultCursor;
+
+// Query result. A streaming SELECT leaves rows empty and sets cursor;
+// consumers then pull the rows batch by batch.
 struct QueryResult {
     std::vector<Column> columns;
     std::vector<Row> rows;
+    std::shared_ptr<ResultCursor> cursor;
     bool success;
     std::string error_message;
+    size_t rows_affected;
     
-    QueryResult() : success(false) {}
+    QueryResult() : success(false), rows_affected(0) {}
 };
 
 }
@@ -0,0 +1,128 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include "types.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace InMemoryDB {
+
+// OFF keeps no log. ASYNC acknowledges commits before their fsync; SYNC
+// waits for it, sharing one fsync among the commits of a group window.
+enum class Durability { OFF, ASYNC, SYNC };
+
+// CRC-32 (IEEE); pass a previous result as crc to continue a checksum
+uint32_t crc32(const char* data, size_t size, uint32_t crc = 0);
+
+// fsync the directory holding path, making a rename in it durable
+bool syncParentDirectory(const std::string& path);
+
+enum class WalRecordType : uint8_t { CREATE_TABLE = 1, DROP_TABLE, CREATE_INDEX, DROP_INDEX, COMMIT };
+
+// Little-endian encoder for record payloads
+class WalWriter {
+private:
+    std::string buffer_;
+
+public:
+    void putU8(uint8_t value) { buffer_.push_back(static_cast<char>(value)); }
+    void putU32(uint32_t value);
+    void putU64(uint64_t value);
+    void putString(std::string_view value);
+    void putValue(const Value& value);
+
+    const std::string& data() const { return buffer_; }
+};
+
+// Decoder matching WalWriter; it does not copy the data it reads. Reads
+// past the end return zero values and clear ok().
+class WalReader {
+private:
+    const char* data_;
+    size_t size_;
+    size_t pos_;
+    bool ok_;
+
+    bool take(size_t n);
+
+public:
+    WalReader(const char* data, size_t size) : data_(data), size_(size), pos_(0), ok_(true) {}
+    explicit WalReader(const std::string& data) : WalReader(data.data(), data.size()) {}
+
+    uint8_t getU8();
+    uint32_t getU32();
+    uint64_t getU64();
+    std::string getString();
+    Value getValue();
+
+    bool ok() const { return ok_; }
+};
+
+// Append-only write-ahead log. After a 16-byte header (magic, LSN of the
+// first record) records are framed as [length u32][crc32 u32][type u8]
+// [payload] and appended to an in-memory buffer; a flusher thread writes
+// and fsyncs whatever has accumulated, so concurrent committers share one
+// fsync. An LSN is a byte position in the log as if it had never been
+// truncated.
+class WriteAheadLog {
+private:
+    int fd_;
+    std::string path_;
+    std::atomic<Durability> durability_;
+    std::atomic<int64_t> group_window_us_;
+
+    std::mutex mutex_;
+    std::condition_variable flush_cv_;
+    std::condition_variable durable_cv_;
+    std::string buffer_;       // appended but not yet written
+    uint64_t base_lsn_;        // LSN of the first record in the file
+    uint64_t appended_lsn_;    // log size including buffer_
+    uint64_t durable_lsn_;     // log size known to be on disk
+    bool failed_;              // a write or fsync failed
+    bool stopping_;
+    std::thread flusher_;
+
+    void flusherLoop();
+
+public:
+    WriteAheadLog();
+    ~WriteAheadLog();
+
+    // Replays every intact record from start_lsn on through apply, then
+    // opens the log for appending. A torn or corrupt record ends the log
+    // and is cut off.
+    bool open(const std::string& path, Durability durability, uint64_t start_lsn,
+              const std::function<void(WalRecordType, WalReader&)>& apply, std::string& error);
+    bool isOpen() const { return fd_ >= 0; }
+
+    // Returns the record's log sequence number, to pass to waitDurable()
+    uint64_t append(WalRecordType type, const WalWriter& payload);
+
+    // Drops the records before lsn, once a checkpoint covers them
+    bool discardBefore(uint64_t lsn, std::string& error);
+
+    const std::string& path() const { return path_; }
+    uint64_t appendedLsn() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return appended_lsn_;
+    }
+
+    // Blocks until lsn is on disk; returns at once unless durability is
+    // SYNC. False if the log failed before lsn could be written.
+    bool waitDurable(uint64_t lsn);
+
+    void setDurability(Durability durability) { durability_ = durability; }
+    Durability durability() const { return durability_; }
+    void setGroupWindow(std::chrono::microseconds window) { group_window_us_ = window.count(); }
+};
+
+}
+
+#endif
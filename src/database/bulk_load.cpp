@@ -0,0 +1,535 @@
+#include "bulk_load.h"
+#include "session.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace InMemoryDB {
+
+namespace {
+
+constexpr size_t kChunkBytes = 4 << 20;      // CSV is parsed in chunks of about this size
+constexpr size_t kBinaryBlockRows = 65536;   // rows per block written by COPY TO ... BINARY
+constexpr char kCopyMagic[8] = {'I', 'M', 'D', 'B', 'C', 'O', 'P', 'Y'};
+constexpr uint32_t kCopyVersion = 1;
+
+// Read-only mapping of a whole file
+class MappedFile {
+private:
+    void* map_;
+    size_t size_;
+
+public:
+    MappedFile() : map_(nullptr), size_(0) {}
+    ~MappedFile() {
+        if (map_) {
+            ::munmap(map_, size_);
+        }
+    }
+
+    bool open(const std::string& path, std::string& error) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || ::fstat(fd, &st) != 0) {
+            error = "Cannot open '" + path + "': " + std::strerror(errno);
+            if (fd >= 0) ::close(fd);
+            return false;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            map_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map_ == MAP_FAILED) {
+                map_ = nullptr;
+            }
+        }
+        ::close(fd);
+        if (size_ > 0 && !map_) {
+            error = "Cannot map '" + path + "'";
+            return false;
+        }
+        if (map_) {
+            ::madvise(map_, size_, MADV_SEQUENTIAL);
+        }
+        return true;
+    }
+
+    const char* data() const { return static_cast<const char*>(map_); }
+    size_t size() const { return size_; }
+};
+
+// One chunk of the input, parsed into one vector per table column
+struct ParsedChunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    std::vector<ColumnVector> columns;
+    size_t lines = 0;  // CSV lines consumed, up to and including a bad one
+    std::string error;
+};
+
+const char* typeName(DataType type) {
+    switch (type) {
+        case DataType::INTEGER: return "INTEGER";
+        case DataType::DOUBLE: return "DOUBLE";
+        case DataType::STRING: return "STRING";
+        case DataType::BOOLEAN: return "BOOLEAN";
+    }
+    return "value";
+}
+
+bool equalsIgnoreCase(std::string_view a, const char* b) {
+    size_t n = std::strlen(b);
+    if (a.size() != n) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (std::toupper(static_cast<unsigned char>(a[i])) != b[i]) return false;
+    }
+    return true;
+}
+
+// An empty field is NULL, except that "" in a string column is the empty string
+bool appendField(ColumnVector& out, const Column& column, std::string_view field, bool quoted,
+                 std::string& error) {
+    if (field.empty() && !(quoted && column.type == DataType::STRING)) {
+        if (!column.nullable) {
+            error = "NULL in NOT NULL column " + column.name;
+            return false;
+        }
+        out.appendNull();
+        return true;
+    }
+
+    const char* first = field.data();
+    const char* last = field.data() + field.size();
+    bool ok = true;
+    switch (column.type) {
+        case DataType::INTEGER: {
+            int32_t value = 0;
+            if (*first == '+') ++first;
+            auto parsed = std::from_chars(first, last, value);
+            ok = parsed.ec == std::errc() && parsed.ptr == last;
+            if (ok) out.appendInt(value);
+            break;
+        }
+        case DataType::DOUBLE: {
+            double value = 0.0;
+            if (*first == '+') ++first;
+            auto parsed = std::from_chars(first, last, value);
+            ok = parsed.ec == std::errc() && parsed.ptr == last;
+            if (ok) out.appendDouble(value);
+            break;
+        }
+        case DataType::BOOLEAN:
+            if (equalsIgnoreCase(field, "TRUE") || equalsIgnoreCase(field, "T") || field == "1") {
+                out.appendBool(true);
+            } else if (equalsIgnoreCase(field, "FALSE") || equalsIgnoreCase(field, "F") || field == "0") {
+                out.appendBool(false);
+            } else {
+                ok = false;
+            }
+            break;
+        case DataType::STRING:
+            out.appendString(field);
+            break;
+    }
+    if (!ok) {
+        error = "Invalid " + std::string(typeName(column.type)) + " value '" + std::string(field) +
+                "' for column " + column.name;
+    }
+    return ok;
+}
+
+// A record ends at '\n' or "\r\n", or at the end of the chunk
+bool atRecordEnd(const char* p, const char* end) {
+    return p == end || *p == '\n' || (*p == '\r' && (p + 1 == end || p[1] == '\n'));
+}
+
+const char* skipRecordEnd(const char* p, const char* end) {
+    if (p < end && *p == '\r') ++p;
+    if (p < end && *p == '\n') ++p;
+    return p;
+}
+
+// Records may span lines inside quoted fields
+void parseCsvChunk(ParsedChunk& chunk, const std::vector<Column>& columns, char delimiter) {
+    std::string unquoted;
+    const char* p = chunk.begin;
+    const char* end = chunk.end;
+    while (p < end) {
+        chunk.lines++;
+        if (atRecordEnd(p, end)) {
+            p = skipRecordEnd(p, end);
+            continue;  // blank line
+        }
+
+        const char* q = p;
+        for (size_t col = 0; col < columns.size(); ++col) {
+            std::string_view field;
+            bool quoted = q < end && *q == '"';
+            if (quoted) {
+                // Quoted field; "" stands for one quote
+                unquoted.clear();
+                ++q;
+                for (;;) {
+                    if (q >= end) {
+                        chunk.error = "Unterminated quoted field";
+                        return;
+                    }
+                    if (*q == '"') {
+                        if (q + 1 < end && q[1] == '"') {
+                            unquoted.push_back('"');
+                            q += 2;
+                            continue;
+                        }
+                        ++q;
+                        break;
+                    }
+                    chunk.lines += *q == '\n';
+                    unquoted.push_back(*q++);
+                }
+                field = unquoted;
+            } else {
+                const char* start = q;
+                while (q < end && *q != delimiter && !atRecordEnd(q, end)) ++q;
+                field = std::string_view(start, q - start);
+            }
+
+            bool last = col + 1 == columns.size();
+            if (last ? !atRecordEnd(q, end) : (q >= end || *q != delimiter)) {
+                chunk.error = "Expected " + std::to_string(columns.size()) + " fields";
+                return;
+            }
+            if (!last) ++q;
+            if (!appendField(chunk.columns[col], columns[col], field, quoted, chunk.error)) {
+                return;
+            }
+        }
+        p = skipRecordEnd(q, end);
+    }
+}
+
+void parseBinaryBlock(ParsedChunk& chunk, const std::vector<Column>& columns, uint32_t rows) {
+    WalReader in(chunk.begin, chunk.end - chunk.begin);
+    for (size_t col = 0; col < columns.size(); ++col) {
+        ColumnVector& out = chunk.columns[col];
+        for (uint32_t row = 0; row < rows; ++row) {
+            Value value = in.getValue();
+            if (!in.ok()) {
+                chunk.error = "Truncated block";
+                return;
+            }
+            if (!out.accepts(value) || (value.isNull() && !columns[col].nullable)) {
+                chunk.error = "Bad value for column " + columns[col].name;
+                return;
+            }
+            out.append(value);
+        }
+    }
+}
+
+// Parses chunks a group at a time, in parallel, and appends each group in
+// order. The group size bounds how much parsed data is held at once.
+bool loadChunks(Table& table, std::vector<ParsedChunk>& chunks,
+                const std::function<void(ParsedChunk&)>& parse, bool csv, size_t line,
+                Transaction* txn, size_t& rows, std::string& error) {
+    size_t parallelism = std::max<size_t>(1, Session::current().parallelism);
+    size_t group = parallelism * 2;
+
+    for (size_t start = 0; start < chunks.size(); start += group) {
+        size_t count = std::min(group, chunks.size() - start);
+        ThreadPool::instance().parallelFor(count, parallelism, [&](size_t i) {
+            ParsedChunk& chunk = chunks[start + i];
+            for (const Column& column : table.getColumns()) {
+                chunk.columns.emplace_back(column.type);
+            }
+            parse(chunk);
+        });
+
+        for (size_t i = start; i < start + count; ++i) {
+            ParsedChunk& chunk = chunks[i];
+            if (!chunk.error.empty()) {
+                error = csv ? "Line " + std::to_string(line + chunk.lines) + ": " + chunk.error
+                                   : "Block " + std::to_string(i + 1) + ": " + chunk.error;
+                return false;
+            }
+            if (!table.insertColumns(chunk.columns, txn)) {
+                error = "Rows do not match table '" + table.getName() + "'";
+                return false;
+            }
+            rows += chunk.columns.empty() ? 0 : chunk.columns[0].size();
+            line += chunk.lines;
+            chunk.columns.clear();
+            chunk.columns.shrink_to_fit();
+        }
+    }
+    return true;
+}
+
+// The first line break at or after from that lies outside quoted fields,
+// or end; quoted says whether p is inside a quoted field, and is updated
+// to match the break. A "" inside a quoted field closes and reopens it.
+const char* nextRecordBreak(const char* p, const char* end, const char* from, bool& quoted) {
+    while (p < end) {
+        if (quoted) {
+            const char* quote = static_cast<const char*>(std::memchr(p, '"', end - p));
+            if (!quote) return end;
+            quoted = false;
+            p = quote + 1;
+            continue;
+        }
+        const char* start = std::max(p, from);
+        const char* eol = start < end ? static_cast<const char*>(std::memchr(start, '\n', end - start)) : nullptr;
+        if (!eol) return end;
+        const char* quote = static_cast<const char*>(std::memchr(p, '"', eol - p));
+        if (!quote) return eol;
+        quoted = true;
+        p = quote + 1;
+    }
+    return end;
+}
+
+// Cuts the file into chunks that end at record breaks, so that no record
+// straddles two chunks; returns the number of header lines skipped
+size_t splitCsv(const MappedFile& file, const CopyOptions& options, std::vector<ParsedChunk>& chunks) {
+    const char* p = file.data();
+    const char* end = p + file.size();
+    bool quoted = false;
+    size_t skipped = 0;
+    if (options.header && p < end) {
+        const char* eol = nextRecordBreak(p, end, p, quoted);
+        p = eol < end ? eol + 1 : end;
+        skipped = 1;
+    }
+    while (p < end) {
+        const char* next = end;
+        if (static_cast<size_t>(end - p) > kChunkBytes) {
+            const char* eol = nextRecordBreak(p, end, p + kChunkBytes, quoted);
+            next = eol < end ? eol + 1 : end;
+        }
+        ParsedChunk chunk;
+        chunk.begin = p;
+        chunk.end = next;
+        chunks.push_back(std::move(chunk));
+        p = next;
+    }
+    return skipped;
+}
+
+bool splitBinary(const MappedFile& file, const Table& table, std::vector<ParsedChunk>& chunks,
+                 std::vector<uint32_t>& block_rows, std::string& error) {
+    const std::vector<Column>& columns = table.getColumns();
+    WalReader in(file.data(), file.size());
+    char magic[8];
+    for (char& c : magic) c = static_cast<char>(in.getU8());
+    uint32_t version = in.getU32();
+    uint32_t column_count = in.getU32();
+    if (!in.ok() || std::memcmp(magic, kCopyMagic, sizeof(magic)) != 0) {
+        error = "Not a binary COPY file";
+        return false;
+    }
+    if (version != kCopyVersion) {
+        error = "Unsupported binary COPY version " + std::to_string(version);
+        return false;
+    }
+    if (column_count != columns.size()) {
+        error = "File has " + std::to_string(column_count) + " columns, table has " +
+                std::to_string(columns.size());
+        return false;
+    }
+    for (const Column& column : columns) {
+        if (in.getU8() != static_cast<uint8_t>(column.type)) {
+            error = "Column types do not match table '" + table.getName() + "'";
+            return false;
+        }
+    }
+
+    size_t offset = 8 + 4 + 4 + columns.size();
+    while (offset < file.size()) {
+        WalReader block(file.data() + offset, file.size() - offset);
+        uint32_t rows = block.getU32();
+        uint64_t bytes = block.getU64();
+        offset += 12;
+        if (!block.ok() || bytes > file.size() - offset) {
+            error = "Block " + std::to_string(chunks.size() + 1) + ": Truncated block";
+            return false;
+        }
+        ParsedChunk chunk;
+        chunk.begin = file.data() + offset;
+        chunk.end = chunk.begin + bytes;
+        chunks.push_back(std::move(chunk));
+        block_rows.push_back(rows);
+        offset += bytes;
+    }
+    return true;
+}
+
+// Drops the rows txn inserted into table after its first `mark` inserts
+void undoInserts(Table& table, Transaction& txn, size_t mark) {
+    TableWrites& writes = txn.writesFor(table.shared_from_this());
+    TableWrites undo;
+    undo.table = writes.table;
+    undo.inserted.assign(writes.inserted.begin() + mark, writes.inserted.end());
+    table.finishWrites(undo, txn.marker(), 0);
+    writes.inserted.resize(mark);
+}
+
+void writeCsvValue(std::string& out, const Value& value, char delimiter) {
+    switch (value.kind()) {
+        case Value::Kind::NUL:
+            break;  // an empty field
+        case Value::Kind::INTEGER:
+            out += std::to_string(value.asInt());
+            break;
+        case Value::Kind::DOUBLE: {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.17g", value.asDouble());
+            out += buffer;
+            break;
+        }
+        case Value::Kind::BOOLEAN:
+            out += value.asBool() ? "true" : "false";
+            break;
+        case Value::Kind::STRING: {
+            // Quote the empty string so that it reads back as "" rather than NULL
+            std::string_view s = value.asString();
+            if (!s.empty() && s.find_first_of(std::string{delimiter, '"', '\n', '\r'}) == std::string_view::npos) {
+                out += s;
+                return;
+            }
+            out.push_back('"');
+            for (char c : s) {
+                if (c == '"') out.push_back('"');
+                out.push_back(c);
+            }
+            out.push_back('"');
+            break;
+        }
+    }
+}
+
+}
+
+bool copyFrom(Table& table, const std::string& path, const CopyOptions& options,
+              Transaction* txn, size_t& rows, std::string& error) {
+    rows = 0;
+    MappedFile file;
+    if (!file.open(path, error)) {
+        return false;
+    }
+
+    const std::vector<Column>& columns = table.getColumns();
+    std::vector<ParsedChunk> chunks;
+    std::vector<uint32_t> block_rows;
+    bool csv = options.format == CopyFormat::CSV;
+    size_t skipped_lines = 0;
+    if (csv) {
+        skipped_lines = splitCsv(file, options, chunks);
+    } else if (!splitBinary(file, table, chunks, block_rows, error)) {
+        return false;
+    }
+
+    size_t mark = txn ? txn->writesFor(table.shared_from_this()).inserted.size() : 0;
+    std::function<void(ParsedChunk&)> parse;
+    if (csv) {
+        char delimiter = options.delimiter;
+        parse = [&columns, delimiter](ParsedChunk& chunk) { parseCsvChunk(chunk, columns, delimiter); };
+    } else {
+        parse = [&](ParsedChunk& chunk) {
+            parseBinaryBlock(chunk, columns, block_rows[&chunk - chunks.data()]);
+        };
+    }
+
+    if (!loadChunks(table, chunks, parse, csv, skipped_lines, txn, rows, error)) {
+        if (txn) {
+            undoInserts(table, *txn, mark);
+        }
+        rows = 0;
+        return false;
+    }
+    return true;
+}
+
+bool copyTo(Table& table, const std::string& path, const CopyOptions& options,
+            std::shared_ptr<Transaction> txn, size_t& rows, std::string& error) {
+    rows = 0;
+    std::unique_ptr<ResultCursor> cursor = table.openCursor({}, nullptr, std::move(txn));
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        error = "Cannot create '" + path + "': " + std::strerror(errno);
+        return false;
+    }
+
+    const std::vector<Column>& columns = table.getColumns();
+    bool ok = true;
+    RowBatch batch;
+    if (options.format == CopyFormat::CSV) {
+        std::string out;
+        if (options.header) {
+            for (size_t i = 0; i < columns.size(); ++i) {
+                if (i) out.push_back(options.delimiter);
+                writeCsvValue(out, Value(columns[i].name), options.delimiter);
+            }
+            out.push_back('\n');
+        }
+        while (ok && cursor->next(batch)) {
+            for (size_t r = 0; r < batch.size; ++r) {
+                const Row& row = batch.rows[r];
+                for (size_t i = 0; i < row.size(); ++i) {
+                    if (i) out.push_back(options.delimiter);
+                    writeCsvValue(out, row[i], options.delimiter);
+                }
+                out.push_back('\n');
+            }
+            rows += batch.size;
+            ok = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+            out.clear();
+        }
+        ok = ok && std::fwrite(out.data(), 1, out.size(), file) == out.size();
+    } else {
+        WalWriter header;
+        for (char c : kCopyMagic) header.putU8(static_cast<uint8_t>(c));
+        header.putU32(kCopyVersion);
+        header.putU32(static_cast<uint32_t>(columns.size()));
+        for (const Column& column : columns) header.putU8(static_cast<uint8_t>(column.type));
+        ok = std::fwrite(header.data().data(), 1, header.data().size(), file) == header.data().size();
+
+        // Blocks are column-major, so loading one fills a column at a time
+        std::vector<Row> pending;
+        bool more = true;
+        while (ok && more) {
+            more = cursor->next(batch);
+            for (size_t r = 0; r < batch.size && more; ++r) {
+                pending.push_back(batch.rows[r]);
+            }
+            if (pending.empty() || (more && pending.size() < kBinaryBlockRows)) {
+                continue;
+            }
+            WalWriter block;
+            for (size_t i = 0; i < columns.size(); ++i) {
+                for (const Row& row : pending) block.putValue(row[i]);
+            }
+            WalWriter frame;
+            frame.putU32(static_cast<uint32_t>(pending.size()));
+            frame.putU64(block.data().size());
+            ok = std::fwrite(frame.data().data(), 1, frame.data().size(), file) == frame.data().size() &&
+                 std::fwrite(block.data().data(), 1, block.data().size(), file) == block.data().size();
+            rows += pending.size();
+            pending.clear();
+        }
+    }
+
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok) {
+        error = "Cannot write '" + path + "': " + std::strerror(errno);
+    }
+    return ok;
+}
+
+}
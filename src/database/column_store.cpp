@@ -0,0 +1,710 @@
+#include "column_store.h"
+#include <unordered_map>
+
+namespace InMemoryDB {
+
+const char* encodingName(Encoding encoding) {
+    switch (encoding) {
+        case Encoding::PLAIN: return "PLAIN";
+        case Encoding::RLE: return "RLE";
+        case Encoding::BITPACK: return "BITPACK";
+        case Encoding::DICTIONARY: return "DICTIONARY";
+    }
+    return "";
+}
+
+unsigned PackedInts::widthFor(uint32_t max_value) {
+    return max_value == 0 ? 0 : 32 - __builtin_clz(max_value);
+}
+
+void PackedInts::pack(const uint32_t* values, size_t n, unsigned width) {
+    width_ = width;
+    words_.assign((n * width + 63) / 64, 0);
+    if (width == 0) {
+        return;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        size_t bit = i * width;
+        size_t word = bit >> 6;
+        unsigned shift = bit & 63;
+        words_[word] |= uint64_t(values[i]) << shift;
+        if (shift + width > 64) {
+            words_[word + 1] |= uint64_t(values[i]) >> (64 - shift);
+        }
+    }
+}
+
+void PackedInts::unpack(size_t start, size_t count, uint32_t* out) const {
+    if (width_ == 0) {
+        std::fill(out, out + count, 0);
+        return;
+    }
+    uint64_t mask = (uint64_t(1) << width_) - 1;
+    size_t bit = start * width_;
+    for (size_t i = 0; i < count; ++i, bit += width_) {
+        size_t word = bit >> 6;
+        unsigned shift = bit & 63;
+        uint64_t value = words_[word] >> shift;
+        if (shift + width_ > 64) value |= words_[word + 1] << (64 - shift);
+        out[i] = static_cast<uint32_t>(value & mask);
+    }
+}
+
+size_t ColumnBlock::bytes() const {
+    return ints.size() * sizeof(int32_t) + strings.size() * sizeof(StringRef) + heap.size() +
+           run_values.size() * sizeof(int32_t) + run_ends.size() * sizeof(uint32_t) + codes.bytes();
+}
+
+ColumnVector::ColumnVector(DataType type) : type_(type), size_(0) {}
+
+bool ColumnVector::accepts(const Value& value) const {
+    if (value.isNull()) {
+        return true;
+    }
+
+    switch (type_) {
+        case DataType::INTEGER:
+            return value.isInt() && value.asInt() >= INT32_MIN && value.asInt() <= INT32_MAX;
+        case DataType::DOUBLE:
+            return value.isNumber();
+        case DataType::STRING:
+            return value.isString();
+        case DataType::BOOLEAN:
+            return value.isBool();
+    }
+    return false;
+}
+
+StringRef ColumnVector::appendToHeap(ColumnBlock& block, std::string_view s) {
+    StringRef ref{block.heap.size(), static_cast<uint32_t>(s.size())};
+    block.heap.append(s);
+    return ref;
+}
+
+ColumnBlock& ColumnVector::appendBlock() {
+    if ((size_ & kBlockMask) == 0) {
+        blocks_.emplace_back();
+    }
+    return blocks_.back();
+}
+
+ZoneMap& ColumnVector::appendZone() {
+    if ((size_ & kBlockMask) == 0) {
+        zones_.emplace_back();
+    }
+    return zones_.back();
+}
+
+void ColumnVector::finishAppend() {
+    size_++;
+    if ((size_ & kBlockMask) == 0) {
+        encodeBlock(blocks_.back());
+    }
+}
+
+void ColumnVector::pushInt(int32_t value) {
+    appendZone().add(static_cast<double>(value));
+    appendBlock().ints.push_back(value);
+    finishAppend();
+}
+
+void ColumnVector::pushDouble(double value) {
+    appendZone().add(value);
+    doubles_.push_back(value);
+    size_++;
+}
+
+void ColumnVector::pushBool(bool value) {
+    appendZone().add(value ? 1.0 : 0.0);
+    bools_.push_back(value);
+    size_++;
+}
+
+void ColumnVector::pushString(std::string_view value) {
+    appendZone().add(value);
+    ColumnBlock& block = appendBlock();
+    block.strings.push_back(appendToHeap(block, value));
+    finishAppend();
+}
+
+void ColumnVector::pushNull() {
+    appendZone().null_count++;
+    switch (type_) {
+        case DataType::INTEGER: {
+            ColumnBlock& block = appendBlock();
+            block.ints.push_back(block.ints.empty() ? 0 : block.ints.back());
+            finishAppend();
+            break;
+        }
+        case DataType::STRING: {
+            ColumnBlock& block = appendBlock();
+            block.strings.push_back(block.strings.empty() ? StringRef{0, 0} : block.strings.back());
+            finishAppend();
+            break;
+        }
+        case DataType::DOUBLE:
+            doubles_.push_back(0.0);
+            size_++;
+            break;
+        case DataType::BOOLEAN:
+            bools_.push_back(false);
+            size_++;
+            break;
+    }
+}
+
+void ColumnVector::append(const Value& value) {
+    if (value.isNull()) {
+        appendNull();
+        return;
+    }
+
+    switch (type_) {
+        case DataType::INTEGER: appendInt(static_cast<int32_t>(value.asInt())); break;
+        case DataType::DOUBLE: appendDouble(value.asDouble()); break;
+        case DataType::STRING: appendString(value.asString()); break;
+        case DataType::BOOLEAN: appendBool(value.asBool()); break;
+    }
+}
+
+void ColumnVector::appendNull() {
+    pushNull();
+    validity_.push_back(false);
+}
+
+void ColumnVector::appendColumn(const Row* rows, size_t count, size_t column) {
+    const Row* end = rows + count;
+    switch (type_) {
+        case DataType::INTEGER:
+            for (const Row* row = rows; row != end; ++row) {
+                const Value& value = (*row)[column];
+                if (value.isNull()) {
+                    pushNull();
+                } else {
+                    pushInt(static_cast<int32_t>(value.asInt()));
+                }
+            }
+            break;
+        case DataType::DOUBLE:
+            for (const Row* row = rows; row != end; ++row) {
+                const Value& value = (*row)[column];
+                if (value.isNull()) {
+                    pushNull();
+                } else {
+                    pushDouble(value.asDouble());
+                }
+            }
+            break;
+        case DataType::STRING:
+            for (const Row* row = rows; row != end; ++row) {
+                const Value& value = (*row)[column];
+                if (value.isNull()) {
+                    pushNull();
+                } else {
+                    pushString(value.asString());
+                }
+            }
+            break;
+        case DataType::BOOLEAN:
+            for (const Row* row = rows; row != end; ++row) {
+                const Value& value = (*row)[column];
+                if (value.isNull()) {
+                    pushNull();
+                } else {
+                    pushBool(value.asBool());
+                }
+            }
+            break;
+    }
+    for (const Row* row = rows; row != end; ++row) {
+        validity_.push_back(!(*row)[column].isNull());
+    }
+}
+
+void ColumnVector::pushFrom(const ColumnVector& other, size_t row) {
+    if (other.isNull(row)) {
+        pushNull();
+        return;
+    }
+    switch (type_) {
+        case DataType::INTEGER: pushInt(other.intAt(row)); break;
+        case DataType::DOUBLE: pushDouble(other.doubles_[row]); break;
+        case DataType::STRING: pushString(other.stringAt(row)); break;
+        case DataType::BOOLEAN: pushBool(other.bools_.get(row)); break;
+    }
+}
+
+void ColumnVector::appendFrom(const ColumnVector& other) {
+    for (size_t row = 0; row < other.size_; ++row) {
+        pushFrom(other, row);
+    }
+    validity_.append(other.validity_);
+}
+
+void ColumnVector::encodeBlock(ColumnBlock& block) {
+    block.settled = true;
+
+    if (type_ == DataType::INTEGER) {
+        const std::vector<int32_t>& ints = block.ints;
+        size_t n = ints.size();
+        int32_t min = ints[0];
+        int32_t max = ints[0];
+        size_t runs = 1;
+        for (size_t i = 1; i < n; ++i) {
+            min = std::min(min, ints[i]);
+            max = std::max(max, ints[i]);
+            runs += ints[i] != ints[i - 1];
+        }
+
+        unsigned width = PackedInts::widthFor(static_cast<uint32_t>(max) - static_cast<uint32_t>(min));
+        size_t plain_bytes = n * sizeof(int32_t);
+        size_t rle_bytes = runs * (sizeof(int32_t) + sizeof(uint32_t));
+        size_t bitpack_bytes = (n * width + 63) / 64 * sizeof(uint64_t);
+        if (rle_bytes < bitpack_bytes && rle_bytes < plain_bytes) {
+            block.encoding = Encoding::RLE;
+            for (size_t i = 0; i < n; ++i) {
+                if (i + 1 == n || ints[i + 1] != ints[i]) {
+                    block.run_values.push_back(ints[i]);
+                    block.run_ends.push_back(static_cast<uint32_t>(i + 1));
+                }
+            }
+        } else if (bitpack_bytes < plain_bytes) {
+            block.encoding = Encoding::BITPACK;
+            block.base = min;
+            std::vector<uint32_t> deltas(n);
+            for (size_t i = 0; i < n; ++i) {
+                deltas[i] = static_cast<uint32_t>(ints[i]) - static_cast<uint32_t>(min);
+            }
+            block.codes.pack(deltas.data(), n, width);
+        } else {
+            return;
+        }
+        block.ints.clear();
+        block.ints.shrink_to_fit();
+        return;
+    }
+
+    if (type_ != DataType::STRING) {
+        return;
+    }
+
+    // A dictionary only pays off when values repeat, so give up as soon as
+    // half the rows turn out to be distinct
+    size_t n = block.strings.size();
+    std::unordered_map<std::string_view, uint32_t> codes;
+    size_t distinct_bytes = 0;
+    for (const StringRef& ref : block.strings) {
+        std::string_view s(block.heap.data() + ref.offset, ref.length);
+        if (codes.emplace(s, 0).second) {
+            distinct_bytes += s.size();
+            if (codes.size() > n / 2) {
+                return;
+            }
+        }
+    }
+
+    size_t live_bytes = 0;
+    for (const StringRef& ref : block.strings) {
+        live_bytes += ref.length;
+    }
+    unsigned width = PackedInts::widthFor(static_cast<uint32_t>(codes.size() - 1));
+    size_t plain_bytes = n * sizeof(StringRef) + live_bytes;
+    size_t dictionary_bytes = codes.size() * sizeof(StringRef) + distinct_bytes +
+                              (n * width + 63) / 64 * sizeof(uint64_t);
+    if (dictionary_bytes >= plain_bytes) {
+        return;
+    }
+
+    std::vector<std::string_view> sorted;
+    sorted.reserve(codes.size());
+    for (const auto& entry : codes) {
+        sorted.push_back(entry.first);
+    }
+    std::sort(sorted.begin(), sorted.end());
+
+    std::string heap;
+    heap.reserve(distinct_bytes);
+    std::vector<StringRef> dictionary;
+    dictionary.reserve(sorted.size());
+    for (size_t code = 0; code < sorted.size(); ++code) {
+        codes[sorted[code]] = static_cast<uint32_t>(code);
+        dictionary.push_back(StringRef{heap.size(), static_cast<uint32_t>(sorted[code].size())});
+        heap.append(sorted[code]);
+    }
+
+    std::vector<uint32_t> row_codes(n);
+    for (size_t i = 0; i < n; ++i) {
+        const StringRef& ref = block.strings[i];
+        row_codes[i] = codes[std::string_view(block.heap.data() + ref.offset, ref.length)];
+    }
+    block.encoding = Encoding::DICTIONARY;
+    block.codes.pack(row_codes.data(), n, width);
+    block.strings.swap(dictionary);
+    block.heap.swap(heap);
+}
+
+void ColumnVector::decodeBlock(ColumnBlock& block) {
+    switch (block.encoding) {
+        case Encoding::PLAIN:
+            return;
+        case Encoding::RLE: {
+            uint32_t start = 0;
+            for (size_t run = 0; run < block.run_values.size(); ++run) {
+                block.ints.insert(block.ints.end(), block.run_ends[run] - start, block.run_values[run]);
+                start = block.run_ends[run];
+            }
+            block.run_values.clear();
+            block.run_values.shrink_to_fit();
+            block.run_ends.clear();
+            block.run_ends.shrink_to_fit();
+            break;
+        }
+        case Encoding::BITPACK:
+            block.ints.resize(kBlockRows);
+            block.codes.unpack(0, kBlockRows, reinterpret_cast<uint32_t*>(block.ints.data()));
+            for (int32_t& value : block.ints) {
+                value = static_cast<int32_t>(static_cast<uint32_t>(value) + static_cast<uint32_t>(block.base));
+            }
+            break;
+        case Encoding::DICTIONARY: {
+            // The dictionary's bytes stay in the heap and the rows point at them
+            std::vector<StringRef> strings(kBlockRows);
+            for (size_t i = 0; i < kBlockRows; ++i) {
+                strings[i] = block.strings[block.codes.get(i)];
+            }
+            block.strings.swap(strings);
+            break;
+        }
+    }
+    block.codes.clear();
+    block.encoding = Encoding::PLAIN;
+}
+
+ColumnBlock& ColumnVector::writableBlock(size_t row) {
+    ColumnBlock& block = blocks_[row >> kBlockShift];
+    decodeBlock(block);
+    block.settled = false;
+    return block;
+}
+
+// Takes row's current value out of its block's zone map counts, before
+// the row is overwritten
+void ColumnVector::retire(size_t row) {
+    ZoneMap& zone = zones_[row >> kBlockShift];
+    if (isNull(row)) {
+        zone.null_count--;
+    } else {
+        zone.value_count--;
+    }
+}
+
+// Adds row's new value to its block's zone map
+void ColumnVector::cover(size_t row) {
+    ZoneMap& zone = zones_[row >> kBlockShift];
+    if (isNull(row)) {
+        zone.null_count++;
+        return;
+    }
+    switch (type_) {
+        case DataType::INTEGER: zone.add(static_cast<double>(intAt(row))); break;
+        case DataType::DOUBLE: zone.add(doubles_[row]); break;
+        case DataType::STRING: zone.add(stringAt(row)); break;
+        case DataType::BOOLEAN: zone.add(bools_.get(row) ? 1.0 : 0.0); break;
+    }
+}
+
+void ColumnVector::rebuildZone(size_t block) {
+    zones_[block] = ZoneMap();
+    size_t end = std::min(size_, (block + 1) << kBlockShift);
+    for (size_t row = block << kBlockShift; row < end; ++row) {
+        cover(row);
+    }
+}
+
+void ColumnVector::refreshZones() {
+    for (size_t block = 0; block < zones_.size(); ++block) {
+        rebuildZone(block);
+    }
+}
+
+void ColumnVector::set(size_t row, const Value& value) {
+    retire(row);
+
+    // A NULL keeps the old value in its slot; only validity changes
+    validity_.set(row, !value.isNull());
+    if (value.isNull()) {
+        cover(row);
+        return;
+    }
+
+    switch (type_) {
+        case DataType::INTEGER:
+            writableBlock(row).ints[row & kBlockMask] = static_cast<int32_t>(value.asInt());
+            break;
+        case DataType::DOUBLE:
+            doubles_[row] = value.asDouble();
+            break;
+        case DataType::STRING: {
+            // The old bytes stay in the heap until the next compactHeap()
+            ColumnBlock& block = writableBlock(row);
+            block.strings[row & kBlockMask] = appendToHeap(block, value.asString());
+            break;
+        }
+        case DataType::BOOLEAN:
+            bools_.set(row, value.asBool());
+            break;
+    }
+    cover(row);
+}
+
+Value ColumnVector::get(size_t row) const {
+    if (isNull(row)) {
+        return Value();
+    }
+
+    switch (type_) {
+        case DataType::INTEGER:
+            return intAt(row);
+        case DataType::DOUBLE:
+            return doubles_[row];
+        case DataType::STRING:
+            return stringAt(row);
+        case DataType::BOOLEAN:
+            return bools_.get(row);
+    }
+    return Value();
+}
+
+void ColumnVector::moveRow(size_t from, size_t to) {
+    retire(to);
+    switch (type_) {
+        case DataType::INTEGER: {
+            int32_t value = intAt(from);
+            writableBlock(to).ints[to & kBlockMask] = value;
+            break;
+        }
+        case DataType::DOUBLE:
+            doubles_[to] = doubles_[from];
+            break;
+        case DataType::STRING:
+            if ((from >> kBlockShift) == (to >> kBlockShift)) {
+                ColumnBlock& block = writableBlock(to);
+                block.strings[to & kBlockMask] = block.strings[from & kBlockMask];
+            } else {
+                std::string_view value = stringAt(from);
+                ColumnBlock& block = writableBlock(to);
+                block.strings[to & kBlockMask] = appendToHeap(block, value);
+            }
+            break;
+        case DataType::BOOLEAN:
+            bools_.set(to, bools_.get(from));
+            break;
+    }
+    validity_.set(to, validity_.get(from));
+    cover(to);
+}
+
+void ColumnVector::truncate(size_t n) {
+    switch (type_) {
+        case DataType::INTEGER:
+        case DataType::STRING:
+            blocks_.resize((n + kBlockMask) >> kBlockShift);
+            if (n & kBlockMask) {
+                ColumnBlock& block = writableBlock(n - 1);
+                if (type_ == DataType::INTEGER) {
+                    block.ints.resize(n & kBlockMask);
+                } else {
+                    block.strings.resize(n & kBlockMask);
+                }
+            }
+            break;
+        case DataType::DOUBLE: doubles_.resize(n); break;
+        case DataType::BOOLEAN: bools_.resize(n); break;
+    }
+    validity_.resize(n);
+    size_ = n;
+
+    zones_.resize((n + kBlockMask) >> kBlockShift);
+    if (n & kBlockMask) {
+        rebuildZone(zones_.size() - 1);
+    }
+}
+
+void ColumnVector::compactHeap() {
+    if (type_ != DataType::STRING) {
+        return;
+    }
+
+    // Dictionary blocks hold each string once already
+    for (ColumnBlock& block : blocks_) {
+        if (block.encoding != Encoding::PLAIN) {
+            continue;
+        }
+        size_t live_bytes = 0;
+        for (const StringRef& ref : block.strings) {
+            live_bytes += ref.length;
+        }
+
+        std::string new_heap;
+        new_heap.reserve(live_bytes);
+        for (StringRef& ref : block.strings) {
+            uint64_t offset = new_heap.size();
+            new_heap.append(block.heap, ref.offset, ref.length);
+            ref.offset = offset;
+        }
+        block.heap.swap(new_heap);
+    }
+}
+
+void ColumnVector::compress() {
+    if (type_ != DataType::INTEGER && type_ != DataType::STRING) {
+        return;
+    }
+    size_t full = size_ >> kBlockShift;
+    for (size_t i = 0; i < full; ++i) {
+        if (!blocks_[i].settled) {
+            encodeBlock(blocks_[i]);
+        }
+    }
+}
+
+bool ColumnVector::load(size_t n, const void* values, const uint64_t* validity,
+                        const char* heap, size_t heap_bytes) {
+    blocks_.clear();
+    zones_.clear();
+    doubles_.clear();
+    bools_.clear();
+    validity_.assign(validity, n);
+    size_ = n;
+
+    // Arrays are copied a block at a time: NULL slots are made to repeat
+    // the previous row, as pushNull() does, the zone map is filled in the
+    // same pass, and a full block is encoded once
+    zones_.resize((n + kBlockMask) >> kBlockShift);
+    for (size_t block = 0; block < zones_.size(); ++block) {
+        size_t start = block << kBlockShift;
+        size_t end = std::min(n, start + kBlockRows);
+        ZoneMap& zone = zones_[block];
+        switch (type_) {
+            case DataType::INTEGER: {
+                const int32_t* ints = static_cast<const int32_t*>(values);
+                ColumnBlock& column_block = blocks_.emplace_back();
+                column_block.ints.assign(ints + start, ints + end);
+                for (size_t row = start; row < end; ++row) {
+                    int32_t& value = column_block.ints[row - start];
+                    if (!validity_.get(row)) {
+                        zone.null_count++;
+                        value = row > start ? (&value)[-1] : 0;
+                    } else {
+                        zone.add(static_cast<double>(value));
+                    }
+                }
+                break;
+            }
+            case DataType::STRING: {
+                // A block's strings are a contiguous run of the heap
+                const StringRef* refs = static_cast<const StringRef*>(values);
+                uint64_t low = heap_bytes;
+                uint64_t high = 0;
+                for (size_t row = start; row < end; ++row) {
+                    if (refs[row].offset > heap_bytes || refs[row].length > heap_bytes - refs[row].offset) {
+                        return false;
+                    }
+                    low = std::min(low, refs[row].offset);
+                    high = std::max(high, refs[row].offset + refs[row].length);
+                }
+                ColumnBlock& column_block = blocks_.emplace_back();
+                column_block.heap.assign(heap + low, high - low);
+                column_block.strings.resize(end - start);
+                for (size_t row = start; row < end; ++row) {
+                    StringRef& ref = column_block.strings[row - start];
+                    if (!validity_.get(row)) {
+                        zone.null_count++;
+                        ref = row > start ? (&ref)[-1] : StringRef{0, 0};
+                    } else {
+                        ref = StringRef{refs[row].offset - low, refs[row].length};
+                        zone.add(std::string_view(column_block.heap.data() + ref.offset, ref.length));
+                    }
+                }
+                break;
+            }
+            case DataType::DOUBLE: {
+                const double* doubles = static_cast<const double*>(values);
+                for (size_t row = start; row < end; ++row) {
+                    if (!validity_.get(row)) {
+                        zone.null_count++;
+                    } else {
+                        zone.add(doubles[row]);
+                    }
+                }
+                break;
+            }
+            case DataType::BOOLEAN: {
+                const uint64_t* words = static_cast<const uint64_t*>(values);
+                for (size_t row = start; row < end; ++row) {
+                    if (!validity_.get(row)) {
+                        zone.null_count++;
+                    } else {
+                        zone.add((words[row >> 6] >> (row & 63)) & 1 ? 1.0 : 0.0);
+                    }
+                }
+                break;
+            }
+        }
+        if (end - start == kBlockRows && (type_ == DataType::INTEGER || type_ == DataType::STRING)) {
+            encodeBlock(blocks_.back());
+        }
+    }
+
+    // Doubles and booleans are stored as they are mapped
+    if (type_ == DataType::DOUBLE) {
+        const double* doubles = static_cast<const double*>(values);
+        doubles_.assign(doubles, doubles + n);
+    } else if (type_ == DataType::BOOLEAN) {
+        bools_.assign(static_cast<const uint64_t*>(values), n);
+    }
+    return true;
+}
+
+void ColumnVector::reserve(size_t n) {
+    // Blocks grow one at a time
+    switch (type_) {
+        case DataType::DOUBLE: doubles_.reserve(n); break;
+        case DataType::BOOLEAN: bools_.reserve(n); break;
+        default: break;
+    }
+    validity_.reserve(n);
+}
+
+ColumnStorage ColumnVector::storage() const {
+    ColumnStorage storage;
+    size_t validity_bytes = (size_ + 63) / 64 * sizeof(uint64_t);
+    storage.bytes = validity_bytes;
+    storage.plain_bytes = validity_bytes;
+    switch (type_) {
+        case DataType::INTEGER:
+            storage.plain_bytes += size_ * sizeof(int32_t);
+            break;
+        case DataType::DOUBLE:
+            storage.bytes += size_ * sizeof(double);
+            storage.plain_bytes += size_ * sizeof(double);
+            break;
+        case DataType::BOOLEAN:
+            storage.bytes += (size_ + 63) / 64 * sizeof(uint64_t);
+            storage.plain_bytes += (size_ + 63) / 64 * sizeof(uint64_t);
+            break;
+        case DataType::STRING:
+            storage.plain_bytes += size_ * sizeof(StringRef);
+            for (size_t row = 0; row < size_; ++row) {
+                storage.plain_bytes += stringAt(row).size();
+            }
+            break;
+    }
+    for (const ColumnBlock& block : blocks_) {
+        storage.blocks[static_cast<size_t>(block.encoding)]++;
+        storage.bytes += block.bytes();
+    }
+    return storage;
+}
+
+}
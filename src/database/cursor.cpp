@@ -0,0 +1,143 @@
+#include "cursor.h"
+#include "table.h"
+#include "session.h"
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace InMemoryDB {
+
+TableCursor::TableCursor(std::shared_ptr<Table> table, std::vector<int> column_indices, std::unique_ptr<Predicate> where,
+                         std::shared_ptr<Transaction> txn, PlanNode* access)
+    : table_(std::move(table)), column_indices_(std::move(column_indices)), where_(std::move(where)),
+      txn_(std::move(txn)), view_(txn_ ? txn_->view() : ReadView()),
+      position_(0), end_(table_->row_count_), use_candidates_(false), access_(access) {
+    for (int index : column_indices_) {
+        columns_.push_back(table_->columns_[index]);
+    }
+    
+    // Index probes are cheap, so resolve them up front
+    std::vector<int> row_ids;
+    AccessPlan used;
+    if (where_ && table_->probeIndexes(where_.get(), row_ids, &used)) {
+        use_candidates_ = true;
+        for (int row_id : row_ids) {
+            if (table_->slots_[row_id] != Table::kTombstone) {
+                candidates_.push_back(table_->slots_[row_id]);
+            }
+        }
+        std::sort(candidates_.begin(), candidates_.end());
+        end_ = candidates_.size();
+    }
+    if (access_) {
+        access_->label = table_->accessLabel(used, where_.get());
+    }
+    
+    table_->pin_count_++;
+}
+
+TableCursor::~TableCursor() {
+    table_->pin_count_--;
+}
+
+void TableCursor::fill(Row& row, size_t position) const {
+    row.resize(column_indices_.size());
+    for (size_t i = 0; i < column_indices_.size(); ++i) {
+        row[i] = table_->data_[column_indices_[i]].get(position);
+    }
+}
+
+void TableCursor::emit(RowBatch& batch, size_t position) {
+    if (batch.rows.size() <= batch.size) {
+        batch.rows.emplace_back();
+    }
+    fill(batch.rows[batch.size++], position);
+}
+
+bool TableCursor::next(RowBatch& batch) {
+    ProfileScope scope(access_ ? &access_->profile : nullptr);
+    std::shared_lock<std::shared_mutex> lock = sharedLock(table_->mutex_);
+    
+    batch.size = 0;
+    size_t start = position_;
+    bool more = fetch(batch);
+    if (access_) {
+        access_->profile.rows_in += position_ - start;
+        access_->profile.rows_out += batch.size;
+    }
+    return more;
+}
+
+// Fills batch under the table lock
+bool TableCursor::fetch(RowBatch& batch) {
+    if (use_candidates_) {
+        for (; position_ < end_ && batch.size < kBatchSize; ++position_) {
+            size_t pos = candidates_[position_];
+            if (!table_->deleted_.get(pos) && table_->visible(view_, pos) &&
+                where_->matches(table_->data_, pos)) {
+                emit(batch, pos);
+            }
+        }
+        return batch.size > 0 || position_ < end_;
+    }
+    
+    if (position_ >= end_) {
+        return false;
+    }
+    
+    // A sequential cursor examines one batch per call so the lock is held
+    // briefly; a parallel one takes a whole morsel and splits it into
+    // batches across the pool
+    size_t parallelism = Session::current().parallelism;
+    size_t start = position_;
+    size_t count = std::min(parallelism > 1 ? kMorselSize : kBatchSize, end_ - start);
+    size_t chunks = (count + kBatchSize - 1) / kBatchSize;
+    
+    if (chunks == 1) {
+        selected_.clear();
+        table_->filterRange(where_.get(), view_, start, start + count, selected_);
+        for (size_t pos : selected_) {
+            emit(batch, pos);
+        }
+        position_ += count;
+        return true;
+    }
+    
+    std::vector<std::vector<size_t>> parts(chunks);
+    ThreadPool& pool = ThreadPool::instance();
+    pool.parallelFor(chunks, parallelism, [&](size_t c) {
+        size_t begin = start + c * kBatchSize;
+        table_->filterRange(where_.get(), view_, begin, std::min(start + count, begin + kBatchSize), parts[c]);
+    });
+    
+    selected_.clear();
+    for (const auto& part : parts) {
+        selected_.insert(selected_.end(), part.begin(), part.end());
+    }
+    
+    // Copy the selected rows out in parallel, keeping scan order
+    batch.size = selected_.size();
+    if (batch.rows.size() < batch.size) {
+        batch.rows.resize(batch.size);
+    }
+    size_t out_chunks = (batch.size + kBatchSize - 1) / kBatchSize;
+    pool.parallelFor(out_chunks, parallelism, [&](size_t c) {
+        size_t end = std::min(batch.size, (c + 1) * kBatchSize);
+        for (size_t i = c * kBatchSize; i < end; ++i) {
+            fill(batch.rows[i], selected_[i]);
+        }
+    });
+    
+    position_ += count;
+    return true;
+}
+
+bool LimitCursor::next(RowBatch& batch) {
+    if (remaining_ == 0 || !input_->next(batch)) {
+        return false;
+    }
+    batch.size = std::min(batch.size, remaining_);
+    remaining_ -= batch.size;
+    return true;
+}
+
+}
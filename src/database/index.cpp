@@ -1,120 +1,588 @@
-#include "types.h"
-#include <unordered_map>
-#include <map>
-#include <vector>
-#include <memory>
+#include "index.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string_view>
 
 namespace InMemoryDB {
 
-class Index {
-public:
-    virtual ~Index() = default;
-    virtual void insert(const Value& key, int row_id) = 0;
-    virtual void remove(const Value& key, int row_id) = 0;
-    virtual std::vector<int> find(const Value& key) = 0;
-    virtual std::vector<int> findRange(const Value& start, const Value& end) = 0;
+void RowIdList::add(int row_id) {
+    if (size_ < kInline) {
+        inline_[size_] = row_id;
+    } else {
+        overflow_.push_back(row_id);
+    }
+    size_++;
+}
+
+bool RowIdList::remove(int row_id) {
+    for (size_t i = 0; i < size_; ++i) {
+        if ((*this)[i] != row_id) continue;
+        
+        // Move the last id into the hole
+        int last = (*this)[size_ - 1];
+        if (i < kInline) {
+            inline_[i] = last;
+        } else {
+            overflow_[i - kInline] = last;
+        }
+        if (size_ > kInline) {
+            overflow_.pop_back();
+        }
+        size_--;
+        return true;
+    }
+    return false;
+}
+
+namespace {
+
+uint64_t mixHash(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Per-type key handling. View is what probes use, so looking up a string
+// key hashes and compares a string_view instead of building a std::string.
+template <typename K> struct KeyTraits;
+
+template <> struct KeyTraits<int32_t> {
+    using View = int32_t;
+    static bool fromValue(const Value& value, View& out) {
+        if (value.isInt()) {
+            out = static_cast<int32_t>(value.asInt());
+            return out == value.asInt();
+        }
+        if (value.isDouble()) {
+            double d = value.asDouble();
+            if (!(d >= INT32_MIN && d <= INT32_MAX)) return false;
+            out = static_cast<int32_t>(d);
+            return static_cast<double>(out) == d;
+        }
+        return false;
+    }
+    static View fromColumn(const ColumnVector& column, size_t row) { return column.intAt(row); }
+    static uint64_t hash(View key) { return mixHash(static_cast<uint32_t>(key)); }
+};
+
+template <> struct KeyTraits<double> {
+    using View = double;
+    static bool fromValue(const Value& value, View& out) {
+        if (!value.isNumber()) return false;
+        out = value.asDouble();
+        return true;
+    }
+    static View fromColumn(const ColumnVector& column, size_t row) { return column.doubleData()[row]; }
+    static uint64_t hash(View key) {
+        double d = key + 0.0; // fold -0.0 into 0.0
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        return mixHash(bits);
+    }
 };
 
-// Hash-based index for equality searches
+template <> struct KeyTraits<bool> {
+    using View = bool;
+    static bool fromValue(const Value& value, View& out) {
+        if (!value.isBool()) return false;
+        out = value.asBool();
+        return true;
+    }
+    static View fromColumn(const ColumnVector& column, size_t row) { return column.boolData().get(row); }
+    static uint64_t hash(View key) { return mixHash(key); }
+};
+
+template <> struct KeyTraits<std::string> {
+    using View = std::string_view;
+    static bool fromValue(const Value& value, View& out) {
+        if (!value.isString()) return false;
+        out = value.asString();
+        return true;
+    }
+    static View fromColumn(const ColumnVector& column, size_t row) { return column.stringAt(row); }
+    static uint64_t hash(View key) { return std::hash<std::string_view>()(key); }
+};
+
+// Hash-based index for equality searches. Linear probing over a
+// power-of-two slot array; removal uses backward-shift deletion so the
+// table never accumulates tombstones.
+template <typename K>
 class HashIndex : public Index {
 private:
-    std::unordered_map<std::string, std::vector<int>> index_;
+    using Traits = KeyTraits<K>;
+    using View = typename Traits::View;
     
-    std::string valueToString(const Value& value) {
-        return std::visit([](const auto& v) -> std::string {
-            if constexpr (std::is_same_v<std::decay_t<decltype(v)>, std::string>) {
-                return v;
-            } else {
-                return std::to_string(v);
+    struct Slot {
+        bool used = false;
+        uint64_t hash = 0;
+        K key{};
+        RowIdList rows;
+    };
+    
+    std::vector<Slot> slots_;
+    size_t count_;
+    
+    size_t mask() const { return slots_.size() - 1; }
+    
+    // Returns the slot holding key, or the empty slot where it would go
+    size_t probe(View key, uint64_t hash) const {
+        size_t pos = hash & mask();
+        while (slots_[pos].used) {
+            if (slots_[pos].hash == hash && View(slots_[pos].key) == key) {
+                break;
+            }
+            pos = (pos + 1) & mask();
+        }
+        return pos;
+    }
+    
+    void grow() {
+        std::vector<Slot> old(slots_.empty() ? 16 : slots_.size() * 2);
+        old.swap(slots_);
+        for (Slot& slot : old) {
+            if (!slot.used) continue;
+            size_t pos = slot.hash & mask();
+            while (slots_[pos].used) pos = (pos + 1) & mask();
+            slots_[pos] = std::move(slot);
+        }
+    }
+    
+    void insertKey(View key, int row_id) {
+        // Keep the load factor under 0.7
+        if ((count_ + 1) * 10 > slots_.size() * 7) {
+            grow();
+        }
+        uint64_t hash = Traits::hash(key);
+        size_t pos = probe(key, hash);
+        Slot& slot = slots_[pos];
+        if (!slot.used) {
+            slot.used = true;
+            slot.hash = hash;
+            slot.key = K(key);
+            count_++;
+        }
+        slot.rows.add(row_id);
+    }
+    
+    const Slot* lookup(const Value& value) const {
+        View key;
+        if (slots_.empty() || !Traits::fromValue(value, key)) {
+            return nullptr;
+        }
+        const Slot& slot = slots_[probe(key, Traits::hash(key))];
+        return slot.used ? &slot : nullptr;
+    }
+    
+    void erase(size_t pos) {
+        // Backward-shift the following cluster into the hole
+        size_t hole = pos;
+        size_t next = (pos + 1) & mask();
+        while (slots_[next].used) {
+            size_t home = slots_[next].hash & mask();
+            if (((next - home) & mask()) >= ((next - hole) & mask())) {
+                slots_[hole] = std::move(slots_[next]);
+                hole = next;
             }
-        }, value);
+            next = (next + 1) & mask();
+        }
+        slots_[hole] = Slot();
+        count_--;
     }
     
 public:
+    HashIndex() : count_(0) {}
+    
+    IndexType type() const override { return IndexType::HASH; }
+    
     void insert(const Value& key, int row_id) override {
-        std::string key_str = valueToString(key);
-        index_[key_str].push_back(row_id);
+        View view;
+        if (!key.isNull() && Traits::fromValue(key, view)) {
+            insertKey(view, row_id);
+        }
     }
     
     void remove(const Value& key, int row_id) override {
-        std::string key_str = valueToString(key);
-        auto& row_ids = index_[key_str];
-        row_ids.erase(std::remove(row_ids.begin(), row_ids.end(), row_id), row_ids.end());
+        const Slot* found = lookup(key);
+        if (!found) return;
         
-        if (row_ids.empty()) {
-            index_.erase(key_str);
+        size_t pos = found - slots_.data();
+        slots_[pos].rows.remove(row_id);
+        if (slots_[pos].rows.empty()) {
+            erase(pos);
         }
     }
     
     std::vector<int> find(const Value& key) override {
-        std::string key_str = valueToString(key);
-        auto it = index_.find(key_str);
-        if (it != index_.end()) {
-            return it->second;
+        std::vector<int> result;
+        findInto(key, result);
+        return result;
+    }
+    
+    void findInto(const Value& key, std::vector<int>& out) const override {
+        if (const Slot* slot = lookup(key)) {
+            slot->rows.appendTo(out);
         }
-        return {};
     }
     
-    std::vector<int> findRange(const Value& start, const Value& end) override {
+    std::vector<int> findRange(const Value&, const Value&) override {
         // Hash index doesn't support range queries efficiently
         return {};
     }
+    
+    bool findRangeInto(const KeyBound&, const KeyBound&, std::vector<int>&) const override {
+        return false;
+    }
+    
+    void build(const ColumnVector& column, const std::vector<int>& row_ids, const Bitmap& deleted) override {
+        clear();
+        for (size_t row = 0; row < column.size(); ++row) {
+            if (!column.isNull(row) && !deleted.get(row)) {
+                insertKey(Traits::fromColumn(column, row), row_ids[row]);
+            }
+        }
+    }
+    
+    void clear() override {
+        slots_.clear();
+        count_ = 0;
+    }
 };
 
-// Tree-based index for range searches
-class TreeIndex : public Index {
+// Tree-based index for range searches. A B+tree with wide nodes: keys are
+// stored in arrays inside each node and leaves are linked for range scans.
+// Duplicate keys are handled by ordering entries on (key, row id), so every
+// entry is unique and removal can find the exact entry. Removal does not
+// rebalance; underfull nodes are repacked by the next build().
+template <typename K>
+class BTreeIndex : public Index {
 private:
-    std::map<std::string, std::vector<int>> index_;
+    using Traits = KeyTraits<K>;
+    using View = typename Traits::View;
+    
+    static constexpr int kCapacity = 64;
+    
+    // One spare slot lets a node overflow by one entry before it is split
+    struct Node {
+        bool leaf;
+        int count;
+        K keys[kCapacity + 1];
+        int rows[kCapacity + 1];
+        
+        explicit Node(bool is_leaf) : leaf(is_leaf), count(0) {}
+    };
+    
+    struct Leaf : Node {
+        Leaf* next;
+        Leaf() : Node(true), next(nullptr) {}
+    };
+    
+    struct Inner : Node {
+        Node* children[kCapacity + 2];
+        Inner() : Node(false) {}
+    };
+    
+    Node* root_;
+    
+    static bool less(View a, int a_row, View b, int b_row) {
+        if (a < b) return true;
+        if (b < a) return false;
+        return a_row < b_row;
+    }
     
-    std::string valueToString(const Value& value) {
-        return std::visit([](const auto& v) -> std::string {
-            if constexpr (std::is_same_v<std::decay_t<decltype(v)>, std::string>) {
-                return v;
+    // First position in node whose entry is >= (key, row)
+    static int lowerBound(const Node* node, View key, int row) {
+        int lo = 0, hi = node->count;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (less(View(node->keys[mid]), node->rows[mid], key, row)) {
+                lo = mid + 1;
             } else {
-                return std::to_string(v);
+                hi = mid;
             }
-        }, value);
+        }
+        return lo;
+    }
+    
+    // Child of an inner node that may contain (key, row)
+    static int childFor(const Node* node, View key, int row) {
+        int lo = 0, hi = node->count;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (less(key, row, View(node->keys[mid]), node->rows[mid])) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        return lo;
+    }
+    
+    Leaf* findLeaf(View key, int row) const {
+        Node* node = root_;
+        while (!node->leaf) {
+            node = static_cast<Inner*>(node)->children[childFor(node, key, row)];
+        }
+        return static_cast<Leaf*>(node);
+    }
+    
+    static void shiftRight(Node* node, int pos) {
+        for (int i = node->count; i > pos; --i) {
+            node->keys[i] = std::move(node->keys[i - 1]);
+            node->rows[i] = node->rows[i - 1];
+        }
+    }
+    
+    // Inserts into the subtree; returns the new right sibling if node split
+    Node* insertInto(Node* node, View key, int row, K& sep_key, int& sep_row) {
+        if (node->leaf) {
+            int pos = lowerBound(node, key, row);
+            shiftRight(node, pos);
+            node->keys[pos] = K(key);
+            node->rows[pos] = row;
+            node->count++;
+            if (node->count <= kCapacity) return nullptr;
+            
+            Leaf* left = static_cast<Leaf*>(node);
+            Leaf* right = new Leaf();
+            int keep = left->count / 2;
+            for (int i = keep; i < left->count; ++i) {
+                right->keys[i - keep] = std::move(left->keys[i]);
+                right->rows[i - keep] = left->rows[i];
+            }
+            right->count = left->count - keep;
+            left->count = keep;
+            right->next = left->next;
+            left->next = right;
+            sep_key = right->keys[0];
+            sep_row = right->rows[0];
+            return right;
+        }
+        
+        Inner* inner = static_cast<Inner*>(node);
+        int idx = childFor(inner, key, row);
+        K child_key;
+        int child_row;
+        Node* split = insertInto(inner->children[idx], key, row, child_key, child_row);
+        if (!split) return nullptr;
+        
+        shiftRight(inner, idx);
+        for (int i = inner->count + 1; i > idx + 1; --i) {
+            inner->children[i] = inner->children[i - 1];
+        }
+        inner->keys[idx] = std::move(child_key);
+        inner->rows[idx] = child_row;
+        inner->children[idx + 1] = split;
+        inner->count++;
+        if (inner->count <= kCapacity) return nullptr;
+        
+        // The middle separator moves up to the parent
+        Inner* right = new Inner();
+        int mid = inner->count / 2;
+        sep_key = std::move(inner->keys[mid]);
+        sep_row = inner->rows[mid];
+        for (int i = mid + 1; i < inner->count; ++i) {
+            right->keys[i - mid - 1] = std::move(inner->keys[i]);
+            right->rows[i - mid - 1] = inner->rows[i];
+        }
+        for (int i = mid + 1; i <= inner->count; ++i) {
+            right->children[i - mid - 1] = inner->children[i];
+        }
+        right->count = inner->count - mid - 1;
+        inner->count = mid;
+        return right;
+    }
+    
+    void insertKey(View key, int row) {
+        K sep_key;
+        int sep_row;
+        Node* split = insertInto(root_, key, row, sep_key, sep_row);
+        if (split) {
+            Inner* root = new Inner();
+            root->keys[0] = std::move(sep_key);
+            root->rows[0] = sep_row;
+            root->children[0] = root_;
+            root->children[1] = split;
+            root->count = 1;
+            root_ = root;
+        }
+    }
+    
+    static void destroy(Node* node) {
+        if (!node->leaf) {
+            Inner* inner = static_cast<Inner*>(node);
+            for (int i = 0; i <= inner->count; ++i) {
+                destroy(inner->children[i]);
+            }
+            delete inner;
+        } else {
+            delete static_cast<Leaf*>(node);
+        }
+    }
+    
+    // Build the tree bottom-up from entries sorted on (key, row)
+    void bulkLoad(std::vector<std::pair<View, int>>& entries) {
+        destroy(root_);
+        if (entries.empty()) {
+            root_ = new Leaf();
+            return;
+        }
+        
+        struct Child { Node* node; View key; int row; };
+        std::vector<Child> level;
+        Leaf* prev = nullptr;
+        for (size_t i = 0; i < entries.size(); i += kCapacity) {
+            Leaf* leaf = new Leaf();
+            size_t end = std::min(entries.size(), i + kCapacity);
+            for (size_t j = i; j < end; ++j) {
+                leaf->keys[j - i] = K(entries[j].first);
+                leaf->rows[j - i] = entries[j].second;
+            }
+            leaf->count = static_cast<int>(end - i);
+            if (prev) prev->next = leaf;
+            prev = leaf;
+            level.push_back({leaf, entries[i].first, entries[i].second});
+        }
+        
+        while (level.size() > 1) {
+            std::vector<Child> parents;
+            for (size_t i = 0; i < level.size(); i += kCapacity + 1) {
+                Inner* inner = new Inner();
+                size_t end = std::min(level.size(), i + kCapacity + 1);
+                inner->children[0] = level[i].node;
+                for (size_t j = i + 1; j < end; ++j) {
+                    inner->keys[j - i - 1] = K(level[j].key);
+                    inner->rows[j - i - 1] = level[j].row;
+                    inner->children[j - i] = level[j].node;
+                }
+                inner->count = static_cast<int>(end - i - 1);
+                parents.push_back({inner, level[i].key, level[i].row});
+            }
+            level.swap(parents);
+        }
+        root_ = level[0].node;
     }
     
 public:
+    BTreeIndex() : root_(new Leaf()) {}
+    ~BTreeIndex() override { destroy(root_); }
+    BTreeIndex(const BTreeIndex&) = delete;
+    BTreeIndex& operator=(const BTreeIndex&) = delete;
+    
+    IndexType type() const override { return IndexType::BTREE; }
+    
     void insert(const Value& key, int row_id) override {
-        std::string key_str = valueToString(key);
-        index_[key_str].push_back(row_id);
+        View view;
+        if (!key.isNull() && Traits::fromValue(key, view)) {
+            insertKey(view, row_id);
+        }
     }
     
     void remove(const Value& key, int row_id) override {
-        std::string key_str = valueToString(key);
-        auto& row_ids = index_[key_str];
-        row_ids.erase(std::remove(row_ids.begin(), row_ids.end(), row_id), row_ids.end());
+        View view;
+        if (!Traits::fromValue(key, view)) return;
         
-        if (row_ids.empty()) {
-            index_.erase(key_str);
+        Leaf* leaf = findLeaf(view, row_id);
+        int pos = lowerBound(leaf, view, row_id);
+        if (pos < leaf->count && View(leaf->keys[pos]) == view && leaf->rows[pos] == row_id) {
+            for (int i = pos; i + 1 < leaf->count; ++i) {
+                leaf->keys[i] = std::move(leaf->keys[i + 1]);
+                leaf->rows[i] = leaf->rows[i + 1];
+            }
+            leaf->count--;
         }
     }
     
     std::vector<int> find(const Value& key) override {
-        std::string key_str = valueToString(key);
-        auto it = index_.find(key_str);
-        if (it != index_.end()) {
-            return it->second;
-        }
-        return {};
+        std::vector<int> result;
+        findInto(key, result);
+        return result;
     }
     
     std::vector<int> findRange(const Value& start, const Value& end) override {
         std::vector<int> result;
-        std::string start_str = valueToString(start);
-        std::string end_str = valueToString(end);
-        
-        auto start_it = index_.lower_bound(start_str);
-        auto end_it = index_.upper_bound(end_str);
+        findRangeInto({&start, true}, {&end, true}, result);
+        return result;
+    }
+    
+    void findInto(const Value& key, std::vector<int>& out) const override {
+        findRangeInto({&key, true}, {&key, true}, out);
+    }
+    
+    bool findRangeInto(const KeyBound& low, const KeyBound& high, std::vector<int>& out) const override {
+        View low_key{}, high_key{};
+        if ((low.value && !Traits::fromValue(*low.value, low_key)) ||
+            (high.value && !Traits::fromValue(*high.value, high_key))) {
+            return false;
+        }
         
-        for (auto it = start_it; it != end_it; ++it) {
-            result.insert(result.end(), it->second.begin(), it->second.end());
+        // Start at the leftmost leaf, or at the first entry past the low bound
+        const Leaf* leaf;
+        int pos = 0;
+        if (low.value) {
+            int row = low.inclusive ? std::numeric_limits<int>::min() : std::numeric_limits<int>::max();
+            leaf = findLeaf(low_key, row);
+            pos = lowerBound(leaf, low_key, row);
+        } else {
+            const Node* node = root_;
+            while (!node->leaf) node = static_cast<const Inner*>(node)->children[0];
+            leaf = static_cast<const Leaf*>(node);
         }
         
-        return result;
+        for (; leaf; leaf = leaf->next, pos = 0) {
+            for (; pos < leaf->count; ++pos) {
+                View key(leaf->keys[pos]);
+                if (high.value && (high_key < key || (!high.inclusive && !(key < high_key)))) {
+                    return true;
+                }
+                out.push_back(leaf->rows[pos]);
+            }
+        }
+        return true;
+    }
+    
+    void build(const ColumnVector& column, const std::vector<int>& row_ids, const Bitmap& deleted) override {
+        std::vector<std::pair<View, int>> entries;
+        entries.reserve(column.size());
+        for (size_t row = 0; row < column.size(); ++row) {
+            if (!column.isNull(row) && !deleted.get(row)) {
+                entries.emplace_back(Traits::fromColumn(column, row), row_ids[row]);
+            }
+        }
+        std::sort(entries.begin(), entries.end());
+        bulkLoad(entries);
+    }
+    
+    void clear() override {
+        destroy(root_);
+        root_ = new Leaf();
     }
 };
 
-}
\ No newline at end of file
+}
+
+std::unique_ptr<Index> createHashIndex(DataType key_type) {
+    switch (key_type) {
+        case DataType::INTEGER: return std::make_unique<HashIndex<int32_t>>();
+        case DataType::DOUBLE: return std::make_unique<HashIndex<double>>();
+        case DataType::STRING: return std::make_unique<HashIndex<std::string>>();
+        case DataType::BOOLEAN: return std::make_unique<HashIndex<bool>>();
+    }
+    return nullptr;
+}
+
+std::unique_ptr<Index> createTreeIndex(DataType key_type) {
+    switch (key_type) {
+        case DataType::INTEGER: return std::make_unique<BTreeIndex<int32_t>>();
+        case DataType::DOUBLE: return std::make_unique<BTreeIndex<double>>();
+        case DataType::STRING: return std::make_unique<BTreeIndex<std::string>>();
+        case DataType::BOOLEAN: return std::make_unique<BTreeIndex<bool>>();
+    }
+    return nullptr;
+}
+
+}
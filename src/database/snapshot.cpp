@@ -0,0 +1,210 @@
+#include "snapshot.h"
+#include "wal.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace InMemoryDB {
+
+namespace {
+
+constexpr char kSnapshotMagic[8] = {'I', 'M', 'D', 'B', 'S', 'N', 'A', 'P'};
+constexpr uint32_t kByteOrderMark = 0x01020304;  // arrays are in native byte order
+constexpr size_t kSnapshotHeader = 64;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t table_count;
+    uint32_t body_crc;
+    uint64_t log_lsn;
+    uint64_t body_size;
+};
+static_assert(sizeof(SnapshotHeader) <= kSnapshotHeader, "snapshot header too large");
+
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    if (file_) {
+        std::fclose(file_);
+        std::remove(path_.c_str());
+    }
+}
+
+bool SnapshotWriter::open(const std::string& path, std::string& error) {
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        error = "Cannot create snapshot '" + path + "': " + std::strerror(errno);
+        return false;
+    }
+    path_ = path;
+
+    // The header is filled in by finish()
+    char header[kSnapshotHeader] = {};
+    if (std::fwrite(header, 1, sizeof(header), file_) != sizeof(header)) {
+        error_ = errno ? errno : EIO;
+    }
+    return true;
+}
+
+void SnapshotWriter::write(const void* data, size_t size) {
+    // The first failure sticks; finish() reports it
+    if (!error_ && std::fwrite(data, 1, size, file_) != size) {
+        error_ = errno ? errno : EIO;
+    }
+    crc_ = crc32(static_cast<const char*>(data), size, crc_);
+    size_ += size;
+}
+
+void SnapshotWriter::putString(const std::string& value) {
+    putU32(static_cast<uint32_t>(value.size()));
+    write(value.data(), value.size());
+}
+
+void SnapshotWriter::align() {
+    static const char padding[8] = {};
+    if (size_ % 8) {
+        write(padding, 8 - size_ % 8);
+    }
+}
+
+bool SnapshotWriter::finish(uint32_t table_count, uint64_t log_lsn, std::string& error) {
+    SnapshotHeader header;
+    std::memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+    header.version = kSnapshotVersion;
+    header.byte_order = kByteOrderMark;
+    header.table_count = table_count;
+    header.body_crc = crc_;
+    header.log_lsn = log_lsn;
+    header.body_size = size_;
+
+    errno = 0;
+    bool ok = !error_ && !std::ferror(file_) &&
+              std::fseek(file_, 0, SEEK_SET) == 0 &&
+              std::fwrite(&header, sizeof(header), 1, file_) == 1 &&
+              std::fflush(file_) == 0 &&
+              ::fsync(::fileno(file_)) == 0;
+    int failure = error_ ? error_ : errno;
+    if (std::fclose(file_) != 0 && ok) {
+        ok = false;
+        failure = errno;
+    }
+    file_ = nullptr;
+    if (!ok) {
+        error = "Cannot write snapshot '" + path_ + "': " + std::strerror(failure ? failure : EIO);
+        std::remove(path_.c_str());
+    }
+    return ok;
+}
+
+SnapshotReader::~SnapshotReader() {
+    if (map_) {
+        ::munmap(map_, map_size_);
+    }
+}
+
+bool SnapshotReader::open(const std::string& path, std::string& error) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0) {
+        error = "Cannot open snapshot '" + path + "': " + std::strerror(errno);
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+
+    map_size_ = static_cast<size_t>(st.st_size);
+    if (map_size_ >= kSnapshotHeader) {
+        map_ = ::mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map_ == MAP_FAILED) {
+            map_ = nullptr;
+        }
+    }
+    ::close(fd);
+    if (!map_) {
+        error = "Cannot map snapshot '" + path + "'";
+        return false;
+    }
+    ::madvise(map_, map_size_, MADV_SEQUENTIAL);
+
+    SnapshotHeader header;
+    std::memcpy(&header, map_, sizeof(header));
+    const char* body = static_cast<const char*>(map_) + kSnapshotHeader;
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof(header.magic)) != 0 ||
+        header.byte_order != kByteOrderMark) {
+        error = "'" + path + "' is not a snapshot for this machine";
+        return false;
+    }
+    if (header.version != kSnapshotVersion) {
+        error = "Snapshot '" + path + "' has unsupported version " + std::to_string(header.version);
+        return false;
+    }
+    if (header.body_size != map_size_ - kSnapshotHeader || crc32(body, header.body_size) != header.body_crc) {
+        error = "Snapshot '" + path + "' is corrupt";
+        return false;
+    }
+
+    pos_ = body;
+    end_ = body + header.body_size;
+    ok_ = true;
+    table_count_ = header.table_count;
+    log_lsn_ = header.log_lsn;
+    return true;
+}
+
+bool SnapshotReader::take(size_t size) {
+    if (!ok_ || static_cast<size_t>(end_ - pos_) < size) {
+        ok_ = false;
+        return false;
+    }
+    return true;
+}
+
+uint8_t SnapshotReader::getU8() {
+    return take(1) ? static_cast<uint8_t>(*pos_++) : 0;
+}
+
+uint32_t SnapshotReader::getU32() {
+    uint32_t value = 0;
+    if (take(4)) {
+        std::memcpy(&value, pos_, 4);
+        pos_ += 4;
+    }
+    return value;
+}
+
+uint64_t SnapshotReader::getU64() {
+    uint64_t value = 0;
+    if (take(8)) {
+        std::memcpy(&value, pos_, 8);
+        pos_ += 8;
+    }
+    return value;
+}
+
+std::string SnapshotReader::getString() {
+    uint32_t length = getU32();
+    if (!take(length)) return std::string();
+    std::string value(pos_, length);
+    pos_ += length;
+    return value;
+}
+
+const void* SnapshotReader::getArray(size_t size) {
+    if (!take(size)) return nullptr;
+    const void* data = pos_;
+    pos_ += size;
+    return data;
+}
+
+void SnapshotReader::align() {
+    size_t offset = static_cast<size_t>(pos_ - static_cast<const char*>(map_));
+    if (offset % 8) {
+        getArray(8 - offset % 8);
+    }
+}
+
+}
@@ -0,0 +1,218 @@
+#include "statistics.h"
+#include "hash.h"
+#include <algorithm>
+#include <cmath>
+
+namespace InMemoryDB {
+
+namespace {
+
+double toNumber(const Value& value) {
+    if (value.isBool()) {
+        return value.asBool() ? 1.0 : 0.0;
+    }
+    return value.isNumber() ? value.asDouble() : 0.0;
+}
+
+// Values of one column, or a column and a literal bound to it
+int compareValues(const Value& a, const Value& b) {
+    if (a.isString() && b.isString()) {
+        int c = a.asString().compare(b.asString());
+        return (c > 0) - (c < 0);
+    }
+    double x = toNumber(a);
+    double y = toNumber(b);
+    return (x > y) - (x < y);
+}
+
+bool valueLess(const Value& a, const Value& b) {
+    return compareValues(a, b) < 0;
+}
+
+// Where value lies between two bucket bounds; strings are taken to lie
+// halfway
+double interpolate(const Value& low, const Value& high, const Value& value) {
+    if (value.isString()) {
+        return 0.5;
+    }
+    double x = toNumber(low);
+    double y = toNumber(high);
+    if (y <= x) {
+        return 0.5;
+    }
+    return std::clamp((toNumber(value) - x) / (y - x), 0.0, 1.0);
+}
+
+// Hashes each non-NULL row into the sketch and offers it to the sample.
+// Reservoir slots are drawn from a hash of the running count, so
+// analyzing the same rows always gives the same sample.
+template <typename HashOf>
+void addRows(ColumnStatistics& stats, const ColumnVector& column, const std::vector<size_t>& positions,
+             HashOf hash_of) {
+    for (size_t pos : positions) {
+        if (column.isNull(pos)) {
+            stats.nulls++;
+            continue;
+        }
+        stats.distinct.add(mixHash(hash_of(pos)));
+        stats.sampled++;
+        if (stats.sample.size() < ColumnStatistics::kSampleSize) {
+            stats.sample.push_back(column.get(pos));
+        } else {
+            uint64_t slot = mixHash(stats.sampled ^ kHashSeed) % stats.sampled;
+            if (slot < ColumnStatistics::kSampleSize) {
+                stats.sample[slot] = column.get(pos);
+            }
+        }
+    }
+    stats.rows += positions.size();
+}
+
+}
+
+double HyperLogLog::estimate() const {
+    double sum = 0;
+    size_t zeros = 0;
+    for (uint8_t reg : registers_) {
+        sum += std::ldexp(1.0, -reg);
+        zeros += reg == 0;
+    }
+    double m = static_cast<double>(kRegisters);
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+
+    // Small counts leave registers empty; linear counting is exact-ish there
+    if (estimate <= 2.5 * m && zeros) {
+        estimate = m * std::log(m / zeros);
+    }
+    return estimate;
+}
+
+void ColumnStatistics::add(const ColumnVector& column, const std::vector<size_t>& positions) {
+    switch (column.type()) {
+        case DataType::INTEGER:
+            addRows(*this, column, positions,
+                    [&](size_t pos) { return static_cast<uint64_t>(int64_t(column.intAt(pos))); });
+            break;
+        case DataType::DOUBLE:
+            addRows(*this, column, positions, [&](size_t pos) { return hashDouble(column.doubleData()[pos]); });
+            break;
+        case DataType::STRING:
+            addRows(*this, column, positions, [&](size_t pos) { return hashString(column.stringAt(pos)); });
+            break;
+        case DataType::BOOLEAN:
+            addRows(*this, column, positions, [&](size_t pos) { return uint64_t(column.boolData().get(pos)); });
+            break;
+    }
+}
+
+void ColumnStatistics::finish() {
+    bounds.clear();
+    if (sample.empty()) {
+        return;
+    }
+    std::vector<Value> sorted = sample;
+    std::sort(sorted.begin(), sorted.end(), valueLess);
+    size_t buckets = std::min(kHistogramBuckets, sorted.size() - 1);
+    if (buckets == 0) {
+        bounds.push_back(sorted[0]);
+        return;
+    }
+    for (size_t i = 0; i <= buckets; ++i) {
+        bounds.push_back(sorted[i * (sorted.size() - 1) / buckets]);
+    }
+}
+
+double ColumnStatistics::distinctCount() const {
+    size_t values = rows - nulls;
+    if (values == 0) {
+        return 0;
+    }
+    return std::clamp(distinct.estimate(), 1.0, static_cast<double>(values));
+}
+
+// A value that fills several buckets is frequent, and its share of the
+// buckets says how frequent; any other value gets an even share
+double ColumnStatistics::equalFraction(const Value& literal) const {
+    if (bounds.empty() || valueLess(literal, bounds.front()) || valueLess(bounds.back(), literal)) {
+        return 0;
+    }
+    auto first = std::lower_bound(bounds.begin(), bounds.end(), literal, valueLess);
+    auto last = std::upper_bound(first, bounds.end(), literal, valueLess);
+    double fraction = 1.0 / distinctCount();
+    size_t buckets = bounds.size() - 1;
+    if (last - first >= 2) {
+        fraction = std::max(fraction, static_cast<double>(last - first - 1) / buckets);
+    }
+    return std::min(fraction, 1.0);
+}
+
+double ColumnStatistics::belowFraction(const Value& literal) const {
+    size_t i = std::lower_bound(bounds.begin(), bounds.end(), literal, valueLess) - bounds.begin();
+    if (i == 0) {
+        return 0;
+    }
+    if (i == bounds.size()) {
+        return 1;
+    }
+    return (i - 1 + interpolate(bounds[i - 1], bounds[i], literal)) / (bounds.size() - 1);
+}
+
+double ColumnStatistics::selectivity(CompareOp op, const Value& literal) const {
+    if (literal.isNull() || bounds.empty()) {
+        return 0;
+    }
+    double fraction = 0;
+    switch (op) {
+        case CompareOp::EQ: fraction = equalFraction(literal); break;
+        case CompareOp::NE: fraction = 1 - equalFraction(literal); break;
+        case CompareOp::LT: fraction = belowFraction(literal); break;
+        case CompareOp::LE: fraction = belowFraction(literal) + equalFraction(literal); break;
+        case CompareOp::GT: fraction = 1 - belowFraction(literal) - equalFraction(literal); break;
+        case CompareOp::GE: fraction = 1 - belowFraction(literal); break;
+    }
+    return std::clamp(fraction, 0.0, 1.0) * (1 - nullFraction());
+}
+
+double ColumnStatistics::rangeSelectivity(const KeyBound& low, const KeyBound& high) const {
+    double upper = high.value ? selectivity(high.inclusive ? CompareOp::LE : CompareOp::LT, *high.value)
+                              : 1 - nullFraction();
+    double lower = low.value ? selectivity(low.inclusive ? CompareOp::LT : CompareOp::LE, *low.value) : 0;
+    return std::max(0.0, upper - lower);
+}
+
+double TableStatistics::selectivity(const Predicate* where) const {
+    if (!where) {
+        return 1;
+    }
+    double fraction = 1;
+    switch (where->kind()) {
+        case Predicate::Kind::COMPARE:
+            return columns[where->columnIndex()].selectivity(where->op(), where->literal());
+        case Predicate::Kind::AND:
+            for (const auto& child : where->children()) {
+                fraction *= selectivity(child.get());
+            }
+            return fraction;
+        case Predicate::Kind::OR:
+            fraction = 0;
+            for (const auto& child : where->children()) {
+                double s = selectivity(child.get());
+                fraction = fraction + s - fraction * s;
+            }
+            return fraction;
+        case Predicate::Kind::NOT:
+            return 1 - selectivity(where->children()[0].get());
+    }
+    return fraction;
+}
+
+const char* accessMethodName(AccessMethod method) {
+    switch (method) {
+        case AccessMethod::SCAN: return "SCAN";
+        case AccessMethod::HASH_INDEX: return "HASH INDEX";
+        case AccessMethod::BTREE_INDEX: return "BTREE INDEX";
+    }
+    return "";
+}
+
+}
@@ -1,63 +1,349 @@
 #include "storage_engine.h"
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <unistd.h>
 
 namespace InMemoryDB {
 
+// Rows moved per compaction step, and how often idle tables are checked
+static constexpr size_t kCompactionStepRows = 4096;
+static constexpr auto kCompactionPollInterval = std::chrono::milliseconds(100);
+
+StorageEngine::StorageEngine()
+    : catalog_(std::make_shared<Catalog>()), compaction_threshold_(0.25), statistics_threshold_(0.1),
+      stopping_(false) {
+    transactions_.setLog(&wal_);
+    compactor_ = std::thread(&StorageEngine::compactorLoop, this);
+}
+
+StorageEngine::~StorageEngine() {
+    {
+        std::lock_guard<std::mutex> lock(compactor_mutex_);
+        stopping_ = true;
+    }
+    compactor_cv_.notify_one();
+    compactor_.join();
+}
+
+void StorageEngine::compactorLoop() {
+    std::unique_lock<std::mutex> lock(compactor_mutex_);
+    while (!stopping_) {
+        compactor_cv_.wait_for(lock, kCompactionPollInterval);
+        if (stopping_) break;
+        
+        lock.unlock();
+        for (const std::string& name : getTableNames()) {
+            compactTable(name);
+            refreshStatistics(name);
+        }
+        lock.lock();
+    }
+}
+
+// Collects dead row versions, then runs compaction in small steps, giving
+// readers and writers the table lock back between steps. Holding the
+// table keeps it alive even if it is dropped meanwhile.
+void StorageEngine::compactTable(const std::string& name) {
+    std::shared_ptr<Table> table = getTable(name);
+    if (!table) {
+        return;
+    }
+    
+    table->collectGarbage(transactions_.oldestSnapshot());
+    if (table->deadRatio() < compaction_threshold_) {
+        return;
+    }
+    
+    while (!stopping_ && table->compactStep(kCompactionStepRows)) {
+        std::this_thread::yield();
+    }
+}
+
+void StorageEngine::refreshStatistics(const std::string& name) {
+    std::shared_ptr<Table> table = getTable(name);
+    if (table && !stopping_ && table->statisticsStale(statistics_threshold_)) {
+        table->analyze();
+    }
+}
+
 bool StorageEngine::createTable(const std::string& name, const std::vector<Column>& columns) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> lock(ddl_mutex_);
     
-    if (tables_.find(name) != tables_.end()) {
+    std::shared_ptr<const Catalog> current = snapshot();
+    if (current->find(name) != current->end()) {
         return false; // Table already exists
     }
     
-    tables_[name] = std::make_unique<Table>(name, columns);
+    auto next = std::make_shared<Catalog>(*current);
+    (*next)[name] = std::make_shared<Table>(name, columns);
+    publish(std::move(next));
+    
+    WalWriter record;
+    record.putString(name);
+    record.putU32(static_cast<uint32_t>(columns.size()));
+    for (const Column& column : columns) {
+        record.putString(column.name);
+        record.putU8(static_cast<uint8_t>(column.type));
+        record.putU8(column.nullable);
+        record.putU8(column.primary_key);
+    }
+    logDDL(WalRecordType::CREATE_TABLE, record);
     return true;
 }
 
 bool StorageEngine::dropTable(const std::string& name) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> lock(ddl_mutex_);
     
-    auto it = tables_.find(name);
-    if (it == tables_.end()) {
+    std::shared_ptr<const Catalog> current = snapshot();
+    if (current->find(name) == current->end()) {
         return false; // Table doesn't exist
     }
     
-    tables_.erase(it);
+    auto next = std::make_shared<Catalog>(*current);
+    next->erase(name);
+    publish(std::move(next));
+    
+    WalWriter record;
+    record.putString(name);
+    logDDL(WalRecordType::DROP_TABLE, record);
     return true;
 }
 
-Table* StorageEngine::getTable(const std::string& name) {
-    std::lock_guard<std::mutex> lock(mutex_);
+std::shared_ptr<Table> StorageEngine::getTable(const std::string& name) const {
+    std::shared_ptr<const Catalog> current = snapshot();
     
-    auto it = tables_.find(name);
-    if (it == tables_.end()) {
+    auto it = current->find(name);
+    if (it == current->end()) {
         return nullptr;
     }
     
-    return it->second.get();
+    return it->second;
 }
 
 std::vector<std::string> StorageEngine::getTableNames() const {
-    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_ptr<const Catalog> current = snapshot();
     
     std::vector<std::string> names;
-    for (const auto& pair : tables_) {
+    for (const auto& pair : *current) {
         names.push_back(pair.first);
     }
     
     return names;
 }
 
-void StorageEngine::beginTransaction() {
-    // Transaction implementation would go here
+bool StorageEngine::createIndex(const std::string& index_name, const std::string& table_name,
+                                const std::string& column_name, IndexType type) {
+    // Index names live in the tables, so DDL is serialized to keep them unique
+    std::lock_guard<std::mutex> lock(ddl_mutex_);
+    
+    std::shared_ptr<const Catalog> current = snapshot();
+    for (const auto& pair : *current) {
+        if (!pair.second->indexedColumn(index_name).empty()) {
+            return false; // Index name already in use
+        }
+    }
+    
+    auto it = current->find(table_name);
+    if (it == current->end()) {
+        return false;
+    }
+    
+    if (!it->second->createIndex(column_name, type, index_name)) {
+        return false;
+    }
+    
+    WalWriter record;
+    record.putString(index_name);
+    record.putString(table_name);
+    record.putString(column_name);
+    record.putU8(static_cast<uint8_t>(type));
+    logDDL(WalRecordType::CREATE_INDEX, record);
+    return true;
+}
+
+bool StorageEngine::dropIndex(const std::string& index_name) {
+    std::lock_guard<std::mutex> lock(ddl_mutex_);
+    
+    std::shared_ptr<const Catalog> current = snapshot();
+    for (const auto& pair : *current) {
+        std::string column_name = pair.second->indexedColumn(index_name);
+        if (!column_name.empty()) {
+            if (!pair.second->dropIndex(column_name)) {
+                return false;
+            }
+            WalWriter record;
+            record.putString(index_name);
+            logDDL(WalRecordType::DROP_INDEX, record);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+// DDL is rare, so it simply waits for its own record to be durable
+void StorageEngine::logDDL(WalRecordType type, const WalWriter& record) {
+    if (wal_.isOpen()) {
+        wal_.waitDurable(wal_.append(type, record));
+    }
+}
+
+bool StorageEngine::openLog(const std::string& path, Durability durability, std::string& error) {
+    if (wal_.isOpen()) {
+        error = "Write-ahead log is already open";
+        return false;
+    }
+    
+    // Start from the latest snapshot, if there is one, and replay only
+    // the log records written after it
+    uint64_t start_lsn = 0;
+    std::string snapshot_path = path + ".snapshot";
+    if (::access(snapshot_path.c_str(), F_OK) == 0) {
+        SnapshotReader snapshot;
+        if (!snapshot.open(snapshot_path, error) || !loadSnapshot(snapshot, error)) {
+            return false;
+        }
+        start_lsn = snapshot.logLsn();
+    }
+    
+    // Logged row ids differ from replayed ones, because ids burned by
+    // rolled-back transactions are never logged
+    std::unordered_map<std::string, std::unordered_map<RowId, RowId>> row_ids;
+    return wal_.open(path, durability, start_lsn, [&](WalRecordType type, WalReader& record) {
+        replay(type, record, row_ids);
+    }, error);
+}
+
+bool StorageEngine::checkpoint(std::string& error) {
+    if (!wal_.isOpen()) {
+        error = "CHECKPOINT needs a write-ahead log";
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(ddl_mutex_);
+    
+    // The snapshot holds exactly the commits logged before lsn
+    uint64_t lsn;
+    std::shared_ptr<Transaction> txn = transactions_.beginAtLogPosition(lsn);
+    std::shared_ptr<const Catalog> current = snapshot();
+    
+    std::string path = wal_.path() + ".snapshot";
+    std::string temp_path = path + ".tmp";
+    SnapshotWriter out;
+    if (!out.open(temp_path, error)) {
+        return false;
+    }
+    for (const auto& pair : *current) {
+        out.putString(pair.first);
+        const std::vector<Column>& columns = pair.second->getColumns();
+        out.putU32(static_cast<uint32_t>(columns.size()));
+        for (const Column& column : columns) {
+            out.putString(column.name);
+            out.putU8(static_cast<uint8_t>(column.type));
+            out.putU8(column.nullable);
+            out.putU8(column.primary_key);
+        }
+        pair.second->writeSnapshot(out, txn->view());
+    }
+    if (!out.finish(static_cast<uint32_t>(current->size()), lsn, error)) {
+        return false;
+    }
+    
+    // Read the snapshot back before the log records it covers are dropped
+    {
+        SnapshotReader written;
+        bool verified = written.open(temp_path, error);
+        if (verified && (written.logLsn() != lsn || written.tableCount() != current->size())) {
+            error = "Snapshot '" + temp_path + "' does not match what was written";
+            verified = false;
+        }
+        if (!verified) {
+            std::remove(temp_path.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0 || !syncParentDirectory(path)) {
+        error = "Cannot install snapshot '" + path + "'";
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return wal_.discardBefore(lsn, error);
 }
 
-void StorageEngine::commit() {
-    // Commit implementation would go here
+bool StorageEngine::loadSnapshot(SnapshotReader& in, std::string& error) {
+    for (uint32_t t = 0; t < in.tableCount() && in.ok(); ++t) {
+        std::string name = in.getString();
+        std::vector<Column> columns;
+        uint32_t count = in.getU32();
+        for (uint32_t i = 0; i < count && in.ok(); ++i) {
+            std::string column_name = in.getString();
+            DataType type = static_cast<DataType>(in.getU8());
+            bool nullable = in.getU8() != 0;
+            bool primary_key = in.getU8() != 0;
+            columns.emplace_back(column_name, type, nullable, primary_key);
+        }
+        
+        if (!in.ok() || !createTable(name, columns) || !getTable(name)->loadSnapshot(in)) {
+            error = "Snapshot is damaged at table '" + name + "'";
+            return false;
+        }
+    }
+    return true;
 }
 
-void StorageEngine::rollback() {
-    // Rollback implementation would go here
+void StorageEngine::replay(WalRecordType type, WalReader& record,
+                           std::unordered_map<std::string, std::unordered_map<RowId, RowId>>& row_ids) {
+    switch (type) {
+        case WalRecordType::CREATE_TABLE: {
+            std::string name = record.getString();
+            std::vector<Column> columns;
+            uint32_t count = record.getU32();
+            for (uint32_t i = 0; i < count && record.ok(); ++i) {
+                std::string column_name = record.getString();
+                DataType column_type = static_cast<DataType>(record.getU8());
+                bool nullable = record.getU8() != 0;
+                bool primary_key = record.getU8() != 0;
+                columns.emplace_back(column_name, column_type, nullable, primary_key);
+            }
+            if (record.ok()) {
+                createTable(name, columns);
+            }
+            break;
+        }
+        case WalRecordType::DROP_TABLE: {
+            std::string name = record.getString();
+            dropTable(name);
+            row_ids.erase(name);
+            break;
+        }
+        case WalRecordType::CREATE_INDEX: {
+            std::string index_name = record.getString();
+            std::string table_name = record.getString();
+            std::string column_name = record.getString();
+            IndexType index_type = static_cast<IndexType>(record.getU8());
+            if (record.ok()) {
+                createIndex(index_name, table_name, column_name, index_type);
+            }
+            break;
+        }
+        case WalRecordType::DROP_INDEX:
+            dropIndex(record.getString());
+            break;
+        case WalRecordType::COMMIT: {
+            uint32_t tables = record.getU32();
+            for (uint32_t i = 0; i < tables && record.ok(); ++i) {
+                std::string name = record.getString();
+                std::string writes = record.getString();
+                WalReader section(writes);
+                std::shared_ptr<Table> table = getTable(name);
+                if (table) {
+                    table->replayWrites(section, row_ids[name]);
+                }
+            }
+            break;
+        }
+    }
 }
 
-}
\ No newline at end of file
+}
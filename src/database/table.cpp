@@ -5,8 +5,11 @@
 #include <vector>
 #include <tuple>
 #include <algorithm>
+#include <cmath>
 #include "table.h"
 #include "storage_engine.h"
+#include "session.h"
+#include "thread_pool.h"
 
 // Function to execute a SQL query
 bool executeQuery(const std::string& query);
@@ -17,108 +20,1266 @@ std::vector<std::tuple<int, std::string, bool>> fetchResults(const std::string&
 namespace InMemoryDB {
 
 Table::Table(const std::string& name, const std::vector<Column>& columns)
-    : name_(name), columns_(columns) {
+    : name_(name), columns_(columns), row_count_(0), dead_count_(0),
+      compacting_(false), compact_read_(0), compact_write_(0), pin_count_(0), ended_versions_(0),
+      modifications_(0), rewrites_(0) {
+    data_.reserve(columns_.size());
+    for (const Column& column : columns_) {
+        data_.emplace_back(column.type);
+    }
+    indexes_.resize(columns_.size());
+    index_names_.resize(columns_.size());
+}
+
+int Table::findColumn(const std::string& column_name) const {
+    for (size_t i = 0; i < columns_.size(); ++i) {
+        if (columns_[i].name == column_name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+bool Table::accepts(const Row& row) const {
+    for (size_t i = 0; i < row.size(); ++i) {
+        if (!data_[i].accepts(row[i])) {
+            return false; // Type mismatch
+        }
+        if (!columns_[i].nullable && row[i].isNull()) {
+            return false; // NULL constraint violation
+        }
+    }
+    return true;
+}
+
+bool Table::resolveColumns(const std::vector<std::string>& column_names, std::vector<int>& indices) const {
+    for (const std::string& col_name : column_names) {
+        int index = findColumn(col_name);
+        if (index < 0) {
+            return false;
+        }
+        indices.push_back(index);
+    }
+    return true;
 }
 
-bool Table::insert(const Row& row) {
-    std::lock_guard<std::mutex> lock(mutex_);
+bool Table::insert(const Row& row, Transaction* txn) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
     
     if (row.size() != columns_.size()) {
         return false; // Column count mismatch
     }
     
-    // Validate data types and constraints
-    for (size_t i = 0; i < row.size(); ++i) {
-        // Type validation would go here
-        if (!columns_[i].nullable && std::holds_alternative<std::string>(row[i]) && 
-            std::get<std::string>(row[i]).empty()) {
-            return false; // NULL constraint violation
+    // Validate everything up front so a bad value never leaves a partial row
+    if (!accepts(row)) {
+        return false;
+    }
+    
+    RowId row_id = static_cast<RowId>(slots_.size());
+    appendRow(row, txn ? txn->marker() : 0);
+    if (txn) {
+        txn->writesFor(shared_from_this()).inserted.push_back(row_id);
+    }
+    return true;
+}
+
+bool Table::insertBatch(const Row* rows, size_t count, Transaction* txn) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    
+    for (size_t i = 0; i < count; ++i) {
+        if (rows[i].size() != columns_.size()) {
+            return false;
+        }
+    }
+    
+    // Column at a time, so type checks and appends dispatch on the column
+    // type once per batch rather than once per value
+    for (size_t col = 0; col < columns_.size(); ++col) {
+        for (size_t i = 0; i < count; ++i) {
+            const Row& row = rows[i];
+            if (!data_[col].accepts(row[col]) ||
+                (!columns_[col].nullable && row[col].isNull())) {
+                return false;
+            }
         }
     }
     
-    rows_.push_back(row);
+    RowId first_id = static_cast<RowId>(slots_.size());
+    for (size_t col = 0; col < columns_.size(); ++col) {
+        data_[col].appendColumn(rows, count, col);
+        if (indexes_[col]) {
+            for (size_t row = 0; row < count; ++row) {
+                indexes_[col]->insert(rows[row][col], first_id + static_cast<RowId>(row));
+            }
+        }
+    }
+    appendSlots(count, txn);
     return true;
 }
 
-bool Table::update(const std::vector<int>& row_indices, const Row& new_values) {
-    std::lock_guard<std::mutex> lock(mutex_);
+bool Table::insertColumns(const std::vector<ColumnVector>& columns, Transaction* txn) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
     
-    for (int index : row_indices) {
-        if (index >= 0 && index < static_cast<int>(rows_.size())) {
-            // Update specific columns based on new_values
-            for (size_t i = 0; i < new_values.size() && i < rows_[index].size(); ++i) {
-                rows_[index][i] = new_values[i];
+    if (columns.size() != columns_.size()) {
+        return false;
+    }
+    size_t count = columns.empty() ? 0 : columns[0].size();
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (columns[i].type() != columns_[i].type || columns[i].size() != count) {
+            return false;
+        }
+        if (!columns_[i].nullable) {
+            for (size_t row = 0; row < count; ++row) {
+                if (columns[i].isNull(row)) {
+                    return false;
+                }
             }
         }
     }
     
+    RowId first_id = static_cast<RowId>(slots_.size());
+    for (size_t i = 0; i < columns.size(); ++i) {
+        data_[i].appendFrom(columns[i]);
+        if (indexes_[i]) {
+            for (size_t row = 0; row < count; ++row) {
+                indexes_[i]->insert(columns[i].get(row), first_id + static_cast<RowId>(row));
+            }
+        }
+    }
+    appendSlots(count, txn);
     return true;
 }
 
-bool Table::deleteRows(const std::vector<int>& row_indices) {
-    std::lock_guard<std::mutex> lock(mutex_);
+void Table::appendSlots(size_t count, Transaction* txn) {
+    RowId first_id = static_cast<RowId>(slots_.size());
+    TableWrites* writes = txn ? &txn->writesFor(shared_from_this()) : nullptr;
+    uint64_t begin_ts = txn ? txn->marker() : 0;
+    for (size_t row = 0; row < count; ++row) {
+        RowId row_id = first_id + static_cast<RowId>(row);
+        slots_.push_back(static_cast<uint32_t>(row_count_ + row));
+        row_ids_.push_back(row_id);
+        deleted_.push_back(false);
+        if (writes) {
+            writes->inserted.push_back(row_id);
+        }
+    }
+    begin_ts_.resize(begin_ts_.size() + count, begin_ts);
+    end_ts_.resize(end_ts_.size() + count, kInfinity);
+    row_count_ += count;
+    modifications_ += count;
+}
+
+void Table::appendRow(const Row& row, uint64_t begin_ts) {
+    RowId row_id = static_cast<RowId>(slots_.size());
+    slots_.push_back(static_cast<uint32_t>(row_count_));
+    row_ids_.push_back(row_id);
+    for (size_t i = 0; i < row.size(); ++i) {
+        data_[i].append(row[i]);
+        if (indexes_[i]) {
+            indexes_[i]->insert(row[i], row_id);
+        }
+    }
+    deleted_.push_back(false);
+    begin_ts_.push_back(begin_ts);
+    end_ts_.push_back(kInfinity);
+    row_count_++;
+    modifications_++;
+}
+
+void Table::positionsOf(const std::vector<RowId>& row_ids, std::vector<size_t>& positions) const {
+    for (RowId id : row_ids) {
+        if (id >= 0 && id < static_cast<RowId>(slots_.size()) && slots_[id] != kTombstone) {
+            positions.push_back(slots_[id]);
+        }
+    }
+    std::sort(positions.begin(), positions.end());
+    positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+}
+
+bool Table::acceptsValues(const std::vector<int>& column_indices, const Row& values) const {
+    for (size_t i = 0; i < column_indices.size(); ++i) {
+        int col = column_indices[i];
+        if (!data_[col].accepts(values[i]) ||
+            (!columns_[col].nullable && values[i].isNull())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Table::updatePositions(const std::vector<size_t>& positions, const std::vector<int>& column_indices,
+                            const Row& new_values) {
+    if (!acceptsValues(column_indices, new_values)) {
+        return false;
+    }
+    
+    for (size_t pos : positions) {
+        RowId row_id = row_ids_[pos];
+        for (size_t i = 0; i < column_indices.size(); ++i) {
+            int col = column_indices[i];
+            if (indexes_[col]) {
+                indexes_[col]->remove(data_[col].get(pos), row_id);
+                indexes_[col]->insert(new_values[i], row_id);
+            }
+            data_[col].set(pos, new_values[i]);
+        }
+    }
+    modifications_ += positions.size();
+    rewrites_ += !positions.empty();
+    return true;
+}
+
+bool Table::update(const std::vector<RowId>& row_ids, const Row& new_values) {
+    // Update leading columns based on new_values
+    std::vector<std::string> column_names;
+    for (size_t i = 0; i < new_values.size() && i < columns_.size(); ++i) {
+        column_names.push_back(columns_[i].name);
+    }
+    Row values(new_values.begin(), new_values.begin() + column_names.size());
+    return update(row_ids, column_names, values);
+}
+
+bool Table::update(const std::vector<RowId>& row_ids, const std::vector<std::string>& column_names,
+                   const Row& new_values) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    
+    std::vector<int> column_indices;
+    if (column_names.size() != new_values.size() || !resolveColumns(column_names, column_indices)) {
+        return false;
+    }
+    
+    std::vector<size_t> positions;
+    positionsOf(row_ids, positions);
+    return updatePositions(positions, column_indices, new_values);
+}
+
+bool Table::updateWhere(const Predicate* where, const std::vector<std::string>& column_names,
+                        const Row& new_values, size_t& affected, Transaction* txn) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    
+    std::vector<int> column_indices;
+    if (column_names.size() != new_values.size() || !resolveColumns(column_names, column_indices)) {
+        return false;
+    }
     
-    // Sort indices in descending order to avoid index shifting issues
-    std::vector<int> sorted_indices = row_indices;
-    std::sort(sorted_indices.rbegin(), sorted_indices.rend());
+    std::vector<size_t> positions;
+    filterPositions(where, txn ? txn->view() : ReadView(), positions);
     
-    for (int index : sorted_indices) {
-        if (index >= 0 && index < static_cast<int>(rows_.size())) {
-            rows_.erase(rows_.begin() + index);
+    if (!txn) {
+        if (!updatePositions(positions, column_indices, new_values)) {
+            return false;
         }
+        affected = positions.size();
+        return true;
     }
     
+    if (!acceptsValues(column_indices, new_values) || !endVersions(positions, *txn)) {
+        return false;
+    }
+    
+    // Each updated row gets a new version holding the new values
+    TableWrites& writes = txn->writesFor(shared_from_this());
+    Row row(columns_.size());
+    for (size_t pos : positions) {
+        for (size_t i = 0; i < columns_.size(); ++i) {
+            row[i] = data_[i].get(pos);
+        }
+        for (size_t i = 0; i < column_indices.size(); ++i) {
+            row[column_indices[i]] = new_values[i];
+        }
+        writes.inserted.push_back(static_cast<RowId>(slots_.size()));
+        appendRow(row, txn->marker());
+    }
+    affected = positions.size();
     return true;
 }
 
+// Ends the given versions on behalf of txn. A version already ended by
+// another writer is a write-write conflict: the first writer wins and txn
+// is doomed.
+bool Table::endVersions(const std::vector<size_t>& positions, Transaction& txn) {
+    for (size_t pos : positions) {
+        if (end_ts_[pos] != kInfinity) {
+            txn.doom();
+            return false;
+        }
+    }
+    
+    TableWrites& writes = txn.writesFor(shared_from_this());
+    for (size_t pos : positions) {
+        end_ts_[pos] = txn.marker();
+        writes.deleted.push_back(row_ids_[pos]);
+    }
+    modifications_ += positions.size();
+    rewrites_ += !positions.empty();
+    return true;
+}
+
+// Marks rows deleted; their storage is reclaimed later by compaction
+void Table::deletePositions(std::vector<size_t>& positions) {
+    for (size_t pos : positions) {
+        RowId row_id = row_ids_[pos];
+        for (size_t i = 0; i < indexes_.size(); ++i) {
+            if (indexes_[i]) {
+                indexes_[i]->remove(data_[i].get(pos), row_id);
+            }
+        }
+        slots_[row_id] = kTombstone;
+        deleted_.set(pos, true);
+    }
+    dead_count_ += positions.size();
+    modifications_ += positions.size();
+    rewrites_ += !positions.empty();
+}
+
+bool Table::deleteRows(const std::vector<RowId>& row_ids) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    
+    std::vector<size_t> positions;
+    positionsOf(row_ids, positions);
+    deletePositions(positions);
+    return true;
+}
+
+bool Table::deleteWhere(const Predicate* where, size_t& affected, Transaction* txn) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    
+    std::vector<size_t> positions;
+    filterPositions(where, txn ? txn->view() : ReadView(), positions);
+    
+    if (!txn) {
+        deletePositions(positions);
+    } else if (!endVersions(positions, *txn)) {
+        return false;
+    }
+    affected = positions.size();
+    return true;
+}
+
+void Table::finishWrites(const TableWrites& writes, uint64_t marker, uint64_t commit_ts) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    
+    for (RowId row_id : writes.deleted) {
+        uint32_t pos = slots_[row_id];
+        if (pos == kTombstone || end_ts_[pos] != marker) {
+            continue;
+        }
+        if (commit_ts) {
+            end_ts_[pos] = commit_ts;
+            ended_versions_++;
+        } else {
+            end_ts_[pos] = kInfinity;
+        }
+    }
+    
+    std::vector<size_t> rolled_back;
+    for (RowId row_id : writes.inserted) {
+        uint32_t pos = slots_[row_id];
+        if (pos == kTombstone) {
+            continue;
+        }
+        if (commit_ts) {
+            begin_ts_[pos] = commit_ts;
+        } else {
+            rolled_back.push_back(pos);
+        }
+    }
+    deletePositions(rolled_back);
+}
+
+void Table::encodeWrites(const TableWrites& writes, WalWriter& out) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    
+    out.putU32(static_cast<uint32_t>(writes.inserted.size()));
+    for (RowId row_id : writes.inserted) {
+        uint32_t pos = slots_[row_id];
+        out.putU32(static_cast<uint32_t>(row_id));
+        for (const ColumnVector& column : data_) {
+            out.putValue(column.get(pos));
+        }
+    }
+    
+    out.putU32(static_cast<uint32_t>(writes.deleted.size()));
+    for (RowId row_id : writes.deleted) {
+        out.putU32(static_cast<uint32_t>(row_id));
+    }
+}
+
+bool Table::replayWrites(WalReader& in, std::unordered_map<RowId, RowId>& ids) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    
+    Row row(columns_.size());
+    uint32_t inserted = in.getU32();
+    for (uint32_t i = 0; i < inserted && in.ok(); ++i) {
+        RowId logged_id = static_cast<RowId>(in.getU32());
+        for (Value& value : row) {
+            value = in.getValue();
+        }
+        if (!in.ok() || !accepts(row)) {
+            return false;
+        }
+        ids[logged_id] = static_cast<RowId>(slots_.size());
+        appendRow(row, 0);
+    }
+    
+    // Rows loaded from a snapshot kept their ids, so ids not inserted by
+    // the replayed log map to themselves
+    std::vector<RowId> deleted;
+    uint32_t count = in.getU32();
+    for (uint32_t i = 0; i < count && in.ok(); ++i) {
+        RowId logged_id = static_cast<RowId>(in.getU32());
+        auto it = ids.find(logged_id);
+        if (it != ids.end()) {
+            deleted.push_back(it->second);
+            ids.erase(it);
+        } else {
+            deleted.push_back(logged_id);
+        }
+    }
+    
+    std::vector<size_t> positions;
+    positionsOf(deleted, positions);
+    deletePositions(positions);
+    return in.ok();
+}
+
+void Table::writeSnapshot(SnapshotWriter& out, const ReadView& view) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    
+    std::vector<size_t> positions;
+    filterPositions(nullptr, view, positions);
+    size_t n = positions.size();
+    
+    out.putU64(n);
+    out.putU64(slots_.size());  // next row id
+    
+    std::vector<int32_t> ids(n);
+    for (size_t i = 0; i < n; ++i) {
+        ids[i] = row_ids_[positions[i]];
+    }
+    out.align();
+    out.write(ids.data(), n * sizeof(int32_t));
+    
+    // Each column is written compacted: validity words, then its values
+    for (const ColumnVector& column : data_) {
+        Bitmap validity;
+        validity.reserve(n);
+        for (size_t pos : positions) {
+            validity.push_back(!column.isNull(pos));
+        }
+        out.align();
+        out.write(validity.words(), (n + 63) / 64 * sizeof(uint64_t));
+        out.align();
+        
+        switch (column.type()) {
+            case DataType::INTEGER: {
+                std::vector<int32_t> values(n);
+                for (size_t i = 0; i < n; ++i) values[i] = column.intAt(positions[i]);
+                out.write(values.data(), n * sizeof(int32_t));
+                break;
+            }
+            case DataType::DOUBLE: {
+                std::vector<double> values(n);
+                for (size_t i = 0; i < n; ++i) values[i] = column.doubleData()[positions[i]];
+                out.write(values.data(), n * sizeof(double));
+                break;
+            }
+            case DataType::BOOLEAN: {
+                Bitmap values;
+                values.reserve(n);
+                for (size_t pos : positions) values.push_back(column.boolData().get(pos));
+                out.write(values.words(), (n + 63) / 64 * sizeof(uint64_t));
+                break;
+            }
+            case DataType::STRING: {
+                std::vector<StringRef> refs(n);
+                std::string heap;
+                for (size_t i = 0; i < n; ++i) {
+                    std::string_view value = column.stringAt(positions[i]);
+                    refs[i] = StringRef{heap.size(), static_cast<uint32_t>(value.size())};
+                    heap.append(value);
+                }
+                out.write(refs.data(), n * sizeof(StringRef));
+                out.putU64(heap.size());
+                out.write(heap.data(), heap.size());
+                break;
+            }
+        }
+    }
+    
+    uint32_t index_count = 0;
+    for (const auto& index : indexes_) {
+        index_count += index != nullptr;
+    }
+    out.putU32(index_count);
+    for (size_t i = 0; i < indexes_.size(); ++i) {
+        if (indexes_[i]) {
+            out.putString(index_names_[i]);
+            out.putString(columns_[i].name);
+            out.putU8(static_cast<uint8_t>(indexes_[i]->type()));
+        }
+    }
+}
+
+bool Table::loadSnapshot(SnapshotReader& in) {
+    {
+        std::lock_guard<std::shared_mutex> lock(mutex_);
+        
+        uint64_t n = in.getU64();
+        uint64_t next_row_id = in.getU64();
+        in.align();
+        const int32_t* ids = static_cast<const int32_t*>(in.getArray(n * sizeof(int32_t)));
+        if (!in.ok() || n > next_row_id || next_row_id > kTombstone) {
+            return false;
+        }
+        
+        size_t words = (n + 63) / 64;
+        for (ColumnVector& column : data_) {
+            in.align();
+            const uint64_t* validity = static_cast<const uint64_t*>(in.getArray(words * sizeof(uint64_t)));
+            in.align();
+            
+            const void* values = nullptr;
+            const char* heap = nullptr;
+            size_t heap_bytes = 0;
+            switch (column.type()) {
+                case DataType::INTEGER: values = in.getArray(n * sizeof(int32_t)); break;
+                case DataType::DOUBLE: values = in.getArray(n * sizeof(double)); break;
+                case DataType::BOOLEAN: values = in.getArray(words * sizeof(uint64_t)); break;
+                case DataType::STRING:
+                    values = in.getArray(n * sizeof(StringRef));
+                    heap_bytes = in.getU64();
+                    heap = static_cast<const char*>(in.getArray(heap_bytes));
+                    break;
+            }
+            if (!in.ok() || !column.load(n, values, validity, heap, heap_bytes)) {
+                return false;
+            }
+        }
+        
+        row_ids_.assign(ids, ids + n);
+        slots_.assign(next_row_id, kTombstone);
+        for (size_t i = 0; i < n; ++i) {
+            if (ids[i] < 0 || static_cast<uint64_t>(ids[i]) >= next_row_id) {
+                return false;
+            }
+            slots_[ids[i]] = static_cast<uint32_t>(i);
+        }
+        deleted_.clear();
+        deleted_.resize(n);
+        begin_ts_.assign(n, 0);
+        end_ts_.assign(n, kInfinity);
+        row_count_ = n;
+        dead_count_ = 0;
+    }
+    
+    // Indexes are rebuilt by bulk load rather than stored
+    uint32_t index_count = in.getU32();
+    for (uint32_t i = 0; i < index_count && in.ok(); ++i) {
+        std::string index_name = in.getString();
+        std::string column_name = in.getString();
+        IndexType type = static_cast<IndexType>(in.getU8());
+        if (in.ok() && !createIndex(column_name, type, index_name)) {
+            return false;
+        }
+    }
+    return in.ok();
+}
+
+size_t Table::collectGarbage(uint64_t oldest_snapshot) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    
+    if (ended_versions_ == 0) {
+        return 0;
+    }
+    
+    std::vector<size_t> positions;
+    size_t remaining = 0;
+    for (size_t pos = 0; pos < row_count_; ++pos) {
+        uint64_t end = end_ts_[pos];
+        if (end >= kUncommitted || deleted_.get(pos)) {
+            continue;
+        }
+        if (end <= oldest_snapshot) {
+            positions.push_back(pos);
+        } else {
+            remaining++;
+        }
+    }
+    deletePositions(positions);
+    ended_versions_ = remaining;
+    return positions.size();
+}
+
+std::unique_ptr<ResultCursor> Table::openCursor(const std::vector<std::string>& column_names,
+                                               std::unique_ptr<Predicate> where,
+                                               std::shared_ptr<Transaction> txn, PlanNode* access) {
+    ProfileScope scope(access ? &access->profile : nullptr);
+    std::shared_lock<std::shared_mutex> lock = sharedLock(mutex_);
+    
+    std::vector<int> column_indices;
+    if (column_names.empty()) {
+        for (size_t i = 0; i < columns_.size(); ++i) {
+            column_indices.push_back(static_cast<int>(i));
+        }
+    } else if (!resolveColumns(column_names, column_indices)) {
+        return nullptr;
+    }
+    
+    return std::make_unique<TableCursor>(shared_from_this(), std::move(column_indices), std::move(where),
+                                         std::move(txn), access);
+}
+
+std::vector<RowId> Table::findRows(const Predicate* where) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    
+    std::vector<size_t> positions;
+    filterPositions(where, ReadView(), positions);
+    
+    std::vector<RowId> result;
+    result.reserve(positions.size());
+    for (size_t pos : positions) {
+        result.push_back(row_ids_[pos]);
+    }
+    return result;
+}
+
 QueryResult Table::select(const std::vector<std::string>& column_names) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    return scan(column_names, nullptr);
+}
+
+QueryResult Table::selectWhere(const Predicate& where, const std::vector<std::string>& column_names) {
+    return scan(column_names, &where);
+}
+
+QueryResult Table::scan(const std::vector<std::string>& column_names, const Predicate* where) {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
     
     QueryResult result;
     result.success = true;
     
+    std::vector<int> column_indices;
     if (column_names.empty()) {
         // Select all columns
         result.columns = columns_;
-        result.rows = rows_;
+        for (size_t i = 0; i < columns_.size(); ++i) {
+            column_indices.push_back(static_cast<int>(i));
+        }
     } else {
         // Select specific columns
-        std::vector<int> column_indices;
         for (const std::string& col_name : column_names) {
-            for (size_t i = 0; i < columns_.size(); ++i) {
-                if (columns_[i].name == col_name) {
-                    column_indices.push_back(i);
-                    result.columns.push_back(columns_[i]);
-                    break;
+            int index = findColumn(col_name);
+            if (index >= 0) {
+                column_indices.push_back(index);
+                result.columns.push_back(columns_[index]);
+            }
+        }
+    }
+    
+    std::vector<size_t> selected;
+    filterPositions(where, ReadView(), selected);
+    
+    // Only the projected column vectors are read; morsels of the output
+    // are filled in parallel, each into its own slice of result.rows
+    result.rows.resize(selected.size());
+    size_t morsels = (selected.size() + kMorselSize - 1) / kMorselSize;
+    ThreadPool::instance().parallelFor(morsels, Session::current().parallelism, [&](size_t m) {
+        size_t begin = m * kMorselSize;
+        size_t end = std::min(selected.size(), begin + kMorselSize);
+        for (size_t i = begin; i < end; ++i) {
+            result.rows[i].reserve(column_indices.size());
+        }
+        for (int index : column_indices) {
+            const ColumnVector& column = data_[index];
+            for (size_t i = begin; i < end; ++i) {
+                result.rows[i].push_back(column.get(selected[i]));
+            }
+        }
+    });
+    
+    return result;
+}
+
+QueryResult Table::selectOrdered(const std::vector<std::string>& column_names, const Predicate* where,
+                                 const ReadView& view, const std::vector<SortKey>& order, size_t limit,
+                                 PlanNode* plan) const {
+    ProfileScope scope(plan ? &plan->profile : nullptr);
+    std::shared_lock<std::shared_mutex> lock = sharedLock(mutex_);
+    
+    QueryResult result;
+    std::vector<int> column_indices;
+    if (column_names.empty()) {
+        for (size_t i = 0; i < columns_.size(); ++i) {
+            column_indices.push_back(static_cast<int>(i));
+        }
+    } else if (!resolveColumns(column_names, column_indices)) {
+        result.error_message = "Unknown column in select list";
+        return result;
+    }
+    std::vector<int> key_columns;
+    for (const SortKey& key : order) {
+        int index = findColumn(key.column);
+        if (index < 0) {
+            result.error_message = "Unknown column '" + key.column + "' in ORDER BY";
+            return result;
+        }
+        key_columns.push_back(index);
+    }
+    
+    // Sort positions by their normalized keys; the projected columns are
+    // read only for the rows that survive the limit
+    size_t parallelism = Session::current().parallelism;
+    std::vector<size_t> selected;
+    filterPositions(where, view, selected, plan ? plan->child(0) : nullptr);
+    std::vector<size_t> ordered = sortIndexes(selected.size(), [&](size_t i, std::string& out) {
+        for (size_t k = 0; k < order.size(); ++k) {
+            appendSortKey(data_[key_columns[k]], selected[i], order[k].descending, out);
+        }
+    }, limit, parallelism);
+    
+    result.success = true;
+    for (int index : column_indices) {
+        result.columns.push_back(columns_[index]);
+    }
+    result.rows.resize(ordered.size());
+    size_t morsels = (ordered.size() + kMorselSize - 1) / kMorselSize;
+    ThreadPool::instance().parallelFor(morsels, parallelism, [&](size_t m) {
+        size_t begin = m * kMorselSize;
+        size_t end = std::min(ordered.size(), begin + kMorselSize);
+        for (size_t i = begin; i < end; ++i) {
+            result.rows[i].reserve(column_indices.size());
+        }
+        for (int index : column_indices) {
+            const ColumnVector& column = data_[index];
+            for (size_t i = begin; i < end; ++i) {
+                result.rows[i].push_back(column.get(selected[ordered[i]]));
+            }
+        }
+    });
+    if (plan) {
+        plan->profile.rows_in += selected.size();
+        plan->profile.rows_out += ordered.size();
+    }
+    
+    return result;
+}
+
+QueryResult Table::aggregate(const std::vector<SelectItem>& items, const std::vector<std::string>& group_by,
+                             const Predicate* where, const ReadView& view, PlanNode* plan) const {
+    OperatorProfile* profile = plan ? &plan->profile : nullptr;
+    PlanNode* access = plan ? plan->child(0) : nullptr;
+    ProfileScope scope(profile);
+    std::shared_lock<std::shared_mutex> lock = sharedLock(mutex_);
+    
+    QueryResult result;
+    HashAggregator aggregator(data_);
+    if (!aggregator.bind(columns_, items, group_by, result.error_message)) {
+        return result;
+    }
+    
+    size_t parallelism = Session::current().parallelism;
+    std::vector<size_t> selected;
+    bool indexed;
+    {
+        ProfileScope access_scope(access ? &access->profile : nullptr);
+        indexed = filterByIndex(where, view, selected, access);
+    }
+    if (indexed) {
+        aggregator.start(1);
+        aggregator.consume(0, selected.data(), selected.size());
+        aggregator.finish(parallelism, result);
+        if (plan) {
+            access->profile.rows_out += selected.size();
+            profile->rows_in += selected.size();
+            profile->rows_out += result.rows.size();
+        }
+        return result;
+    }
+    
+    // Each worker filters the morsels it claims and pre-aggregates them
+    // into its own groups; no rows are materialized
+    size_t morsels = (row_count_ + kMorselSize - 1) / kMorselSize;
+    size_t workers = std::max<size_t>(1, std::min(morsels, parallelism));
+    std::atomic<size_t> next_morsel(0);
+    if (access) {
+        access->label = accessLabel(AccessPlan(), where);
+        access->profile.rows_in += row_count_;
+    }
+    aggregator.start(workers);
+    ThreadPool::instance().parallelFor(workers, workers, [&](size_t worker) {
+        std::vector<size_t> positions;
+        for (size_t m = next_morsel++; m < morsels; m = next_morsel++) {
+            size_t begin = m * kMorselSize;
+            positions.clear();
+            {
+                ProfileScope access_scope(access ? &access->profile : nullptr);
+                filterRange(where, view, begin, std::min(row_count_, begin + kMorselSize), positions);
+            }
+            aggregator.consume(worker, positions.data(), positions.size());
+            if (plan) {
+                access->profile.rows_out += positions.size();
+                profile->rows_in += positions.size();
+            }
+        }
+    });
+    
+    aggregator.finish(parallelism, result);
+    if (profile) {
+        profile->rows_out += result.rows.size();
+    }
+    return result;
+}
+
+// Cost units are rows read by a scan. A row fetched through an index costs
+// more: it is looked up, sorted into position order and rechecked alone.
+static constexpr double kScanRowCost = 1.0;
+static constexpr double kIndexRowCost = 6.0;
+static constexpr double kHashProbeCost = 16.0;
+
+// Collects the comparisons every matching row must satisfy, i.e. those
+// reachable from the root through ANDs only
+static void collectConjuncts(const Predicate* where, std::vector<const Predicate*>& out) {
+    if (where->kind() == Predicate::Kind::AND) {
+        for (const auto& child : where->children()) {
+            collectConjuncts(child.get(), out);
+        }
+    } else if (where->kind() == Predicate::Kind::COMPARE) {
+        out.push_back(where);
+    }
+}
+
+// Filter a batch at a time into a list of selected row positions
+void Table::filterPositions(const Predicate* where, const ReadView& view, std::vector<size_t>& selected,
+                            PlanNode* access) const {
+    ProfileScope scope(access ? &access->profile : nullptr);
+    size_t before = selected.size();
+    if (!filterByIndex(where, view, selected, access)) {
+        if (access) {
+            access->label = accessLabel(AccessPlan(), where);
+            access->profile.rows_in += row_count_;
+        }
+        scanPositions(where, view, selected);
+    }
+    if (access) {
+        access->profile.rows_out += selected.size() - before;
+    }
+}
+
+void Table::scanPositions(const Predicate* where, const ReadView& view, std::vector<size_t>& selected) const {
+    // Split the scan into morsels and filter them in parallel
+    size_t morsels = (row_count_ + kMorselSize - 1) / kMorselSize;
+    size_t parallelism = Session::current().parallelism;
+    if (morsels <= 1 || parallelism <= 1) {
+        filterRange(where, view, 0, row_count_, selected);
+        return;
+    }
+    
+    std::vector<std::vector<size_t>> parts(morsels);
+    ThreadPool::instance().parallelFor(morsels, parallelism, [&](size_t m) {
+        size_t begin = m * kMorselSize;
+        filterRange(where, view, begin, std::min(row_count_, begin + kMorselSize), parts[m]);
+    });
+    
+    // Concatenate in morsel order so rows keep their scan order
+    size_t total = 0;
+    for (const auto& part : parts) {
+        total += part.size();
+    }
+    selected.reserve(selected.size() + total);
+    for (const auto& part : parts) {
+        selected.insert(selected.end(), part.begin(), part.end());
+    }
+}
+
+// Selects the matching rows through an index, if one applies; false if
+// the table must be scanned instead
+bool Table::filterByIndex(const Predicate* where, const ReadView& view, std::vector<size_t>& selected,
+                          PlanNode* access) const {
+    std::vector<int> candidates;
+    AccessPlan used;
+    if (!where || !probeIndexes(where, candidates, &used)) {
+        return false;
+    }
+    if (access) {
+        access->label = accessLabel(used, where);
+        access->profile.rows_in += candidates.size();
+    }
+    
+    // Recheck the full predicate on the rows the index produced
+    for (int row_id : candidates) {
+        if (slots_[row_id] != kTombstone) {
+            selected.push_back(slots_[row_id]);
+        }
+    }
+    std::sort(selected.begin(), selected.end());
+    selected.erase(std::remove_if(selected.begin(), selected.end(),
+                                  [&](size_t pos) { return !visible(view, pos) || !where->matches(data_, pos); }),
+                   selected.end());
+    return true;
+}
+
+// Appends the rows in [begin, end) that view can see and that satisfy
+// where; begin must be a multiple of kBatchSize
+void Table::filterRange(const Predicate* where, const ReadView& view, size_t begin, size_t end,
+                        std::vector<size_t>& selected) const {
+    BatchMask mask;
+    for (size_t start = begin; start < end; start += kBatchSize) {
+        size_t count = std::min(kBatchSize, end - start);
+        
+        // Zone maps rule out whole blocks; a batch never spans two
+        if (where && !where->mayMatch(data_, start >> kBlockShift)) {
+            continue;
+        }
+        if (where) {
+            where->evaluate(data_, start, count, mask);
+        } else {
+            std::fill(mask.is_true, mask.is_true + kBatchWords, ~uint64_t(0));
+        }
+        
+        const uint64_t* deleted = deleted_.words() + start / 64;
+        for (size_t w = 0; w * 64 < count; ++w) {
+            uint64_t bits = mask.is_true[w] & ~deleted[w];
+            if (count - w * 64 < 64) {
+                bits &= (uint64_t(1) << (count - w * 64)) - 1;
+            }
+            while (bits) {
+                size_t pos = start + w * 64 + __builtin_ctzll(bits);
+                if (visible(view, pos)) {
+                    selected.push_back(pos);
                 }
+                bits &= bits - 1;
             }
         }
+    }
+}
+
+// Ways to read the rows where may match, best first and ending with a
+// scan. Without statistics, equality on a hash index comes first, then
+// the bounds on each B+tree-indexed column. With them, every way is
+// costed from the rows it is expected to produce, and the cheapest wins.
+std::vector<AccessPlan> Table::planAccess(const Predicate* where) const {
+    std::vector<AccessPlan> plans;
+    std::vector<const Predicate*> conjuncts;
+    if (where) {
+        collectConjuncts(where, conjuncts);
+    }
+    
+    for (const Predicate* cmp : conjuncts) {
+        const Index* index = indexes_[cmp->columnIndex()].get();
+        if (cmp->op() == CompareOp::EQ && index && index->type() == IndexType::HASH) {
+            AccessPlan plan;
+            plan.method = AccessMethod::HASH_INDEX;
+            plan.column = cmp->columnIndex();
+            plan.low = plan.high = {&cmp->literal(), true};
+            plans.push_back(plan);
+        }
+    }
+    
+    for (const Predicate* cmp : conjuncts) {
+        const Index* index = indexes_[cmp->columnIndex()].get();
+        if (!index || index->type() != IndexType::BTREE || cmp->op() == CompareOp::NE ||
+            std::any_of(plans.begin(), plans.end(), [&](const AccessPlan& plan) {
+                return plan.method == AccessMethod::BTREE_INDEX && plan.column == cmp->columnIndex();
+            })) {
+            continue;
+        }
         
-        // Extract specific columns from each row
-        for (const Row& row : rows_) {
-            Row filtered_row;
-            for (int index : column_indices) {
-                filtered_row.push_back(row[index]);
+        // Take one lower and one upper bound on this column
+        AccessPlan plan;
+        plan.method = AccessMethod::BTREE_INDEX;
+        plan.column = cmp->columnIndex();
+        for (const Predicate* other : conjuncts) {
+            if (other->columnIndex() != cmp->columnIndex()) continue;
+            
+            const Value* value = &other->literal();
+            switch (other->op()) {
+                case CompareOp::EQ:
+                    if (!plan.low.value) plan.low = {value, true};
+                    if (!plan.high.value) plan.high = {value, true};
+                    break;
+                case CompareOp::GT:
+                case CompareOp::GE:
+                    if (!plan.low.value) plan.low = {value, other->op() == CompareOp::GE};
+                    break;
+                case CompareOp::LT:
+                case CompareOp::LE:
+                    if (!plan.high.value) plan.high = {value, other->op() == CompareOp::LE};
+                    break;
+                case CompareOp::NE:
+                    break;
             }
-            result.rows.push_back(filtered_row);
         }
+        plans.push_back(plan);
     }
     
-    return result;
+    AccessPlan scan;
+    scan.cost = static_cast<double>(row_count_) * kScanRowCost;
+    std::shared_ptr<const TableStatistics> stats = statistics();
+    if (stats) {
+        double live = static_cast<double>(row_count_ - dead_count_);
+        scan.rows = stats->selectivity(where) * live;
+        for (AccessPlan& plan : plans) {
+            plan.rows = stats->columns[plan.column].rangeSelectivity(plan.low, plan.high) * live;
+            double probe = plan.method == AccessMethod::HASH_INDEX ? kHashProbeCost : std::log2(live + 2);
+            plan.cost = probe + plan.rows * kIndexRowCost;
+        }
+    }
+    plans.push_back(scan);
+    if (stats) {
+        std::stable_sort(plans.begin(), plans.end(),
+                         [](const AccessPlan& a, const AccessPlan& b) { return a.cost < b.cost; });
+    }
+    return plans;
+}
+
+// Produces a superset of the rows where matches from the best index that
+// can serve it; false if a scan is better or no index applies
+bool Table::probeIndexes(const Predicate* where, std::vector<int>& candidates, AccessPlan* used) const {
+    for (const AccessPlan& plan : planAccess(where)) {
+        if (plan.method == AccessMethod::SCAN) {
+            return false;
+        }
+        const Index& index = *indexes_[plan.column];
+        if (used) {
+            *used = plan;
+        }
+        if (plan.method == AccessMethod::HASH_INDEX) {
+            index.findInto(*plan.low.value, candidates);
+            return true;
+        }
+        if (index.findRangeInto(plan.low, plan.high, candidates)) {
+            return true;
+        }
+        candidates.clear();
+    }
+    return false;
+}
+
+// How EXPLAIN names a way of reading rows: the index and the bounds it is
+// probed with, then the predicate each row read is filtered on
+std::string Table::accessLabel(const AccessPlan& plan, const Predicate* where) const {
+    std::string label;
+    if (plan.method == AccessMethod::SCAN) {
+        label = "Seq Scan on " + name_;
+    } else {
+        const std::string& column = columns_[plan.column].name;
+        label = (plan.method == AccessMethod::HASH_INDEX ? "Hash Index Scan on " : "B+tree Index Scan on ") +
+                name_ + " using " + index_names_[plan.column] + ", cond: ";
+        if (plan.low.value && plan.low.value == plan.high.value) {
+            label += column + " = " + literalText(*plan.low.value);
+        } else {
+            if (plan.low.value) {
+                label += column + (plan.low.inclusive ? " >= " : " > ") + literalText(*plan.low.value);
+            }
+            if (plan.high.value) {
+                label += plan.low.value ? " AND " : "";
+                label += column + (plan.high.inclusive ? " <= " : " < ") + literalText(*plan.high.value);
+            }
+        }
+    }
+    if (where) {
+        label += ", filter: " + where->toString();
+    }
+    return label;
+}
+
+std::unique_ptr<PlanNode> Table::accessNode(const Predicate* where) const {
+    return std::make_unique<PlanNode>(accessLabel(planAccess(where).front(), where), estimateRows(where));
+}
+
+std::unique_ptr<PlanNode> Table::explainAccess(const Predicate* where) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return accessNode(where);
+}
+
+double Table::estimateRows(const Predicate* where) const {
+    std::shared_ptr<const TableStatistics> stats = statistics();
+    if (!stats) {
+        return -1;
+    }
+    return stats->selectivity(where) * static_cast<double>(row_count_ - dead_count_);
+}
+
+// Analyzes the rows the latest snapshot sees, up to the first row whose
+// insert has not committed yet: it may still become visible where it is,
+// so the next ANALYZE starts there. Columns are analyzed in parallel.
+void Table::analyze() {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    
+    std::shared_ptr<const TableStatistics> previous = statistics();
+    auto next = std::make_shared<TableStatistics>();
+    if (previous && previous->rewrites == rewrites_ && previous->positions <= row_count_) {
+        *next = *previous;
+    } else {
+        next->columns.resize(columns_.size());
+    }
+    
+    size_t end = next->positions;
+    while (end < row_count_ && begin_ts_[end] < kUncommitted) {
+        end++;
+    }
+    if (previous && next->positions == previous->positions && end == previous->positions) {
+        return;  // nothing new has committed
+    }
+    std::vector<size_t> positions;
+    for (size_t pos = next->positions; pos < end; ++pos) {
+        if (!deleted_.get(pos) && visible(ReadView(), pos)) {
+            positions.push_back(pos);
+        }
+    }
+    
+    ThreadPool::instance().parallelFor(columns_.size(), Session::current().parallelism, [&](size_t i) {
+        next->columns[i].add(data_[i], positions);
+        next->columns[i].finish();
+    });
+    next->rows += positions.size();
+    next->positions = end;
+    next->modifications = modifications_ - (row_count_ - end);  // rows left out count as written since
+    next->rewrites = rewrites_;
+    std::atomic_store(&statistics_, std::shared_ptr<const TableStatistics>(std::move(next)));
+}
+
+bool Table::statisticsStale(double fraction) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    
+    std::shared_ptr<const TableStatistics> stats = statistics();
+    return stats && stats->modifications != modifications_ &&
+           modifications_ - stats->modifications >= fraction * static_cast<double>(stats->rows);
+}
+
+bool Table::createIndex(const std::string& column_name, IndexType type, const std::string& index_name) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    
+    int index = findColumn(column_name);
+    if (index < 0 || indexes_[index]) {
+        return false; // Unknown column or already indexed
+    }
+    
+    if (type == IndexType::BTREE) {
+        indexes_[index] = createTreeIndex(columns_[index].type);
+    } else {
+        indexes_[index] = createHashIndex(columns_[index].type);
+    }
+    indexes_[index]->build(data_[index], row_ids_, deleted_);
+    index_names_[index] = index_name.empty() ? name_ + "_" + column_name + "_idx" : index_name;
+    return true;
+}
+
+bool Table::dropIndex(const std::string& column_name) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    
+    int index = findColumn(column_name);
+    if (index < 0 || !indexes_[index]) {
+        return false;
+    }
+    
+    indexes_[index].reset();
+    index_names_[index].clear();
+    return true;
+}
+
+bool Table::hasIndex(const std::string& column_name) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    
+    int index = findColumn(column_name);
+    return index >= 0 && indexes_[index] != nullptr;
+}
+
+std::string Table::indexedColumn(const std::string& index_name) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    
+    for (size_t i = 0; i < index_names_.size(); ++i) {
+        if (indexes_[i] && index_names_[i] == index_name) {
+            return columns_[i].name;
+        }
+    }
+    return "";
 }
 
-QueryResult Table::selectWhere(const std::string& condition) {
-    // Simple WHERE clause implementation
-    // In a real implementation, this would parse and evaluate conditions
-    return select(); // For now, return all rows
+double Table::deadRatio() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    
+    return row_count_ == 0 ? 0.0 : static_cast<double>(dead_count_) / row_count_;
 }
 
-void Table::createIndex(const std::string& column_name) {
-    // Index creation implementation would go here
+std::vector<ColumnStorage> Table::storage() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    
+    std::vector<ColumnStorage> result;
+    for (const ColumnVector& column : data_) {
+        result.push_back(column.storage());
+    }
+    return result;
 }
 
-void Table::dropIndex(const std::string& column_name) {
-    // Index dropping implementation would go here
+bool Table::compactStep(size_t max_rows) {
+    std::lock_guard<std::shared_mutex> lock(mutex_);
+    
+    // Moving rows would shift them under an open cursor
+    if (pin_count_ > 0) {
+        return false;
+    }
+    
+    if (!compacting_) {
+        if (dead_count_ == 0) {
+            return false;
+        }
+        
+        // Nothing before the first deleted row needs to move
+        size_t first = 0;
+        while (!deleted_.get(first)) {
+            first++;
+        }
+        compacting_ = true;
+        compact_read_ = first;
+        compact_write_ = first;
+    }
+    rewrites_++;
+    
+    size_t end = std::min(row_count_, compact_read_ + max_rows);
+    for (; compact_read_ < end; ++compact_read_) {
+        if (deleted_.get(compact_read_)) {
+            continue;
+        }
+        
+        size_t from = compact_read_;
+        size_t to = compact_write_++;
+        for (ColumnVector& column : data_) {
+            column.moveRow(from, to);
+        }
+        row_ids_[to] = row_ids_[from];
+        begin_ts_[to] = begin_ts_[from];
+        end_ts_[to] = end_ts_[from];
+        slots_[row_ids_[to]] = static_cast<uint32_t>(to);
+        deleted_.set(to, false);
+        deleted_.set(from, true);
+    }
+    
+    if (compact_read_ < row_count_) {
+        return true;
+    }
+    
+    // Everything past the write cursor is now dead. Blocks the moves decoded
+    // are encoded again, and zone maps shrink back to the surviving rows.
+    for (ColumnVector& column : data_) {
+        column.truncate(compact_write_);
+        column.compactHeap();
+        column.compress();
+        column.refreshZones();
+    }
+    row_ids_.resize(compact_write_);
+    begin_ts_.resize(compact_write_);
+    end_ts_.resize(compact_write_);
+    deleted_.resize(compact_write_);
+    dead_count_ -= row_count_ - compact_write_;
+    row_count_ = compact_write_;
+    compacting_ = false;
+    return false;
+}
+
+void Table::compact() {
+    while (compactStep(kBatchSize * 64)) {
+    }
 }
 
 }
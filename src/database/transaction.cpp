@@ -0,0 +1,113 @@
+#include "transaction.h"
+#include "table.h"
+#include "wal.h"
+
+namespace InMemoryDB {
+
+Transaction::Transaction(TransactionManager* manager, uint64_t id, uint64_t snapshot)
+    : manager_(manager), id_(id), snapshot_(snapshot), active_(true), doomed_(false) {}
+
+Transaction::~Transaction() {
+    if (active_) {
+        manager_->rollback(*this);
+    }
+}
+
+TableWrites& Transaction::writesFor(const std::shared_ptr<Table>& table) {
+    TableWrites& writes = writes_[table.get()];
+    if (!writes.table) {
+        writes.table = table;
+    }
+    return writes;
+}
+
+TransactionManager::TransactionManager() : last_commit_(0), next_id_(1), wal_(nullptr) {}
+
+std::shared_ptr<Transaction> TransactionManager::begin() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    uint64_t snapshot = last_commit_;
+    active_.insert(snapshot);
+    return std::make_shared<Transaction>(this, next_id_++, snapshot);
+}
+
+std::shared_ptr<Transaction> TransactionManager::beginAtLogPosition(uint64_t& lsn) {
+    std::lock_guard<std::mutex> lock(commit_mutex_);
+
+    lsn = wal_ && wal_->isOpen() ? wal_->appendedLsn() : 0;
+    return begin();
+}
+
+void TransactionManager::finish(Transaction& txn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    active_.erase(active_.find(txn.snapshot_));
+    txn.active_ = false;
+    txn.writes_.clear();
+}
+
+bool TransactionManager::commit(Transaction& txn, std::string& error) {
+    if (!txn.active_) {
+        error = "Transaction is not active";
+        return false;
+    }
+
+    if (txn.doomed_) {
+        rollback(txn);
+        error = "Transaction rolled back due to a write-write conflict";
+        return false;
+    }
+
+    uint64_t lsn = 0;
+    {
+        // Readers take last_commit_ as their snapshot, so it only advances
+        // once every version carries the new timestamp. Log records are
+        // appended here too, so the log replays commits in order.
+        std::lock_guard<std::mutex> lock(commit_mutex_);
+        uint64_t commit_ts = last_commit_ + 1;
+        if (wal_ && wal_->isOpen() && !txn.writes_.empty()) {
+            WalWriter record;
+            record.putU32(static_cast<uint32_t>(txn.writes_.size()));
+            for (auto& pair : txn.writes_) {
+                WalWriter section;
+                pair.second.table->encodeWrites(pair.second, section);
+                record.putString(pair.second.table->getName());
+                record.putString(section.data());
+            }
+            lsn = wal_->append(WalRecordType::COMMIT, record);
+        }
+        for (auto& pair : txn.writes_) {
+            pair.second.table->finishWrites(pair.second, txn.marker(), commit_ts);
+        }
+        last_commit_ = commit_ts;
+    }
+
+    finish(txn);
+
+    // Wait for the fsync outside the commit lock so that concurrent
+    // commits can share it
+    if (lsn && !wal_->waitDurable(lsn)) {
+        error = "Transaction committed but could not be written to the log";
+        return false;
+    }
+    return true;
+}
+
+void TransactionManager::rollback(Transaction& txn) {
+    if (!txn.active_) {
+        return;
+    }
+
+    for (auto& pair : txn.writes_) {
+        pair.second.table->finishWrites(pair.second, txn.marker(), 0);
+    }
+    finish(txn);
+}
+
+uint64_t TransactionManager::oldestSnapshot() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return active_.empty() ? last_commit_.load() : *active_.begin();
+}
+
+}
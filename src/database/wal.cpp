@@ -0,0 +1,377 @@
+#include "wal.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+
+namespace InMemoryDB {
+
+namespace {
+
+enum ValueTag : uint8_t { TAG_NULL, TAG_INT, TAG_DOUBLE, TAG_STRING, TAG_BOOL, TAG_BIGINT };
+
+constexpr size_t kFrameHeader = 9;  // length, crc32, type
+
+// The file starts with a magic number and the LSN of its first record
+constexpr char kLogMagic[8] = {'I', 'M', 'D', 'B', 'W', 'A', 'L', '1'};
+constexpr size_t kLogHeader = 16;
+
+uint32_t readU32(const char* p) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= uint32_t(static_cast<uint8_t>(p[i])) << (8 * i);
+    }
+    return value;
+}
+
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+std::string logHeader(uint64_t base_lsn) {
+    WalWriter header;
+    for (char c : kLogMagic) {
+        header.putU8(static_cast<uint8_t>(c));
+    }
+    header.putU64(base_lsn);
+    return header.data();
+}
+
+}
+
+uint32_t crc32(const char* data, size_t size, uint32_t crc) {
+    static uint32_t table[256] = {};
+    static bool ready = [] {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        return true;
+    }();
+    (void)ready;
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+bool syncParentDirectory(const std::string& path) {
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+void WalWriter::putU32(uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        putU8(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void WalWriter::putU64(uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        putU8(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void WalWriter::putString(std::string_view value) {
+    putU32(static_cast<uint32_t>(value.size()));
+    buffer_.append(value);
+}
+
+void WalWriter::putValue(const Value& value) {
+    switch (value.kind()) {
+        case Value::Kind::NUL:
+            putU8(TAG_NULL);
+            break;
+        case Value::Kind::INTEGER:
+            // Column values always fit in 32 bits; only wider literals need 64
+            if (static_cast<int32_t>(value.asInt()) == value.asInt()) {
+                putU8(TAG_INT);
+                putU32(static_cast<uint32_t>(value.asInt()));
+            } else {
+                putU8(TAG_BIGINT);
+                putU64(static_cast<uint64_t>(value.asInt()));
+            }
+            break;
+        case Value::Kind::DOUBLE: {
+            uint64_t bits;
+            double d = value.asDouble();
+            std::memcpy(&bits, &d, sizeof(bits));
+            putU8(TAG_DOUBLE);
+            putU64(bits);
+            break;
+        }
+        case Value::Kind::STRING:
+            putU8(TAG_STRING);
+            putString(value.asString());
+            break;
+        case Value::Kind::BOOLEAN:
+            putU8(TAG_BOOL);
+            putU8(value.asBool());
+            break;
+    }
+}
+
+bool WalReader::take(size_t n) {
+    if (!ok_ || size_ - pos_ < n) {
+        ok_ = false;
+        return false;
+    }
+    return true;
+}
+
+uint8_t WalReader::getU8() {
+    return take(1) ? static_cast<uint8_t>(data_[pos_++]) : 0;
+}
+
+uint32_t WalReader::getU32() {
+    if (!take(4)) return 0;
+    uint32_t value = readU32(data_ + pos_);
+    pos_ += 4;
+    return value;
+}
+
+uint64_t WalReader::getU64() {
+    uint64_t low = getU32();
+    uint64_t high = getU32();
+    return low | (high << 32);
+}
+
+std::string WalReader::getString() {
+    uint32_t length = getU32();
+    if (!take(length)) return std::string();
+    std::string value(data_ + pos_, length);
+    pos_ += length;
+    return value;
+}
+
+Value WalReader::getValue() {
+    switch (getU8()) {
+        case TAG_INT:
+            return static_cast<int32_t>(getU32());
+        case TAG_BIGINT:
+            return static_cast<int64_t>(getU64());
+        case TAG_DOUBLE: {
+            uint64_t bits = getU64();
+            double d;
+            std::memcpy(&d, &bits, sizeof(d));
+            return d;
+        }
+        case TAG_STRING: {
+            uint32_t length = getU32();
+            if (!take(length)) return Value();
+            Value value(std::string_view(data_ + pos_, length));
+            pos_ += length;
+            return value;
+        }
+        case TAG_BOOL:
+            return getU8() != 0;
+        case TAG_NULL:
+            return Value();
+        default:
+            ok_ = false;
+            return Value();
+    }
+}
+
+WriteAheadLog::WriteAheadLog()
+    : fd_(-1), durability_(Durability::OFF), group_window_us_(1000), base_lsn_(0),
+      appended_lsn_(0), durable_lsn_(0), failed_(false), stopping_(false) {}
+
+WriteAheadLog::~WriteAheadLog() {
+    if (!flusher_.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    flush_cv_.notify_one();
+    flusher_.join();
+    ::close(fd_);
+}
+
+bool WriteAheadLog::open(const std::string& path, Durability durability, uint64_t start_lsn,
+                         const std::function<void(WalRecordType, WalReader&)>& apply, std::string& error) {
+    std::string log;
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (in) {
+            log.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+    }
+
+    uint64_t base_lsn = 0;
+    if (log.size() >= kLogHeader && std::memcmp(log.data(), kLogMagic, sizeof(kLogMagic)) == 0) {
+        WalReader header(log.data() + sizeof(kLogMagic), 8);
+        base_lsn = header.getU64();
+    } else if (!log.empty()) {
+        error = "'" + path + "' is not a write-ahead log";
+        return false;
+    }
+
+    // Replay up to the first record that is incomplete or fails its
+    // checksum. Records before start_lsn are already in the snapshot.
+    size_t offset = kLogHeader;
+    while (log.size() > offset && log.size() - offset >= kFrameHeader) {
+        uint32_t length = readU32(log.data() + offset);
+        uint32_t crc = readU32(log.data() + offset + 4);
+        if (log.size() - offset - 8 < size_t(length) + 1 ||
+            crc32(log.data() + offset + 8, size_t(length) + 1) != crc) {
+            break;
+        }
+        if (base_lsn + (offset - kLogHeader) >= start_lsn) {
+            WalReader reader(log.data() + offset + kFrameHeader, length);
+            apply(static_cast<WalRecordType>(log[offset + 8]), reader);
+        }
+        offset += kFrameHeader + length;
+    }
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    bool ok = fd_ >= 0;
+    if (ok && log.size() < kLogHeader) {
+        std::string header = logHeader(base_lsn);
+        ok = ::ftruncate(fd_, 0) == 0 && writeAll(fd_, header.data(), header.size());
+    }
+    if (!ok || ::ftruncate(fd_, offset) != 0 || ::lseek(fd_, offset, SEEK_SET) < 0) {
+        error = "Cannot open write-ahead log '" + path + "': " + std::strerror(errno);
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+        return false;
+    }
+
+    path_ = path;
+    base_lsn_ = base_lsn;
+    appended_lsn_ = durable_lsn_ = base_lsn + (offset - kLogHeader);
+    durability_ = durability;
+    flusher_ = std::thread(&WriteAheadLog::flusherLoop, this);
+    return true;
+}
+
+bool WriteAheadLog::discardBefore(uint64_t lsn, std::string& error) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // Wait for the flusher to go idle; appends stay blocked from then on
+    durable_cv_.wait(lock, [&] { return durable_lsn_ >= appended_lsn_ || failed_; });
+    if (failed_) {
+        error = "Write-ahead log is not writable";
+        return false;
+    }
+
+    // Copy the records from lsn onwards into a new log and swap it in
+    off_t from = static_cast<off_t>(kLogHeader + (lsn - base_lsn_));
+    off_t end = ::lseek(fd_, 0, SEEK_END);
+    std::string tail(end > from ? end - from : 0, '\0');
+    std::string temp_path = path_ + ".tmp";
+    std::string header = logHeader(lsn);
+
+    int fd = ::open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    bool ok = fd >= 0 &&
+              ::pread(fd_, &tail[0], tail.size(), from) == static_cast<ssize_t>(tail.size()) &&
+              writeAll(fd, header.data(), header.size()) &&
+              writeAll(fd, tail.data(), tail.size()) &&
+              ::fdatasync(fd) == 0 &&
+              ::rename(temp_path.c_str(), path_.c_str()) == 0 &&
+              syncParentDirectory(path_);
+    if (!ok) {
+        error = "Cannot rewrite write-ahead log: " + std::string(std::strerror(errno));
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        // The old log is complete, so keep appending to it
+        ::lseek(fd_, 0, SEEK_END);
+        return false;
+    }
+
+    ::close(fd_);
+    fd_ = fd;
+    base_lsn_ = lsn;
+    return true;
+}
+
+uint64_t WriteAheadLog::append(WalRecordType type, const WalWriter& payload) {
+    const std::string& data = payload.data();
+
+    WalWriter frame;
+    frame.putU32(static_cast<uint32_t>(data.size()));
+    std::string body;
+    body.reserve(data.size() + 1);
+    body.push_back(static_cast<char>(type));
+    body.append(data);
+    frame.putU32(crc32(body.data(), body.size()));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffer_.append(frame.data());
+    buffer_.append(body);
+    appended_lsn_ += frame.data().size() + body.size();
+    flush_cv_.notify_one();
+    return appended_lsn_;
+}
+
+bool WriteAheadLog::waitDurable(uint64_t lsn) {
+    if (durability_ != Durability::SYNC) {
+        return true;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    durable_cv_.wait(lock, [&] { return durable_lsn_ >= lsn || failed_ || stopping_; });
+    return durable_lsn_ >= lsn;
+}
+
+void WriteAheadLog::flusherLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        flush_cv_.wait(lock, [&] { return stopping_ || !buffer_.empty(); });
+        if (buffer_.empty()) {
+            break;  // stopping with nothing left to write
+        }
+
+        // Give other committers the group window to join this fsync
+        if (!stopping_) {
+            flush_cv_.wait_for(lock, std::chrono::microseconds(group_window_us_.load()),
+                               [&] { return stopping_; });
+        }
+
+        std::string pending;
+        pending.swap(buffer_);
+        uint64_t lsn = appended_lsn_;
+        lock.unlock();
+
+        bool written = writeAll(fd_, pending.data(), pending.size()) && ::fdatasync(fd_) == 0;
+
+        // After a failed write the file no longer matches the LSNs, so
+        // nothing later can be made durable either
+        lock.lock();
+        if (written && !failed_) {
+            durable_lsn_ = lsn;
+        } else {
+            failed_ = true;
+        }
+        durable_cv_.notify_all();
+    }
+}
+
+}
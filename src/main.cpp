@@ -1,6 +1,9 @@
 #include "storage_engine.h"
 #include "plsql_parser.h"
 #include "globals.h"
+#include "cursor.h"
+#include "session.h"
+#include "prepared_statement.h"
 #include <iostream>
 #include <string>
 #include <memory>
@@ -18,23 +21,32 @@ void printWelcome() {
     std::cout << "========================================" << std::endl;
     std::cout << "Commands:" << std::endl;
     std::cout << "  CREATE TABLE name (col1 type, col2 type, ...);" << std::endl;
-    std::cout << "  INSERT INTO name VALUES (val1, val2, ...);" << std::endl;
+    std::cout << "  INSERT INTO name VALUES (val1, val2, ...)[, (...) ...];" << std::endl;
     std::cout << "  SELECT * FROM name;" << std::endl;
-    std::cout << "  SELECT col1, col2 FROM name;" << std::endl;
+    std::cout << "  SELECT col1, col2 FROM name WHERE col1 = val [ORDER BY col2 [DESC]] [LIMIT n];" << std::endl;
+    std::cout << "  SELECT col1, COUNT(*), SUM(col2) FROM name GROUP BY col1;" << std::endl;
+    std::cout << "  SELECT a.col, b.col FROM a [LEFT] JOIN b ON a.id = b.id;" << std::endl;
+    std::cout << "  UPDATE name SET col1 = val WHERE ...;" << std::endl;
+    std::cout << "  DELETE FROM name WHERE ...;" << std::endl;
+    std::cout << "  CREATE INDEX idx ON name (col) [USING HASH|BTREE];" << std::endl;
+    std::cout << "  DROP INDEX idx;" << std::endl;
     std::cout << "  DROP TABLE name;" << std::endl;
+    std::cout << "  BEGIN; COMMIT; ROLLBACK; CHECKPOINT;" << std::endl;
+    std::cout << "  COPY name FROM|TO 'file' [CSV [HEADER] [DELIMITER ','] | BINARY];" << std::endl;
+    std::cout << "  SET DURABILITY = ASYNC|SYNC; SET GROUP_COMMIT_WINDOW = microseconds;" << std::endl;
+    std::cout << "  SET PARALLELISM = n; SET COMPACTION_THRESHOLD = ratio; SET PLAN_CACHE_SIZE = n;" << std::endl;
+    std::cout << "  PREPARE stmt AS ... $1 ...; EXECUTE stmt(val, ...); DEALLOCATE stmt;" << std::endl;
+    std::cout << "  ANALYZE [name]; SET STATISTICS_THRESHOLD = ratio;" << std::endl;
+    std::cout << "  EXPLAIN [ANALYZE] SELECT ...;" << std::endl;
+    std::cout << "  SHOW ALLOCATIONS; SHOW STORAGE name; SHOW STATISTICS name;" << std::endl;
     std::cout << "  exit - quit the program" << std::endl;
     std::cout << "========================================" << std::endl;
 }
 
 void executeQuery(const std::string& sql) {
     try {
-        // Tokenize
-        PLSQLLexer lexer(sql);
-        auto tokens = lexer.tokenize();
-        
-        // Parse and execute
-        PLSQLParser parser(tokens);
-        QueryResult result = parser.parse();
+        // Repeated statements reuse their cached plan
+        QueryResult result = executeSql(sql);
         
         if (result.success) {
             if (!result.columns.empty()) {
@@ -52,18 +64,37 @@ void executeQuery(const std::string& sql) {
                 }
                 std::cout << std::endl;
                 
-                // Print rows
-                for (const auto& row : result.rows) {
+                // Print rows, pulling them batch by batch from a cursor
+                size_t row_count = 0;
+                auto printRow = [](const Row& row) {
                     for (size_t i = 0; i < row.size(); ++i) {
-                        std::visit([](const auto& v) { std::cout << v; }, row[i]);
+                        std::cout << row[i];
                         if (i < row.size() - 1) std::cout << "\t";
                     }
-                    std::cout << std::endl;
+                    std::cout << "\n";
+                };
+                if (result.cursor) {
+                    RowBatch batch;
+                    while (result.cursor->next(batch)) {
+                        for (size_t r = 0; r < batch.size; ++r) {
+                            printRow(batch.rows[r]);
+                        }
+                        row_count += batch.size;
+                    }
+                } else {
+                    for (const auto& row : result.rows) {
+                        printRow(row);
+                    }
+                    row_count = result.rows.size();
                 }
                 
-                std::cout << std::endl << result.rows.size() << " row(s) returned." << std::endl;
+                std::cout << std::endl << row_count << " row(s) returned." << std::endl;
             } else {
-                std::cout << "Query executed successfully." << std::endl;
+                std::cout << "Query executed successfully.";
+                if (result.rows_affected > 0) {
+                    std::cout << " " << result.rows_affected << " row(s) affected.";
+                }
+                std::cout << std::endl;
             }
         } else {
             std::cout << "Error: " << result.error_message << std::endl;
@@ -73,19 +104,50 @@ void executeQuery(const std::string& sql) {
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     // Initialize storage engine
     StorageEngine storage;
     g_storage_engine = &storage;  // This now refers to InMemoryDB::g_storage_engine
     
+    // Usage: InMemoryPLSQLDB [--wal path] [--durability off|async|sync]
+    std::string wal_path;
+    Durability durability = Durability::SYNC;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--wal" && i + 1 < argc) {
+            wal_path = argv[++i];
+        } else if (arg == "--durability" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "off") {
+                durability = Durability::OFF;
+            } else if (mode == "async") {
+                durability = Durability::ASYNC;
+            } else if (mode == "sync") {
+                durability = Durability::SYNC;
+            } else {
+                std::cerr << "Unknown durability mode '" << mode << "'" << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--wal path] [--durability off|async|sync]" << std::endl;
+            return 1;
+        }
+    }
+    
+    if (!wal_path.empty() && durability != Durability::OFF) {
+        std::string error;
+        if (!storage.openLog(wal_path, durability, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    }
+    
     printWelcome();
     
     std::string input;
     while (true) {
         std::cout << std::endl << "SQL> ";
-        std::getline(std::cin, input);
-        
-        if (input == "exit" || input == "quit") {
+        if (!std::getline(std::cin, input) || input == "exit" || input == "quit") {
             break;
         }
         
@@ -96,6 +158,9 @@ int main() {
         executeQuery(input);
     }
     
+    // An open transaction is rolled back before the engine goes away
+    Session::current().transaction.reset();
+    
     std::cout << "Goodbye!" << std::endl;
     return 0;
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "plsql_parser.h"
+#include "prepared_statement.h"
 #include "storage_engine.h"
+#include "cursor.h"
 #include <iostream>
 #include <sstream>
 
@@ -14,13 +16,8 @@ public:
     
     QueryResult execute(const std::string& sql) {
         try {
-            // Tokenize
-            PLSQLLexer lexer(sql);
-            auto tokens = lexer.tokenize();
-            
-            // Parse and execute
-            PLSQLParser parser(tokens);
-            return parser.parse();
+            // Parse once per distinct statement; repeats reuse the cached plan
+            return executeSql(sql);
             
         } catch (const std::exception& e) {
             QueryResult result;
@@ -36,7 +33,11 @@ public:
         }
         
         if (result.columns.empty()) {
-            std::cout << "Query executed successfully." << std::endl;
+            std::cout << "Query executed successfully.";
+            if (result.rows_affected > 0) {
+                std::cout << " " << result.rows_affected << " row(s) affected.";
+            }
+            std::cout << std::endl;
             return;
         }
         
@@ -54,16 +55,33 @@ public:
         }
         std::cout << std::endl;
         
-        // Print rows
-        for (const auto& row : result.rows) {
-            for (size_t i = 0; i < row.size(); ++i) {
-                std::visit([](const auto& v) { std::cout << v; }, row[i]);
-                if (i < row.size() - 1) std::cout << "\t";
+        // Print rows, pulling them batch by batch from a cursor
+        size_t row_count = 0;
+        if (result.cursor) {
+            RowBatch batch;
+            while (result.cursor->next(batch)) {
+                for (size_t r = 0; r < batch.size; ++r) {
+                    printRow(batch.rows[r]);
+                }
+                row_count += batch.size;
             }
-            std::cout << std::endl;
+        } else {
+            for (const auto& row : result.rows) {
+                printRow(row);
+            }
+            row_count = result.rows.size();
         }
         
-        std::cout << std::endl << result.rows.size() << " row(s) returned." << std::endl;
+        std::cout << std::endl << row_count << " row(s) returned." << std::endl;
+    }
+    
+private:
+    void printRow(const Row& row) {
+        for (size_t i = 0; i < row.size(); ++i) {
+            std::cout << row[i];
+            if (i < row.size() - 1) std::cout << "\t";
+        }
+        std::cout << "\n";
     }
 };
 
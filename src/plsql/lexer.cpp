@@ -1,135 +1,255 @@
 #include "plsql_parser.h"
-#include <algorithm>
+#include <array>
 #include <cctype>
-#include <iostream>
-#include <stdexcept>
-#include <unordered_map>
+#include <cstdint>
 
 namespace InMemoryDB {
 
-PLSQLLexer::PLSQLLexer(const std::string& input) : input_(input), position_(0) {}
+namespace {
 
-std::vector<Token> PLSQLLexer::tokenize() {
-    std::vector<Token> tokens;
-    
-    while (position_ < input_.length()) {
-        skipWhitespace();
-        
-        if (position_ >= input_.length()) break;
-        
-        char ch = currentChar();
-        
-        if (ch == ';') {
-            tokens.push_back({TokenType::SEMICOLON, ";", position_});
-            advance();
-        } else if (ch == ',') {
-            tokens.push_back({TokenType::COMMA, ",", position_});
-            advance();
-        } else if (ch == '(') {
-            tokens.push_back({TokenType::LPAREN, "(", position_});
-            advance();
-        } else if (ch == ')') {
-            tokens.push_back({TokenType::RPAREN, ")", position_});
-            advance();
-        } else if (ch == '=') {
-            tokens.push_back({TokenType::EQ, "=", position_});
-            advance();
-        } else if (ch == '\'') {
-            tokens.push_back(readString());
-        } else if (std::isdigit(ch)) {
-            tokens.push_back(readNumber());
-        } else if (std::isalpha(ch) || ch == '_') {
-            tokens.push_back(readIdentifier());
-        } else {
-            advance(); // Skip unknown characters
+struct Keyword {
+    std::string_view name;
+    TokenType type;
+};
+
+constexpr Keyword kKeywords[] = {
+    {"SELECT", TokenType::SELECT},
+    {"INSERT", TokenType::INSERT},
+    {"UPDATE", TokenType::UPDATE},
+    {"DELETE", TokenType::DELETE},
+    {"CREATE", TokenType::CREATE},
+    {"DROP", TokenType::DROP},
+    {"TABLE", TokenType::TABLE},
+    {"INDEX", TokenType::INDEX},
+    {"ON", TokenType::ON},
+    {"USING", TokenType::USING},
+    {"FROM", TokenType::FROM},
+    {"WHERE", TokenType::WHERE},
+    {"GROUP", TokenType::GROUP},
+    {"BY", TokenType::BY},
+    {"ORDER", TokenType::ORDER},
+    {"ASC", TokenType::ASC},
+    {"DESC", TokenType::DESC},
+    {"LIMIT", TokenType::LIMIT},
+    {"JOIN", TokenType::JOIN},
+    {"INNER", TokenType::INNER},
+    {"LEFT", TokenType::LEFT},
+    {"OUTER", TokenType::OUTER},
+    {"INTO", TokenType::INTO},
+    {"VALUES", TokenType::VALUES},
+    {"SET", TokenType::SET},
+    {"BEGIN", TokenType::BEGIN},
+    {"COMMIT", TokenType::COMMIT},
+    {"ROLLBACK", TokenType::ROLLBACK},
+    {"CHECKPOINT", TokenType::CHECKPOINT},
+    {"COPY", TokenType::COPY},
+    {"PREPARE", TokenType::PREPARE},
+    {"EXECUTE", TokenType::EXECUTE},
+    {"DEALLOCATE", TokenType::DEALLOCATE},
+    {"SHOW", TokenType::SHOW},
+    {"ANALYZE", TokenType::ANALYZE},
+    {"EXPLAIN", TokenType::EXPLAIN},
+    {"AND", TokenType::AND},
+    {"OR", TokenType::OR},
+    {"NOT", TokenType::NOT},
+    {"BETWEEN", TokenType::BETWEEN}
+};
+
+constexpr size_t kKeywordCount = sizeof(kKeywords) / sizeof(kKeywords[0]);
+constexpr size_t kKeywordSlots = 128;  // power of two
+constexpr size_t kMaxKeywordLength = 10;
+
+constexpr char upperAscii(char c) {
+    return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+// Case-insensitive FNV-1a, seeded so that a seed can be searched for
+// under which no two keywords share a slot
+constexpr size_t keywordSlot(std::string_view word, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : word) {
+        hash = (hash ^ static_cast<uint8_t>(upperAscii(c))) * 16777619u;
+    }
+    return (hash ^ (hash >> 16)) & (kKeywordSlots - 1);
+}
+
+constexpr uint32_t findKeywordSeed() {
+    for (uint32_t seed = 0; seed < 100000; ++seed) {
+        bool used[kKeywordSlots] = {};
+        bool perfect = true;
+        for (size_t i = 0; i < kKeywordCount && perfect; ++i) {
+            size_t slot = keywordSlot(kKeywords[i].name, seed);
+            perfect = !used[slot];
+            used[slot] = true;
+        }
+        if (perfect) {
+            return seed;
+        }
+    }
+    return UINT32_MAX;
+}
+
+constexpr uint32_t kKeywordSeed = findKeywordSeed();
+static_assert(kKeywordSeed != UINT32_MAX, "no perfect hash seed for the keyword table; grow kKeywordSlots");
+
+// Slot -> index into kKeywords, or -1
+constexpr std::array<int8_t, kKeywordSlots> buildKeywordTable() {
+    std::array<int8_t, kKeywordSlots> table{};
+    for (size_t slot = 0; slot < kKeywordSlots; ++slot) {
+        table[slot] = -1;
+    }
+    for (size_t i = 0; i < kKeywordCount; ++i) {
+        table[keywordSlot(kKeywords[i].name, kKeywordSeed)] = static_cast<int8_t>(i);
+    }
+    return table;
+}
+
+constexpr std::array<int8_t, kKeywordSlots> kKeywordTable = buildKeywordTable();
+
+// One hash and at most one comparison per identifier
+TokenType classifyWord(std::string_view word) {
+    if (word.size() < 2 || word.size() > kMaxKeywordLength) {
+        return TokenType::IDENTIFIER;
+    }
+    int index = kKeywordTable[keywordSlot(word, kKeywordSeed)];
+    if (index < 0 || kKeywords[index].name.size() != word.size()) {
+        return TokenType::IDENTIFIER;
+    }
+    for (size_t i = 0; i < word.size(); ++i) {
+        if (upperAscii(word[i]) != kKeywords[index].name[i]) {
+            return TokenType::IDENTIFIER;
         }
     }
+    return kKeywords[index].type;
+}
+
+bool isDigit(char c) { return c >= '0' && c <= '9'; }
+bool isWordChar(char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; }
+
+}
+
+PLSQLLexer::PLSQLLexer(std::string_view input) : input_(input), position_(0) {}
+
+TokenList PLSQLLexer::tokenize(std::pmr::memory_resource* resource) {
+    TokenList tokens(resource);
+    tokens.reserve(input_.size() / 4 + 2);
     
-    tokens.push_back({TokenType::END_OF_FILE, "", position_});
+    do {
+        tokens.push_back(next());
+    } while (tokens.back().type != TokenType::END_OF_FILE);
     return tokens;
 }
 
-char PLSQLLexer::currentChar() {
-    if (position_ >= input_.length()) return '\0';
-    return input_[position_];
+Token PLSQLLexer::make(TokenType type, size_t start) {
+    return {type, input_.substr(start, position_ - start), start};
 }
 
-void PLSQLLexer::advance() {
-    position_++;
+Token PLSQLLexer::next() {
+    for (;;) {
+        skipWhitespace();
+        if (position_ >= input_.size()) {
+            return {TokenType::END_OF_FILE, input_.substr(input_.size()), input_.size()};
+        }
+        
+        size_t start = position_;
+        char ch = input_[position_];
+        char next = position_ + 1 < input_.size() ? input_[position_ + 1] : '\0';
+        
+        switch (ch) {
+            case ';': position_++; return make(TokenType::SEMICOLON, start);
+            case ',': position_++; return make(TokenType::COMMA, start);
+            case '(': position_++; return make(TokenType::LPAREN, start);
+            case ')': position_++; return make(TokenType::RPAREN, start);
+            case '*': position_++; return make(TokenType::STAR, start);
+            case '-': position_++; return make(TokenType::MINUS, start);
+            case '=': position_++; return make(TokenType::EQ, start);
+            case '<':
+                position_ += (next == '=' || next == '>') ? 2 : 1;
+                return make(next == '=' ? TokenType::LE : next == '>' ? TokenType::NE : TokenType::LT, start);
+            case '>':
+                position_ += next == '=' ? 2 : 1;
+                return make(next == '=' ? TokenType::GE : TokenType::GT, start);
+            case '!':
+                position_++;
+                if (next == '=') {
+                    position_++;
+                    return make(TokenType::NE, start);
+                }
+                continue;  // a lone '!' is skipped
+            case '\'':
+                return readString();
+            case '$':
+                if (isDigit(next)) {
+                    return readParameter();
+                }
+                break;
+            default:
+                if (isDigit(ch)) {
+                    return readNumber();
+                }
+                if (std::isalpha(static_cast<unsigned char>(ch)) || ch == '_') {
+                    return readIdentifier();
+                }
+                break;
+        }
+        position_++; // Skip unknown characters
+    }
 }
 
 void PLSQLLexer::skipWhitespace() {
-    while (position_ < input_.length() && std::isspace(input_[position_])) {
-        advance();
+    while (position_ < input_.size() && std::isspace(static_cast<unsigned char>(input_[position_]))) {
+        position_++;
     }
 }
 
 Token PLSQLLexer::readString() {
     size_t start = position_;
-    advance(); // Skip opening quote
-    
-    std::string value;
-    while (position_ < input_.length() && currentChar() != '\'') {
-        value += currentChar();
-        advance();
+    size_t close = input_.find('\'', start + 1);
+    if (close == std::string_view::npos) {
+        close = input_.size();
     }
     
-    if (position_ < input_.length()) {
-        advance(); // Skip closing quote
-    }
-    
-    return {TokenType::STRING_LITERAL, value, start};
+    // The value excludes the quotes
+    position_ = close < input_.size() ? close + 1 : close;
+    return {TokenType::STRING_LITERAL, input_.substr(start + 1, close - start - 1), start};
 }
 
 Token PLSQLLexer::readNumber() {
     size_t start = position_;
-    std::string value;
-    
-    while (position_ < input_.length() && (std::isdigit(currentChar()) || currentChar() == '.')) {
-        value += currentChar();
-        advance();
+    while (position_ < input_.size() && (isDigit(input_[position_]) || input_[position_] == '.')) {
+        position_++;
     }
-    
-    return {TokenType::NUMBER, value, start};
+    return make(TokenType::NUMBER, start);
+}
+
+// $n, a placeholder for a prepared statement's n-th parameter
+Token PLSQLLexer::readParameter() {
+    size_t start = ++position_; // Skip '$'
+    while (position_ < input_.size() && isDigit(input_[position_])) {
+        position_++;
+    }
+    return {TokenType::PARAMETER, input_.substr(start, position_ - start), start - 1};
 }
 
 Token PLSQLLexer::readIdentifier() {
     size_t start = position_;
-    std::string value;
-    
-    while (position_ < input_.length() && 
-           (std::isalnum(currentChar()) || currentChar() == '_')) {
-        value += currentChar();
-        advance();
+    while (position_ < input_.size() && isWordChar(input_[position_])) {
+        position_++;
     }
     
-    // Convert to uppercase for keyword matching
-    std::string upper_value = value;
-    std::transform(upper_value.begin(), upper_value.end(), upper_value.begin(), ::toupper);
-    
-    // Check for keywords
-    static std::unordered_map<std::string, TokenType> keywords = {
-        {"SELECT", TokenType::SELECT},
-        {"INSERT", TokenType::INSERT},
-        {"UPDATE", TokenType::UPDATE},
-        {"DELETE", TokenType::DELETE},
-        {"CREATE", TokenType::CREATE},
-        {"DROP", TokenType::DROP},
-        {"TABLE", TokenType::TABLE},
-        {"FROM", TokenType::FROM},
-        {"WHERE", TokenType::WHERE},
-        {"INTO", TokenType::INTO},
-        {"VALUES", TokenType::VALUES},
-        {"SET", TokenType::SET},
-        {"AND", TokenType::AND},
-        {"OR", TokenType::OR},
-        {"NOT", TokenType::NOT}
-    };
-    
-    auto it = keywords.find(upper_value);
-    TokenType type = (it != keywords.end()) ? it->second : TokenType::IDENTIFIER;
+    // A qualified name, table.column, is a single identifier
+    if (position_ + 1 < input_.size() && input_[position_] == '.' &&
+        (std::isalpha(static_cast<unsigned char>(input_[position_ + 1])) || input_[position_ + 1] == '_')) {
+        position_++;
+        while (position_ < input_.size() && isWordChar(input_[position_])) {
+            position_++;
+        }
+        return make(TokenType::IDENTIFIER, start);
+    }
     
-    return {type, value, start};
+    Token token = make(TokenType::IDENTIFIER, start);
+    token.type = classifyWord(token.value);
+    return token;
 }
 
-}// Namespace ends here
\ No newline at end of file
+}
@@ -1,12 +1,89 @@
 #include "plsql_parser.h"
 #include "storage_engine.h"
 #include "globals.h"
+#include "session.h"
+#include "bulk_load.h"
+#include "prepared_statement.h"
+#include "join.h"
+#include "cursor.h"
 #include <stdexcept>
 #include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <sstream>
 
 namespace InMemoryDB {
 
-PLSQLParser::PLSQLParser(const std::vector<Token>& tokens) : tokens_(tokens), current_(0) {}
+namespace {
+
+std::string upperValue(const Token& token) {
+    std::string value = token.text();
+    std::transform(value.begin(), value.end(), value.begin(), ::toupper);
+    return value;
+}
+
+// The first of names that table has no column for, or null
+const std::string* unknownColumn(const Table& table, const std::vector<std::string>& names) {
+    const std::vector<Column>& columns = table.getColumns();
+    for (const std::string& name : names) {
+        if (std::none_of(columns.begin(), columns.end(), [&](const Column& column) { return column.name == name; })) {
+            return &name;
+        }
+    }
+    return nullptr;
+}
+
+// EXPLAIN node for aggregating input. There is one group without GROUP
+// BY; with it, statistics bound the groups by the product of the key
+// columns' distinct values (NULL being one more) and by the rows in.
+std::unique_ptr<PlanNode> aggregatePlan(const Table& table, const std::vector<std::string>& group_by,
+                                        std::unique_ptr<PlanNode> input) {
+    std::string label = group_by.empty() ? "Aggregate" : "Hash Aggregate, group by ";
+    for (size_t i = 0; i < group_by.size(); ++i) {
+        label += (i ? ", " : "") + group_by[i];
+    }
+    
+    double rows = group_by.empty() ? 1 : -1;
+    std::shared_ptr<const TableStatistics> stats = table.statistics();
+    if (stats && !group_by.empty() && input->estimated_rows >= 0) {
+        rows = 1;
+        const std::vector<Column>& columns = table.getColumns();
+        for (const std::string& name : group_by) {
+            for (size_t i = 0; i < columns.size(); ++i) {
+                if (columns[i].name == name) {
+                    const ColumnStatistics& column = stats->columns[i];
+                    rows *= std::max(1.0, column.distinctCount() + (column.nulls ? 1 : 0));
+                }
+            }
+        }
+        rows = std::min(rows, std::max(input->estimated_rows, 1.0));
+    }
+    return wrapPlan(label, std::move(input), rows);
+}
+
+// EXPLAIN node for ORDER BY and/or LIMIT over input
+std::unique_ptr<PlanNode> sortPlan(const std::vector<SortKey>& order, size_t limit,
+                                   std::unique_ptr<PlanNode> input) {
+    std::string label = order.empty() ? "Limit " + std::to_string(limit) : "Sort by ";
+    for (size_t i = 0; i < order.size(); ++i) {
+        label += (i ? ", " : "") + order[i].column + (order[i].descending ? " DESC" : "");
+    }
+    if (!order.empty() && limit != kNoLimit) {
+        label += ", limit " + std::to_string(limit);
+    }
+    
+    double rows = input->estimated_rows;
+    if (rows >= 0) {
+        rows = std::min(rows, static_cast<double>(limit));
+    }
+    return wrapPlan(label, std::move(input), rows);
+}
+
+}
+
+PLSQLParser::PLSQLParser(const TokenList& tokens, const Row* parameters)
+    : tokens_(tokens), current_(0), parameters_(parameters), explain_(ExplainMode::NONE) {}
 
 QueryResult PLSQLParser::parse() {
     QueryResult result;
@@ -29,15 +106,38 @@ QueryResult PLSQLParser::parse() {
             return parseCreate();
         case TokenType::DROP:
             return parseDrop();
+        case TokenType::SET:
+            return parseSet();
+        case TokenType::BEGIN:
+        case TokenType::COMMIT:
+        case TokenType::ROLLBACK:
+            return parseTransaction();
+        case TokenType::CHECKPOINT:
+            return parseCheckpoint();
+        case TokenType::COPY:
+            return parseCopy();
+        case TokenType::PREPARE:
+            return parsePrepare();
+        case TokenType::EXECUTE:
+            return parseExecute();
+        case TokenType::DEALLOCATE:
+            return parseDeallocate();
+        case TokenType::SHOW:
+            return parseShow();
+        case TokenType::ANALYZE:
+            return parseAnalyze();
+        case TokenType::EXPLAIN:
+            return parseExplain();
         default:
             result.error_message = "Unsupported SQL statement";
             return result;
     }
 }
 
-Token PLSQLParser::currentToken() {
+const Token& PLSQLParser::currentToken() const {
+    static const Token end_of_file{TokenType::END_OF_FILE, "", 0};
     if (current_ >= tokens_.size()) {
-        return {TokenType::END_OF_FILE, "", 0};
+        return end_of_file;
     }
     return tokens_[current_];
 }
@@ -56,26 +156,257 @@ bool PLSQLParser::match(TokenType type) {
     return false;
 }
 
+// A statement ends with the input, or with one ';' there; anything else
+// left over is an error rather than silently ignored
+bool PLSQLParser::expectEnd(std::string& error) {
+    match(TokenType::SEMICOLON);
+    if (currentToken().type != TokenType::END_OF_FILE) {
+        error = "Unexpected token '" + currentToken().text() + "'";
+        return false;
+    }
+    return true;
+}
+
+bool PLSQLParser::parseLiteral(Value& value) {
+    bool negative = match(TokenType::MINUS);
+    const Token& token = currentToken();
+    
+    if (token.type == TokenType::PARAMETER) {
+        // Bound value of $n; PreparedStatement checks that all are bound.
+        // -$n negates a number, as it does a literal the plan cache bound.
+        size_t number = 0;
+        std::from_chars(token.value.data(), token.value.data() + token.value.size(), number);
+        if (!parameters_ || number == 0 || number > parameters_->size()) {
+            return false;
+        }
+        value = (*parameters_)[number - 1];
+        if (negative) {
+            if (value.isDouble()) {
+                value = -value.asDouble();
+            } else if (value.isInt() && value.asInt() != INT64_MIN) {
+                value = -value.asInt();
+            } else {
+                return false;
+            }
+        }
+    } else if (token.type == TokenType::NUMBER) {
+        // Integer unless there is a decimal point; out of range is an error
+        const char* first = token.value.data();
+        const char* last = first + token.value.size();
+        if (token.value.find('.') != std::string_view::npos) {
+            double number = 0.0;
+            if (std::from_chars(first, last, number).ec != std::errc()) {
+                return false;
+            }
+            value = negative ? -number : number;
+        } else {
+            uint64_t number = 0;
+            if (std::from_chars(first, last, number).ec != std::errc() ||
+                number > uint64_t(INT64_MAX) + (negative ? 1 : 0)) {
+                return false;
+            }
+            value = static_cast<int64_t>(negative ? 0 - number : number);
+        }
+    } else if (negative) {
+        return false;
+    } else if (token.type == TokenType::STRING_LITERAL) {
+        value = token.value;
+    } else if (token.type == TokenType::IDENTIFIER) {
+        // Handle boolean values or null
+        std::string val = upperValue(token);
+        if (val == "TRUE") {
+            value = true;
+        } else if (val == "FALSE") {
+            value = false;
+        } else if (val == "NULL") {
+            value = Value();
+        } else {
+            return false; // a column name, not a value
+        }
+    } else {
+        return false;
+    }
+    
+    advance();
+    return true;
+}
+
+static bool toCompareOp(TokenType type, CompareOp& op) {
+    switch (type) {
+        case TokenType::EQ: op = CompareOp::EQ; return true;
+        case TokenType::NE: op = CompareOp::NE; return true;
+        case TokenType::LT: op = CompareOp::LT; return true;
+        case TokenType::LE: op = CompareOp::LE; return true;
+        case TokenType::GT: op = CompareOp::GT; return true;
+        case TokenType::GE: op = CompareOp::GE; return true;
+        default: return false;
+    }
+}
+
+// condition := and_expr { OR and_expr }
+std::unique_ptr<Predicate> PLSQLParser::parseOr(std::string& error) {
+    auto left = parseAnd(error);
+    while (left && match(TokenType::OR)) {
+        auto right = parseAnd(error);
+        if (!right) return nullptr;
+        left = Predicate::logical(Predicate::Kind::OR, std::move(left), std::move(right));
+    }
+    return left;
+}
+
+// and_expr := not_expr { AND not_expr }
+std::unique_ptr<Predicate> PLSQLParser::parseAnd(std::string& error) {
+    auto left = parseNot(error);
+    while (left && match(TokenType::AND)) {
+        auto right = parseNot(error);
+        if (!right) return nullptr;
+        left = Predicate::logical(Predicate::Kind::AND, std::move(left), std::move(right));
+    }
+    return left;
+}
+
+// not_expr := NOT not_expr | '(' condition ')' | comparison
+std::unique_ptr<Predicate> PLSQLParser::parseNot(std::string& error) {
+    if (match(TokenType::NOT)) {
+        auto operand = parseNot(error);
+        if (!operand) return nullptr;
+        return Predicate::logical(Predicate::Kind::NOT, std::move(operand));
+    }
+    
+    if (match(TokenType::LPAREN)) {
+        auto inner = parseOr(error);
+        if (!inner) return nullptr;
+        if (!match(TokenType::RPAREN)) {
+            error = "Expected ')' in WHERE clause";
+            return nullptr;
+        }
+        return inner;
+    }
+    
+    return parseComparison(error);
+}
+
+// comparison := column op literal | literal op column
+//             | column [NOT] BETWEEN literal AND literal
+std::unique_ptr<Predicate> PLSQLParser::parseComparison(std::string& error) {
+    std::string column;
+    Value literal;
+    CompareOp op;
+    bool column_first = currentToken().type == TokenType::IDENTIFIER;
+    
+    if (column_first) {
+        column = currentToken().text();
+        advance();
+        
+        bool negated = currentToken().type == TokenType::NOT &&
+                       current_ + 1 < tokens_.size() && tokens_[current_ + 1].type == TokenType::BETWEEN;
+        if (negated) {
+            advance();
+        }
+        if (match(TokenType::BETWEEN)) {
+            Value low, high;
+            if (!parseLiteral(low) || !match(TokenType::AND) || !parseLiteral(high)) {
+                error = "Expected 'BETWEEN value AND value' in WHERE clause";
+                return nullptr;
+            }
+            auto range = Predicate::logical(Predicate::Kind::AND,
+                                            Predicate::compare(column, CompareOp::GE, low),
+                                            Predicate::compare(column, CompareOp::LE, high));
+            return negated ? Predicate::logical(Predicate::Kind::NOT, std::move(range)) : std::move(range);
+        }
+    } else if (!parseLiteral(literal)) {
+        error = "Expected column name or value in WHERE clause";
+        return nullptr;
+    }
+    
+    if (!toCompareOp(currentToken().type, op)) {
+        error = "Expected comparison operator in WHERE clause";
+        return nullptr;
+    }
+    advance();
+    
+    if (column_first) {
+        if (!parseLiteral(literal)) {
+            error = currentToken().type == TokenType::IDENTIFIER
+                        ? "Cannot compare column '" + column + "' with column '" + currentToken().text() + "'"
+                        : "Expected value in WHERE clause";
+            return nullptr;
+        }
+    } else {
+        if (currentToken().type != TokenType::IDENTIFIER) {
+            error = "Expected column name in WHERE clause";
+            return nullptr;
+        }
+        column = currentToken().text();
+        advance();
+        op = reverseCompareOp(op);
+    }
+    
+    return Predicate::compare(column, op, literal);
+}
+
+// A column name, or COUNT(*) or FUNCTION(column)
+bool PLSQLParser::parseSelectItem(SelectItem& item, std::string& error) {
+    if (currentToken().type != TokenType::IDENTIFIER) {
+        error = "Expected column name";
+        return false;
+    }
+    item.column = currentToken().text();
+    advance();
+    if (!match(TokenType::LPAREN)) {
+        return true;
+    }
+    
+    std::string name = item.column;
+    std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+    if (name == "COUNT") {
+        item.function = AggregateFunction::COUNT;
+    } else if (name == "SUM") {
+        item.function = AggregateFunction::SUM;
+    } else if (name == "AVG") {
+        item.function = AggregateFunction::AVG;
+    } else if (name == "MIN") {
+        item.function = AggregateFunction::MIN;
+    } else if (name == "MAX") {
+        item.function = AggregateFunction::MAX;
+    } else {
+        error = "Unknown aggregate function '" + item.column + "'";
+        return false;
+    }
+    
+    item.column.clear();
+    if (item.function == AggregateFunction::COUNT && match(TokenType::STAR)) {
+        // COUNT(*) counts rows
+    } else if (currentToken().type == TokenType::IDENTIFIER) {
+        item.column = currentToken().text();
+        advance();
+    } else {
+        error = "Expected column name in " + name + "()";
+        return false;
+    }
+    if (!match(TokenType::RPAREN)) {
+        error = "Expected ')' after " + name + " argument";
+        return false;
+    }
+    return true;
+}
+
 QueryResult PLSQLParser::parseSelect() {
     QueryResult result;
     advance(); // consume SELECT
     
-    std::vector<std::string> columns;
+    std::vector<SelectItem> items;
+    bool aggregated = false;
     
     // Parse column list
-    if (currentToken().value == "*") {
-        advance();
+    if (match(TokenType::STAR)) {
         // Select all columns - will be handled in table.select()
     } else {
-        // Parse specific columns
         do {
-            if (currentToken().type == TokenType::IDENTIFIER) {
-                columns.push_back(currentToken().value);
-                advance();
-            } else {
-                result.error_message = "Expected column name";
+            if (!parseSelectItem(items.emplace_back(), result.error_message)) {
                 return result;
             }
+            aggregated |= items.back().function != AggregateFunction::NONE;
         } while (match(TokenType::COMMA));
     }
     
@@ -90,8 +421,143 @@ QueryResult PLSQLParser::parseSelect() {
         return result;
     }
     
-    std::string table_name = currentToken().value;
+    std::string table_name = currentToken().text();
     advance();
+    std::string table_alias = table_name;
+    if (currentToken().type == TokenType::IDENTIFIER) {
+        table_alias = currentToken().text();
+        advance();
+    }
+    
+    // Parse optional [INNER | LEFT [OUTER]] JOIN table [alias] ON a = b
+    bool joined = true;
+    JoinType join_type = JoinType::INNER;
+    if (match(TokenType::LEFT)) {
+        join_type = JoinType::LEFT;
+        match(TokenType::OUTER);
+    } else if (!match(TokenType::INNER) && currentToken().type != TokenType::JOIN) {
+        joined = false;
+    }
+    std::string join_table, join_alias, join_left, join_right;
+    if (joined) {
+        if (!match(TokenType::JOIN)) {
+            result.error_message = "Expected JOIN keyword";
+            return result;
+        }
+        if (currentToken().type != TokenType::IDENTIFIER) {
+            result.error_message = "Expected table name after JOIN";
+            return result;
+        }
+        join_table = currentToken().text();
+        advance();
+        join_alias = join_table;
+        if (currentToken().type == TokenType::IDENTIFIER) {
+            join_alias = currentToken().text();
+            advance();
+        }
+        if (!match(TokenType::ON)) {
+            result.error_message = "Expected ON after JOIN table";
+            return result;
+        }
+        if (currentToken().type != TokenType::IDENTIFIER) {
+            result.error_message = "Expected column name in ON clause";
+            return result;
+        }
+        join_left = currentToken().text();
+        advance();
+        if (!match(TokenType::EQ) || currentToken().type != TokenType::IDENTIFIER) {
+            result.error_message = "Only column = column joins are supported";
+            return result;
+        }
+        join_right = currentToken().text();
+        advance();
+    }
+    
+    // Parse optional WHERE clause
+    std::unique_ptr<Predicate> where;
+    if (match(TokenType::WHERE)) {
+        where = parseOr(result.error_message);
+        if (!where) {
+            return result;
+        }
+    }
+    
+    // Parse optional GROUP BY clause
+    std::vector<std::string> group_by;
+    if (match(TokenType::GROUP)) {
+        if (!match(TokenType::BY)) {
+            result.error_message = "Expected BY after GROUP";
+            return result;
+        }
+        do {
+            if (currentToken().type != TokenType::IDENTIFIER) {
+                result.error_message = "Expected column name in GROUP BY";
+                return result;
+            }
+            group_by.push_back(currentToken().text());
+            advance();
+        } while (match(TokenType::COMMA));
+        aggregated = true;
+    }
+    
+    // Parse optional ORDER BY and LIMIT clauses
+    std::vector<SortKey> order;
+    if (match(TokenType::ORDER)) {
+        if (!match(TokenType::BY)) {
+            result.error_message = "Expected BY after ORDER";
+            return result;
+        }
+        do {
+            SelectItem key;
+            if (!parseSelectItem(key, result.error_message)) {
+                return result;
+            }
+            order.push_back({key.label(), match(TokenType::DESC)});
+            if (!order.back().descending) {
+                match(TokenType::ASC);
+            }
+        } while (match(TokenType::COMMA));
+    }
+    size_t limit = kNoLimit;
+    if (match(TokenType::LIMIT)) {
+        Value count;
+        if (!parseLiteral(count) || !count.isInt() || count.asInt() < 0) {
+            result.error_message = "LIMIT expects a non-negative integer";
+            return result;
+        }
+        limit = static_cast<size_t>(count.asInt());
+    }
+    if (!expectEnd(result.error_message)) {
+        return result;
+    }
+    
+    if (aggregated && items.empty()) {
+        result.error_message = "SELECT * cannot be used with GROUP BY";
+        return result;
+    }
+    if (aggregated && joined) {
+        result.error_message = "Aggregates over a join are not supported";
+        return result;
+    }
+    
+    // Without a join, a column qualified with the table's name is the column
+    if (!joined) {
+        std::string prefix = table_alias + ".";
+        auto unqualify = [&](std::string& name) {
+            if (name.compare(0, prefix.size(), prefix) == 0) {
+                name.erase(0, prefix.size());
+            }
+        };
+        for (SelectItem& item : items) {
+            unqualify(item.column);
+        }
+        for (std::string& name : group_by) {
+            unqualify(name);
+        }
+        for (SortKey& key : order) {
+            unqualify(key.column);
+        }
+    }
     
     // Get table from storage engine
     if (!g_storage_engine) {
@@ -99,19 +565,148 @@ QueryResult PLSQLParser::parseSelect() {
         return result;
     }
     
-    Table* table = g_storage_engine->getTable(table_name);
+    std::shared_ptr<Table> table = g_storage_engine->getTable(table_name);
     if (!table) {
         result.error_message = "Table '" + table_name + "' does not exist";
         return result;
     }
     
-    // Execute select
-    if (columns.empty()) {
-        result = table->select(); // Select all
-    } else {
-        result = table->select(columns);
+    std::vector<std::string> columns;
+    for (const SelectItem& item : items) {
+        columns.push_back(item.column);
+    }
+    
+    std::unique_ptr<HashJoin> join;
+    if (joined) {
+        std::shared_ptr<Table> right = g_storage_engine->getTable(join_table);
+        if (!right) {
+            result.error_message = "Table '" + join_table + "' does not exist";
+            return result;
+        }
+        join = std::make_unique<HashJoin>(join_type, table, table_alias, right, join_alias);
+        if (!join->bind(join_left, join_right, columns, std::move(where), result.error_message)) {
+            return result;
+        }
+    } else if (where && !where->bind(table->getColumns(), result.error_message, table_alias)) {
+        return result;
+    }
+    
+    // EXPLAIN asks each operator how it would run: the join or the table
+    // read, under any aggregation, under any ORDER BY or LIMIT
+    std::unique_ptr<PlanNode> plan;
+    PlanNode* input = nullptr;  // the node under the Sort or Limit, or the root
+    bool wrapped = !order.empty() || limit != kNoLimit;
+    if (explain_ != ExplainMode::NONE) {
+        plan = join ? join->explain() : table->explainAccess(where.get());
+        if (aggregated) {
+            plan = aggregatePlan(*table, group_by, std::move(plan));
+        }
+        input = plan.get();
+        if (wrapped) {
+            plan = sortPlan(order, limit, std::move(plan));
+        }
+    }
+    
+    // Plain EXPLAIN runs nothing, so it checks the names the operators
+    // would resolve itself
+    if (explain_ == ExplainMode::PLAN) {
+        std::vector<std::string> names = group_by;
+        for (const SelectItem& item : items) {
+            if (!item.column.empty()) {
+                names.push_back(item.column);
+            }
+        }
+        for (const SortKey& key : order) {
+            if (!aggregated) {  // an aggregate's keys name its output columns
+                names.push_back(key.column);
+            }
+        }
+        const std::string* unknown = join ? nullptr : unknownColumn(*table, names);
+        if (unknown) {
+            result.error_message = "Unknown column '" + *unknown + "'";
+            return result;
+        }
+        return explainResult(*plan, false);
+    }
+    
+    // Outside a transaction the cursor gets a snapshot of its own
+    std::shared_ptr<Transaction> txn = Session::current().transaction;
+    if (!txn) {
+        txn = g_storage_engine->beginTransaction();
+    }
+    
+    // EXPLAIN ANALYZE runs the query as below with each operator profiling
+    // into its node, drains the rows, and returns the plan instead
+    if (plan) {
+        {
+            ProfileScope scope(&plan->profile);
+            if (aggregated || join) {
+                result = aggregated ? table->aggregate(items, group_by, where.get(), txn->view(), input)
+                                    : join->execute(txn->view(), input);
+                size_t rows_in = result.rows.size();
+                std::string error;
+                if (result.success && !sortRows(result, order, limit, Session::current().parallelism, error)) {
+                    result = QueryResult();
+                    result.error_message = error;
+                }
+                if (wrapped) {
+                    plan->profile.rows_in += rows_in;
+                    plan->profile.rows_out += result.rows.size();
+                }
+            } else if (!order.empty()) {
+                result = table->selectOrdered(columns, where.get(), txn->view(), order, limit, plan.get());
+            } else if (std::shared_ptr<ResultCursor> cursor = table->openCursor(columns, std::move(where), txn, input)) {
+                LimitCursor limited(cursor, limit);
+                RowBatch batch;
+                size_t rows = 0;
+                while (limited.next(batch)) {
+                    rows += batch.size;
+                }
+                if (wrapped) {
+                    plan->profile.rows_in += input->profile.rows_out;
+                    plan->profile.rows_out += rows;
+                }
+                result.success = true;
+            } else {
+                result.error_message = "Unknown column in select list";
+            }
+        }
+        return result.success ? explainResult(*plan, true) : result;
+    }
+    
+    // Aggregates are computed in place over the column vectors and only
+    // the groups are returned; joins also return materialized rows. Their
+    // ORDER BY and LIMIT apply to those rows.
+    if (aggregated || join) {
+        result = aggregated ? table->aggregate(items, group_by, where.get(), txn->view())
+                            : join->execute(txn->view());
+        std::string error;
+        if (result.success && !sortRows(result, order, limit, Session::current().parallelism, error)) {
+            result = QueryResult();
+            result.error_message = error;
+        }
+        return result;
+    }
+    
+    // Ordered rows are sorted by position and only the first limit copied
+    if (!order.empty()) {
+        return table->selectOrdered(columns, where.get(), txn->view(), order, limit);
+    }
+    
+    // Execute select; rows are streamed to the caller through a cursor
+    std::shared_ptr<ResultCursor> cursor = table->openCursor(columns, std::move(where), txn);
+    if (!cursor) {
+        result.error_message = "Unknown column in select list";
+        return result;
     }
     
+    result.columns = cursor->columns();
+    result.cursor = cursor;
+    if (limit != kNoLimit) {
+        result.cursor = std::make_shared<LimitCursor>(cursor, limit);
+    }
+    result.success = true;
+    
     return result;
 }
 
@@ -129,7 +724,7 @@ QueryResult PLSQLParser::parseInsert() {
         return result;
     }
     
-    std::string table_name = currentToken().value;
+    std::string table_name = currentToken().text();
     advance();
     
     if (!match(TokenType::VALUES)) {
@@ -137,47 +732,31 @@ QueryResult PLSQLParser::parseInsert() {
         return result;
     }
     
-    if (!match(TokenType::LPAREN)) {
-        result.error_message = "Expected '('";
-        return result;
-    }
-    
-    // Parse values
-    Row values;
+    // One or more tuples; values are parsed in place into their rows, and
+    // the tuple list itself lives in the statement arena
+    std::pmr::vector<Row> rows(&Session::current().arena);
     do {
-        Token token = currentToken();
-        if (token.type == TokenType::NUMBER) {
-            // Try to parse as integer first, then double
-            std::string val = token.value;
-            if (val.find('.') != std::string::npos) {
-                values.push_back(std::stod(val));
-            } else {
-                values.push_back(std::stoi(val));
-            }
-            advance();
-        } else if (token.type == TokenType::STRING_LITERAL) {
-            values.push_back(token.value);
-            advance();
-        } else if (token.type == TokenType::IDENTIFIER) {
-            // Handle boolean values or null
-            std::string val = token.value;
-            std::transform(val.begin(), val.end(), val.begin(), ::toupper);
-            if (val == "TRUE") {
-                values.push_back(true);
-            } else if (val == "FALSE") {
-                values.push_back(false);
-            } else {
-                values.push_back(token.value); // Treat as string
+        if (!match(TokenType::LPAREN)) {
+            result.error_message = "Expected '('";
+            return result;
+        }
+        
+        rows.emplace_back();
+        Row& row = rows.back();
+        row.reserve(rows.size() > 1 ? rows[0].size() : 0);
+        do {
+            if (!parseLiteral(row.emplace_back())) {
+                result.error_message = "Invalid value type";
+                return result;
             }
-            advance();
-        } else {
-            result.error_message = "Invalid value type";
+        } while (match(TokenType::COMMA));
+        
+        if (!match(TokenType::RPAREN)) {
+            result.error_message = "Expected ')'";
             return result;
         }
     } while (match(TokenType::COMMA));
-    
-    if (!match(TokenType::RPAREN)) {
-        result.error_message = "Expected ')'";
+    if (!expectEnd(result.error_message)) {
         return result;
     }
     
@@ -187,78 +766,220 @@ QueryResult PLSQLParser::parseInsert() {
         return result;
     }
     
-    Table* table = g_storage_engine->getTable(table_name);
+    std::shared_ptr<Table> table = g_storage_engine->getTable(table_name);
     if (!table) {
         result.error_message = "Table '" + table_name + "' does not exist";
         return result;
     }
     
-    if (table->insert(values)) {
+    std::shared_ptr<Transaction> txn;
+    if (!beginStatement(txn, result)) {
+        return result;
+    }
+    
+    // The tuples go in together, under one lock, or not at all
+    if (table->insertBatch(rows.data(), rows.size(), txn.get())) {
         result.success = true;
+        result.rows_affected = rows.size();
     } else {
-        result.error_message = "Failed to insert row";
+        result.error_message = rows.size() == 1 ? "Failed to insert row" : "Failed to insert rows";
     }
     
+    finishStatement(*txn, result);
     return result;
 }
 
 QueryResult PLSQLParser::parseUpdate() {
     QueryResult result;
-    result.error_message = "UPDATE not implemented yet";
-    return result;
-}
-
-QueryResult PLSQLParser::parseDelete() {
-    QueryResult result;
-    result.error_message = "DELETE not implemented yet";
-    return result;
-}
-
-QueryResult PLSQLParser::parseCreate() {
-    QueryResult result;
-    advance(); // consume CREATE
-    
-    if (!match(TokenType::TABLE)) {
-        result.error_message = "Expected TABLE keyword";
-        return result;
-    }
+    advance(); // consume UPDATE
     
     if (currentToken().type != TokenType::IDENTIFIER) {
         result.error_message = "Expected table name";
         return result;
     }
     
-    std::string table_name = currentToken().value;
+    std::string table_name = currentToken().text();
     advance();
     
-    if (!match(TokenType::LPAREN)) {
-        result.error_message = "Expected '('";
+    if (!match(TokenType::SET)) {
+        result.error_message = "Expected SET keyword";
         return result;
     }
     
-    // Parse column definitions
-    std::vector<Column> columns;
+    // Parse assignments
+    std::vector<std::string> columns;
+    Row values;
     do {
         if (currentToken().type != TokenType::IDENTIFIER) {
             result.error_message = "Expected column name";
             return result;
         }
-        
-        std::string col_name = currentToken().value;
+        columns.push_back(currentToken().text());
         advance();
         
-        if (currentToken().type != TokenType::IDENTIFIER) {
-            result.error_message = "Expected column type";
+        if (!match(TokenType::EQ)) {
+            result.error_message = "Expected '='";
             return result;
         }
         
-        std::string type_str = currentToken().value;
-        std::transform(type_str.begin(), type_str.end(), type_str.begin(), ::toupper);
-        advance();
-        
-        DataType type;
-        if (type_str == "INT" || type_str == "INTEGER") {
-            type = DataType::INTEGER;
+        Value value;
+        if (!parseLiteral(value)) {
+            result.error_message = "Invalid value type";
+            return result;
+        }
+        values.push_back(value);
+    } while (match(TokenType::COMMA));
+    
+    // Parse optional WHERE clause
+    std::unique_ptr<Predicate> where;
+    if (match(TokenType::WHERE)) {
+        where = parseOr(result.error_message);
+        if (!where) {
+            return result;
+        }
+    }
+    if (!expectEnd(result.error_message)) {
+        return result;
+    }
+    
+    // Get table and update
+    if (!g_storage_engine) {
+        result.error_message = "Storage engine not initialized";
+        return result;
+    }
+    
+    std::shared_ptr<Table> table = g_storage_engine->getTable(table_name);
+    if (!table) {
+        result.error_message = "Table '" + table_name + "' does not exist";
+        return result;
+    }
+    
+    if (where && !where->bind(table->getColumns(), result.error_message)) {
+        return result;
+    }
+    
+    std::shared_ptr<Transaction> txn;
+    if (!beginStatement(txn, result)) {
+        return result;
+    }
+    
+    if (table->updateWhere(where.get(), columns, values, result.rows_affected, txn.get())) {
+        result.success = true;
+    } else {
+        result.error_message = "Failed to update rows";
+    }
+    
+    finishStatement(*txn, result);
+    return result;
+}
+
+QueryResult PLSQLParser::parseDelete() {
+    QueryResult result;
+    advance(); // consume DELETE
+    
+    if (!match(TokenType::FROM)) {
+        result.error_message = "Expected FROM keyword";
+        return result;
+    }
+    
+    if (currentToken().type != TokenType::IDENTIFIER) {
+        result.error_message = "Expected table name";
+        return result;
+    }
+    
+    std::string table_name = currentToken().text();
+    advance();
+    
+    // Parse optional WHERE clause
+    std::unique_ptr<Predicate> where;
+    if (match(TokenType::WHERE)) {
+        where = parseOr(result.error_message);
+        if (!where) {
+            return result;
+        }
+    }
+    if (!expectEnd(result.error_message)) {
+        return result;
+    }
+    
+    // Get table and delete
+    if (!g_storage_engine) {
+        result.error_message = "Storage engine not initialized";
+        return result;
+    }
+    
+    std::shared_ptr<Table> table = g_storage_engine->getTable(table_name);
+    if (!table) {
+        result.error_message = "Table '" + table_name + "' does not exist";
+        return result;
+    }
+    
+    if (where && !where->bind(table->getColumns(), result.error_message)) {
+        return result;
+    }
+    
+    std::shared_ptr<Transaction> txn;
+    if (!beginStatement(txn, result)) {
+        return result;
+    }
+    
+    result.success = table->deleteWhere(where.get(), result.rows_affected, txn.get());
+    finishStatement(*txn, result);
+    if (result.success && result.rows_affected > 0) {
+        g_storage_engine->wakeCompactor();
+    }
+    return result;
+}
+
+QueryResult PLSQLParser::parseCreate() {
+    QueryResult result;
+    advance(); // consume CREATE
+    
+    if (currentToken().type == TokenType::INDEX) {
+        return parseCreateIndex();
+    }
+    
+    if (!match(TokenType::TABLE)) {
+        result.error_message = "Expected TABLE keyword";
+        return result;
+    }
+    
+    if (currentToken().type != TokenType::IDENTIFIER) {
+        result.error_message = "Expected table name";
+        return result;
+    }
+    
+    std::string table_name = currentToken().text();
+    advance();
+    
+    if (!match(TokenType::LPAREN)) {
+        result.error_message = "Expected '('";
+        return result;
+    }
+    
+    // Parse column definitions
+    std::vector<Column> columns;
+    do {
+        if (currentToken().type != TokenType::IDENTIFIER) {
+            result.error_message = "Expected column name";
+            return result;
+        }
+        
+        std::string col_name = currentToken().text();
+        advance();
+        
+        if (currentToken().type != TokenType::IDENTIFIER) {
+            result.error_message = "Expected column type";
+            return result;
+        }
+        
+        std::string type_str = currentToken().text();
+        std::transform(type_str.begin(), type_str.end(), type_str.begin(), ::toupper);
+        advance();
+        
+        DataType type;
+        if (type_str == "INT" || type_str == "INTEGER") {
+            type = DataType::INTEGER;
         } else if (type_str == "DOUBLE" || type_str == "FLOAT") {
             type = DataType::DOUBLE;
         } else if (type_str == "VARCHAR" || type_str == "STRING" || type_str == "TEXT") {
@@ -278,6 +999,9 @@ QueryResult PLSQLParser::parseCreate() {
         result.error_message = "Expected ')'";
         return result;
     }
+    if (!expectEnd(result.error_message)) {
+        return result;
+    }
     
     // Create table
     if (!g_storage_engine) {
@@ -298,6 +1022,10 @@ QueryResult PLSQLParser::parseDrop() {
     QueryResult result;
     advance(); // consume DROP
     
+    if (currentToken().type == TokenType::INDEX) {
+        return parseDropIndex();
+    }
+    
     if (!match(TokenType::TABLE)) {
         result.error_message = "Expected TABLE keyword";
         return result;
@@ -308,8 +1036,11 @@ QueryResult PLSQLParser::parseDrop() {
         return result;
     }
     
-    std::string table_name = currentToken().value;
+    std::string table_name = currentToken().text();
     advance();
+    if (!expectEnd(result.error_message)) {
+        return result;
+    }
     
     // Drop table
     if (!g_storage_engine) {
@@ -326,4 +1057,680 @@ QueryResult PLSQLParser::parseDrop() {
     return result;
 }
 
-}
\ No newline at end of file
+// CREATE INDEX name ON table (column) [USING HASH | BTREE]
+QueryResult PLSQLParser::parseCreateIndex() {
+    QueryResult result;
+    advance(); // consume INDEX
+    
+    if (currentToken().type != TokenType::IDENTIFIER) {
+        result.error_message = "Expected index name";
+        return result;
+    }
+    
+    std::string index_name = currentToken().text();
+    advance();
+    
+    if (!match(TokenType::ON)) {
+        result.error_message = "Expected ON keyword";
+        return result;
+    }
+    
+    if (currentToken().type != TokenType::IDENTIFIER) {
+        result.error_message = "Expected table name";
+        return result;
+    }
+    
+    std::string table_name = currentToken().text();
+    advance();
+    
+    if (!match(TokenType::LPAREN) || currentToken().type != TokenType::IDENTIFIER) {
+        result.error_message = "Expected '(' column ')'";
+        return result;
+    }
+    
+    std::string column_name = currentToken().text();
+    advance();
+    
+    if (!match(TokenType::RPAREN)) {
+        result.error_message = "Expected ')'";
+        return result;
+    }
+    
+    IndexType type = IndexType::HASH;
+    if (match(TokenType::USING)) {
+        std::string type_str = currentToken().text();
+        std::transform(type_str.begin(), type_str.end(), type_str.begin(), ::toupper);
+        if (type_str == "HASH") {
+            type = IndexType::HASH;
+        } else if (type_str == "BTREE") {
+            type = IndexType::BTREE;
+        } else {
+            result.error_message = "Unsupported index type: " + currentToken().text();
+            return result;
+        }
+        advance();
+    }
+    if (!expectEnd(result.error_message)) {
+        return result;
+    }
+    
+    // Create index
+    if (!g_storage_engine) {
+        result.error_message = "Storage engine not initialized";
+        return result;
+    }
+    
+    if (g_storage_engine->createIndex(index_name, table_name, column_name, type)) {
+        result.success = true;
+    } else {
+        result.error_message = "Failed to create index (name in use, or column unknown or already indexed)";
+    }
+    
+    return result;
+}
+
+QueryResult PLSQLParser::parseDropIndex() {
+    QueryResult result;
+    advance(); // consume INDEX
+    
+    if (currentToken().type != TokenType::IDENTIFIER) {
+        result.error_message = "Expected index name";
+        return result;
+    }
+    
+    std::string index_name = currentToken().text();
+    advance();
+    if (!expectEnd(result.error_message)) {
+        return result;
+    }
+    
+    // Drop index
+    if (!g_storage_engine) {
+        result.error_message = "Storage engine not initialized";
+        return result;
+    }
+    
+    if (g_storage_engine->dropIndex(index_name)) {
+        result.success = true;
+    } else {
+        result.error_message = "Failed to drop index (may not exist)";
+    }
+    
+    return result;
+}
+
+// SET PARALLELISM = n | SET COMPACTION_THRESHOLD = ratio |
+// SET STATISTICS_THRESHOLD = ratio | SET DURABILITY = ASYNC | SYNC | SET GROUP_COMMIT_WINDOW = microseconds |
+// SET PLAN_CACHE_SIZE = statements
+QueryResult PLSQLParser::parseSet() {
+    QueryResult result;
+    advance(); // consume SET
+    
+    if (currentToken().type != TokenType::IDENTIFIER) {
+        result.error_message = "Expected setting name";
+        return result;
+    }
+    
+    std::string name = currentToken().text();
+    std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+    advance();
+    
+    if (!match(TokenType::EQ)) {
+        result.error_message = "Expected '=' after setting name";
+        return result;
+    }
+    
+    // Values may be literals or bare words, as in SET DURABILITY = SYNC
+    Value value;
+    if (currentToken().type == TokenType::IDENTIFIER) {
+        std::string word = currentToken().text();
+        std::transform(word.begin(), word.end(), word.begin(), ::toupper);
+        value = word;
+        advance();
+    } else if (!parseLiteral(value)) {
+        result.error_message = "Expected value for " + name;
+        return result;
+    }
+    if (!expectEnd(result.error_message)) {
+        return result;
+    }
+    
+    if (name == "PARALLELISM") {
+        if (!value.isInt() || value.asInt() < 1 || value.asInt() > INT32_MAX) {
+            result.error_message = "PARALLELISM must be a positive integer";
+            return result;
+        }
+        Session::current().parallelism = static_cast<int>(value.asInt());
+    } else if (name == "COMPACTION_THRESHOLD") {
+        double threshold = value.isNumber() ? value.asDouble() : -1.0;
+        if (threshold < 0.0 || threshold > 1.0) {
+            result.error_message = "COMPACTION_THRESHOLD must be between 0 and 1";
+            return result;
+        }
+        if (!g_storage_engine) {
+            result.error_message = "Storage engine not initialized";
+            return result;
+        }
+        g_storage_engine->setCompactionThreshold(threshold);
+    } else if (name == "STATISTICS_THRESHOLD") {
+        double threshold = value.isNumber() ? value.asDouble() : -1.0;
+        if (threshold < 0.0 || threshold > 1.0) {
+            result.error_message = "STATISTICS_THRESHOLD must be between 0 and 1";
+            return result;
+        }
+        if (!g_storage_engine) {
+            result.error_message = "Storage engine not initialized";
+            return result;
+        }
+        g_storage_engine->setStatisticsThreshold(threshold);
+    } else if (name == "PLAN_CACHE_SIZE") {
+        if (!value.isInt() || value.asInt() < 0) {
+            result.error_message = "PLAN_CACHE_SIZE must be a non-negative integer";
+            return result;
+        }
+        PlanCache::instance().setCapacity(static_cast<size_t>(value.asInt()));
+    } else if (name == "DURABILITY" || name == "GROUP_COMMIT_WINDOW") {
+        // Logging itself is switched on at startup with --wal
+        if (!g_storage_engine || !g_storage_engine->log().isOpen()) {
+            result.error_message = "No write-ahead log is open";
+            return result;
+        }
+        WriteAheadLog& log = g_storage_engine->log();
+        if (name == "GROUP_COMMIT_WINDOW") {
+            if (!value.isInt() || value.asInt() < 0) {
+                result.error_message = "GROUP_COMMIT_WINDOW must be a non-negative number of microseconds";
+                return result;
+            }
+            log.setGroupWindow(std::chrono::microseconds(value.asInt()));
+        } else if (value == Value("SYNC")) {
+            log.setDurability(Durability::SYNC);
+        } else if (value == Value("ASYNC")) {
+            log.setDurability(Durability::ASYNC);
+        } else {
+            result.error_message = "DURABILITY must be ASYNC or SYNC";
+            return result;
+        }
+    } else {
+        result.error_message = "Unknown setting '" + name + "'";
+        return result;
+    }
+    
+    result.success = true;
+    return result;
+}
+
+// Writes run in the session's transaction, or in one of their own that
+// commits with the statement
+bool PLSQLParser::beginStatement(std::shared_ptr<Transaction>& txn, QueryResult& result) {
+    txn = Session::current().transaction;
+    if (txn && txn->doomed()) {
+        result.error_message = "Current transaction is aborted; ROLLBACK required";
+        return false;
+    }
+    if (!txn) {
+        txn = g_storage_engine->beginTransaction();
+    }
+    return true;
+}
+
+void PLSQLParser::finishStatement(Transaction& txn, QueryResult& result) {
+    bool autocommit = Session::current().transaction.get() != &txn;
+    
+    if (txn.doomed()) {
+        result.success = false;
+        result.error_message = "Write-write conflict: a concurrent transaction changed the same row";
+    }
+    
+    if (!autocommit) {
+        return;
+    }
+    if (result.success) {
+        result.success = g_storage_engine->commit(txn, result.error_message);
+    } else {
+        g_storage_engine->rollback(txn);
+    }
+}
+
+// BEGIN [TRANSACTION | WORK] | COMMIT | ROLLBACK
+QueryResult PLSQLParser::parseTransaction() {
+    QueryResult result;
+    TokenType statement = currentToken().type;
+    advance();
+    
+    if (currentToken().type == TokenType::IDENTIFIER) {
+        std::string word = currentToken().text();
+        std::transform(word.begin(), word.end(), word.begin(), ::toupper);
+        if (word == "TRANSACTION" || word == "WORK") {
+            advance();
+        }
+    }
+    if (!expectEnd(result.error_message)) {
+        return result;
+    }
+    
+    if (!g_storage_engine) {
+        result.error_message = "Storage engine not initialized";
+        return result;
+    }
+    
+    std::shared_ptr<Transaction>& txn = Session::current().transaction;
+    if (statement == TokenType::BEGIN) {
+        if (txn) {
+            result.error_message = "A transaction is already in progress";
+            return result;
+        }
+        txn = g_storage_engine->beginTransaction();
+        result.success = true;
+        return result;
+    }
+    
+    if (!txn) {
+        result.error_message = "No transaction in progress";
+        return result;
+    }
+    
+    if (statement == TokenType::COMMIT) {
+        result.success = g_storage_engine->commit(*txn, result.error_message);
+    } else {
+        g_storage_engine->rollback(*txn);
+        result.success = true;
+    }
+    txn.reset();
+    return result;
+}
+
+QueryResult PLSQLParser::parseCheckpoint() {
+    QueryResult result;
+    advance(); // consume CHECKPOINT
+    if (!expectEnd(result.error_message)) {
+        return result;
+    }
+    
+    if (!g_storage_engine) {
+        result.error_message = "Storage engine not initialized";
+        return result;
+    }
+    
+    result.success = g_storage_engine->checkpoint(result.error_message);
+    return result;
+}
+
+// COPY table FROM | TO 'path' [CSV [HEADER] [DELIMITER 'c'] | BINARY]
+QueryResult PLSQLParser::parseCopy() {
+    QueryResult result;
+    advance(); // consume COPY
+    
+    if (currentToken().type != TokenType::IDENTIFIER) {
+        result.error_message = "Expected table name";
+        return result;
+    }
+    std::string table_name = currentToken().text();
+    advance();
+    
+    // TO is not a keyword elsewhere, so it arrives as an identifier
+    bool from = false;
+    if (match(TokenType::FROM)) {
+        from = true;
+    } else if (currentToken().type == TokenType::IDENTIFIER && upperValue(currentToken()) == "TO") {
+        advance();
+    } else {
+        result.error_message = "Expected FROM or TO";
+        return result;
+    }
+    
+    if (currentToken().type != TokenType::STRING_LITERAL) {
+        result.error_message = "Expected file path in quotes";
+        return result;
+    }
+    std::string path = currentToken().text();
+    advance();
+    
+    CopyOptions options;
+    while (currentToken().type == TokenType::IDENTIFIER) {
+        std::string option = upperValue(currentToken());
+        advance();
+        if (option == "CSV") {
+            options.format = CopyFormat::CSV;
+        } else if (option == "BINARY") {
+            options.format = CopyFormat::BINARY;
+        } else if (option == "HEADER") {
+            options.header = true;
+        } else if (option == "DELIMITER") {
+            if (currentToken().type != TokenType::STRING_LITERAL || currentToken().value.size() != 1) {
+                result.error_message = "DELIMITER must be a single character in quotes";
+                return result;
+            }
+            options.delimiter = currentToken().value[0];
+            advance();
+        } else {
+            result.error_message = "Unknown COPY option '" + option + "'";
+            return result;
+        }
+    }
+    if (!expectEnd(result.error_message)) {
+        return result;
+    }
+    
+    if (!g_storage_engine) {
+        result.error_message = "Storage engine not initialized";
+        return result;
+    }
+    
+    std::shared_ptr<Table> table = g_storage_engine->getTable(table_name);
+    if (!table) {
+        result.error_message = "Table '" + table_name + "' does not exist";
+        return result;
+    }
+    
+    if (!from) {
+        std::shared_ptr<Transaction> txn = Session::current().transaction;
+        if (!txn) {
+            txn = g_storage_engine->beginTransaction();
+        }
+        result.success = copyTo(*table, path, options, txn, result.rows_affected, result.error_message);
+        return result;
+    }
+    
+    // The whole load is one statement: it commits, or rolls back, as a unit
+    std::shared_ptr<Transaction> txn;
+    if (!beginStatement(txn, result)) {
+        return result;
+    }
+    result.success = copyFrom(*table, path, options, txn.get(), result.rows_affected, result.error_message);
+    finishStatement(*txn, result);
+    return result;
+}
+
+// PREPARE name AS statement, with $1 .. $n where literals may appear
+QueryResult PLSQLParser::parsePrepare() {
+    QueryResult result;
+    advance(); // consume PREPARE
+    
+    if (currentToken().type != TokenType::IDENTIFIER) {
+        result.error_message = "Expected statement name";
+        return result;
+    }
+    std::string name = currentToken().text();
+    advance();
+    
+    if (currentToken().type != TokenType::IDENTIFIER || upperValue(currentToken()) != "AS") {
+        result.error_message = "Expected AS";
+        return result;
+    }
+    advance();
+    
+    TokenType statement = currentToken().type;
+    if (statement == TokenType::PREPARE || statement == TokenType::EXECUTE ||
+        statement == TokenType::DEALLOCATE) {
+        result.error_message = "Cannot prepare " + currentToken().text();
+        return result;
+    }
+    
+    // Tokens are views into one text, which ends where the END_OF_FILE
+    // token points; the plan keeps its own copy of the statement
+    const char* body = currentToken().value.data();
+    std::shared_ptr<const PreparedStatement> plan = PreparedStatement::prepare(
+        std::string(body, tokens_.back().value.data() - body), result.error_message);
+    if (!plan) {
+        return result;
+    }
+    
+    Session::current().prepared[name] = plan;
+    result.success = true;
+    return result;
+}
+
+// EXECUTE name [(value, ...)]
+QueryResult PLSQLParser::parseExecute() {
+    QueryResult result;
+    advance(); // consume EXECUTE
+    
+    if (currentToken().type != TokenType::IDENTIFIER) {
+        result.error_message = "Expected statement name";
+        return result;
+    }
+    std::string name = currentToken().text();
+    advance();
+    
+    Row parameters;
+    if (match(TokenType::LPAREN)) {
+        do {
+            if (!parseLiteral(parameters.emplace_back())) {
+                result.error_message = "Invalid parameter value";
+                return result;
+            }
+        } while (match(TokenType::COMMA));
+        
+        if (!match(TokenType::RPAREN)) {
+            result.error_message = "Expected ')'";
+            return result;
+        }
+    }
+    if (!expectEnd(result.error_message)) {
+        return result;
+    }
+    
+    auto& prepared = Session::current().prepared;
+    auto it = prepared.find(name);
+    if (it == prepared.end()) {
+        result.error_message = "Prepared statement '" + name + "' does not exist";
+        return result;
+    }
+    
+    // Hold the plan: the statement may be re-prepared while it runs
+    std::shared_ptr<const PreparedStatement> plan = it->second;
+    return plan->execute(parameters);
+}
+
+// DEALLOCATE [PREPARE] name | ALL
+QueryResult PLSQLParser::parseDeallocate() {
+    QueryResult result;
+    advance(); // consume DEALLOCATE
+    
+    match(TokenType::PREPARE);
+    if (currentToken().type != TokenType::IDENTIFIER) {
+        result.error_message = "Expected statement name";
+        return result;
+    }
+    
+    std::string name = currentToken().text();
+    bool all = upperValue(currentToken()) == "ALL";
+    advance();
+    if (!expectEnd(result.error_message)) {
+        return result;
+    }
+    
+    auto& prepared = Session::current().prepared;
+    if (all) {
+        prepared.clear();
+    } else if (prepared.erase(name) == 0) {
+        result.error_message = "Prepared statement '" + name + "' does not exist";
+        return result;
+    }
+    
+    result.success = true;
+    return result;
+}
+
+// SHOW ALLOCATIONS: heap and arena use of the session's previous statement
+// SHOW STORAGE table: how each column is encoded and what it takes
+// SHOW STATISTICS table: what the last ANALYZE found in each column
+QueryResult PLSQLParser::parseShow() {
+    QueryResult result;
+    advance(); // consume SHOW
+    
+    std::string what = currentToken().type == TokenType::IDENTIFIER ? upperValue(currentToken()) : "";
+    if (what == "STORAGE") {
+        advance();
+        return showStorage();
+    }
+    if (what == "STATISTICS") {
+        advance();
+        return showStatistics();
+    }
+    if (what != "ALLOCATIONS") {
+        result.error_message = "Expected ALLOCATIONS, STATISTICS or STORAGE";
+        return result;
+    }
+    advance();
+    if (!expectEnd(result.error_message)) {
+        return result;
+    }
+    
+    const Session& session = Session::current();
+    const StatementAllocations& last = session.last_statement;
+    result.columns = {Column("statistic", DataType::STRING), Column("value", DataType::STRING)};
+    result.rows = {
+        {std::string("heap_allocations"), std::to_string(last.heap_allocations)},
+        {std::string("heap_bytes"), std::to_string(last.heap_bytes)},
+        {std::string("arena_bytes"), std::to_string(last.arena_bytes)},
+        {std::string("arena_peak_bytes"), std::to_string(session.arena.peak())},
+        {std::string("arena_capacity_bytes"), std::to_string(session.arena.capacity())},
+        {std::string("arena_heap_blocks"), std::to_string(session.arena.heapAllocations())},
+    };
+    result.success = true;
+    return result;
+}
+
+QueryResult PLSQLParser::showStorage() {
+    QueryResult result;
+    if (currentToken().type != TokenType::IDENTIFIER) {
+        result.error_message = "Expected table name";
+        return result;
+    }
+    std::string table_name = currentToken().text();
+    advance();
+    if (!expectEnd(result.error_message)) {
+        return result;
+    }
+    
+    if (!g_storage_engine) {
+        result.error_message = "Storage engine not initialized";
+        return result;
+    }
+    std::shared_ptr<Table> table = g_storage_engine->getTable(table_name);
+    if (!table) {
+        result.error_message = "Table '" + table_name + "' does not exist";
+        return result;
+    }
+    
+    // One row per column: block counts by encoding, and bytes as stored
+    // versus bytes if nothing were encoded
+    result.columns = {Column("column", DataType::STRING), Column("encodings", DataType::STRING),
+                      Column("bytes", DataType::INTEGER), Column("plain_bytes", DataType::INTEGER)};
+    std::vector<ColumnStorage> storage = table->storage();
+    const std::vector<Column>& columns = table->getColumns();
+    for (size_t i = 0; i < columns.size(); ++i) {
+        std::string encodings;
+        for (size_t e = 0; e < kEncodingCount; ++e) {
+            if (storage[i].blocks[e]) {
+                if (!encodings.empty()) encodings += ", ";
+                encodings += encodingName(static_cast<Encoding>(e)) + std::string(" x") +
+                             std::to_string(storage[i].blocks[e]);
+            }
+        }
+        result.rows.push_back({columns[i].name, encodings.empty() ? std::string("-") : encodings,
+                               static_cast<int64_t>(storage[i].bytes),
+                               static_cast<int64_t>(storage[i].plain_bytes)});
+    }
+    result.success = true;
+    return result;
+}
+
+QueryResult PLSQLParser::showStatistics() {
+    QueryResult result;
+    if (currentToken().type != TokenType::IDENTIFIER) {
+        result.error_message = "Expected table name";
+        return result;
+    }
+    std::string table_name = currentToken().text();
+    advance();
+    if (!expectEnd(result.error_message)) {
+        return result;
+    }
+    
+    if (!g_storage_engine) {
+        result.error_message = "Storage engine not initialized";
+        return result;
+    }
+    std::shared_ptr<Table> table = g_storage_engine->getTable(table_name);
+    if (!table) {
+        result.error_message = "Table '" + table_name + "' does not exist";
+        return result;
+    }
+    std::shared_ptr<const TableStatistics> stats = table->statistics();
+    if (!stats) {
+        result.error_message = "Table '" + table_name + "' has not been analyzed";
+        return result;
+    }
+    
+    // One row per column; min and max are the histogram's outer bounds
+    result.columns = {Column("column", DataType::STRING), Column("rows", DataType::INTEGER),
+                      Column("null_fraction", DataType::DOUBLE), Column("distinct", DataType::INTEGER),
+                      Column("min", DataType::STRING), Column("max", DataType::STRING),
+                      Column("buckets", DataType::INTEGER)};
+    const std::vector<Column>& columns = table->getColumns();
+    for (size_t i = 0; i < columns.size(); ++i) {
+        const ColumnStatistics& column = stats->columns[i];
+        auto text = [](const Value& value) {
+            std::ostringstream out;
+            out << value;
+            return out.str();
+        };
+        bool empty = column.bounds.empty();
+        result.rows.push_back({columns[i].name, static_cast<int64_t>(column.rows), column.nullFraction(),
+                               static_cast<int64_t>(std::llround(column.distinctCount())),
+                               empty ? Value() : Value(text(column.bounds.front())),
+                               empty ? Value() : Value(text(column.bounds.back())),
+                               static_cast<int64_t>(empty ? 0 : column.bounds.size() - 1)});
+    }
+    result.success = true;
+    return result;
+}
+
+// ANALYZE [table]: gathers statistics on one table, or on every table
+QueryResult PLSQLParser::parseAnalyze() {
+    QueryResult result;
+    advance(); // consume ANALYZE
+    
+    if (!g_storage_engine) {
+        result.error_message = "Storage engine not initialized";
+        return result;
+    }
+    std::vector<std::string> table_names;
+    if (currentToken().type == TokenType::IDENTIFIER) {
+        table_names.push_back(currentToken().text());
+        advance();
+    } else {
+        table_names = g_storage_engine->getTableNames();
+    }
+    if (!expectEnd(result.error_message)) {
+        return result;
+    }
+    
+    for (const std::string& table_name : table_names) {
+        std::shared_ptr<Table> table = g_storage_engine->getTable(table_name);
+        if (!table) {
+            result.error_message = "Table '" + table_name + "' does not exist";
+            return result;
+        }
+        table->analyze();
+    }
+    result.success = true;
+    return result;
+}
+
+// EXPLAIN [ANALYZE] SELECT ...: one row per operator of the SELECT's
+// plan; ANALYZE also runs it and adds what each operator measured
+QueryResult PLSQLParser::parseExplain() {
+    advance(); // consume EXPLAIN
+    explain_ = match(TokenType::ANALYZE) ? ExplainMode::ANALYZE : ExplainMode::PLAN;
+    if (currentToken().type != TokenType::SELECT) {
+        QueryResult result;
+        result.error_message = "EXPLAIN supports SELECT statements only";
+        return result;
+    }
+    return parseSelect();
+}
+
+}
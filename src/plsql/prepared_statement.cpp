@@ -0,0 +1,244 @@
+#include "prepared_statement.h"
+#include "session.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+
+namespace InMemoryDB {
+
+PreparedStatement::PreparedStatement(std::string sql)
+    : sql_(std::move(sql)), tokens_(PLSQLLexer(sql_).tokenize()), parameter_count_(0) {
+    // The placeholders of PREPARE name AS ... belong to the statement it
+    // prepares, not to the PREPARE itself
+    if (tokens_[0].type == TokenType::PREPARE) {
+        return;
+    }
+    for (const Token& token : tokens_) {
+        if (token.type != TokenType::PARAMETER) {
+            continue;
+        }
+        size_t number = 0;
+        std::from_chars(token.value.data(), token.value.data() + token.value.size(), number);
+        parameter_count_ = std::max(parameter_count_, number);
+    }
+}
+
+std::shared_ptr<const PreparedStatement> PreparedStatement::prepare(std::string sql, std::string& error) {
+    auto plan = std::make_shared<const PreparedStatement>(std::move(sql));
+    if (plan->tokens_[0].type == TokenType::END_OF_FILE) {
+        error = "Empty query";
+        return nullptr;
+    }
+    for (const Token& token : plan->tokens_) {
+        if (token.type == TokenType::PARAMETER && token.value.find_first_not_of('0') == std::string_view::npos) {
+            error = "Parameters are numbered from $1";
+            return nullptr;
+        }
+    }
+    return plan;
+}
+
+QueryResult PreparedStatement::execute(const Row& parameters) const {
+    StatementScope scope;
+    if (parameters.size() != parameter_count_) {
+        QueryResult result;
+        result.error_message = "Statement expects " + std::to_string(parameter_count_) +
+                               " parameter(s), got " + std::to_string(parameters.size());
+        return result;
+    }
+
+    try {
+        PLSQLParser parser(tokens_, &parameters);
+        return parser.parse();
+    } catch (const std::exception& e) {
+        QueryResult result;
+        result.error_message = e.what();
+        return result;
+    }
+}
+
+PlanCache& PlanCache::instance() {
+    static PlanCache cache(256);
+    return cache;
+}
+
+namespace {
+
+bool isWordChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// Only queries and DML take literals solely where a bound value may
+// stand instead; statements with placeholders of their own keep them
+bool parameterizable(const std::string& sql) {
+    size_t start = sql.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos || sql.find('$') != std::string::npos) {
+        return false;
+    }
+    size_t end = start;
+    while (end < sql.size() && isWordChar(sql[end])) {
+        ++end;
+    }
+    std::string word = sql.substr(start, end - start);
+    std::transform(word.begin(), word.end(), word.begin(), [](unsigned char c) { return std::toupper(c); });
+    return word == "SELECT" || word == "INSERT" || word == "UPDATE" || word == "DELETE" || word == "EXPLAIN";
+}
+
+// The value the parser gives a number literal, if it would accept it
+// bound to a placeholder as well: integers must fit without a sign
+bool parseNumber(const char* first, const char* last, Value& value) {
+    if (std::find(first, last, '.') != last) {
+        double number = 0.0;
+        auto [end, ec] = std::from_chars(first, last, number);
+        value = number;
+        return ec == std::errc() && end == last;
+    }
+    int64_t number = 0;
+    auto [end, ec] = std::from_chars(first, last, number);
+    value = number;
+    return ec == std::errc() && end == last;
+}
+
+}
+
+std::string PlanCache::normalize(const std::string& sql, Row* literals) {
+    if (literals && !parameterizable(sql)) {
+        literals = nullptr;
+    }
+    std::string result;
+    result.reserve(sql.size());
+    bool pending_space = false;
+    size_t i = 0;
+    while (i < sql.size()) {
+        char c = sql[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            pending_space = !result.empty();
+            ++i;
+            continue;
+        }
+        if (pending_space) {
+            result.push_back(' ');
+            pending_space = false;
+        }
+
+        if (c == '\'') {
+            size_t close = sql.find('\'', i + 1);
+            if (close == std::string::npos) {
+                result.append(sql, i, std::string::npos);  // unterminated; the parser reports it
+                break;
+            }
+            if (literals) {
+                literals->emplace_back(std::string_view(sql).substr(i + 1, close - i - 1));
+                result += "$" + std::to_string(literals->size());
+            } else {
+                result.append(sql, i, close + 1 - i);
+            }
+            i = close + 1;
+            continue;
+        }
+
+        // A number, not the digits of a name like t1
+        if (literals && std::isdigit(static_cast<unsigned char>(c)) && (i == 0 || !isWordChar(sql[i - 1]))) {
+            size_t end = sql.find_first_not_of("0123456789.", i);
+            end = end == std::string::npos ? sql.size() : end;
+            Value value;
+            if (parseNumber(sql.data() + i, sql.data() + end, value)) {
+                literals->push_back(std::move(value));
+                result += "$" + std::to_string(literals->size());
+                i = end;
+                continue;
+            }
+        }
+        result.push_back(c);
+        ++i;
+    }
+    return result;
+}
+
+void PlanCache::evict() {
+    while (entries_.size() > capacity_) {
+        entries_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
+
+std::shared_ptr<const PreparedStatement> PlanCache::get(const std::string& sql, Row& literals, std::string& error) {
+    literals.clear();
+    std::string key = normalize(sql, &literals);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return it->second->second;
+        }
+    }
+
+    // Lex outside the lock; if two threads race on the same text, the
+    // second plan simply replaces the first
+    std::shared_ptr<const PreparedStatement> plan = PreparedStatement::prepare(key, error);
+    if (!plan) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (capacity_ == 0) {
+        return plan;
+    }
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        it->second->second = plan;
+        lru_.splice(lru_.begin(), lru_, it->second);
+    } else {
+        lru_.emplace_front(key, plan);
+        entries_.emplace(std::move(key), lru_.begin());
+        evict();
+    }
+    return plan;
+}
+
+void PlanCache::setCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    evict();
+}
+
+size_t PlanCache::capacity() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return capacity_;
+}
+
+size_t PlanCache::size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+QueryResult executeSql(const std::string& sql) {
+    StatementScope scope;
+    
+    // Without a cache the tokens only need to last for this statement
+    if (PlanCache::instance().capacity() == 0) {
+        try {
+            TokenList tokens = PLSQLLexer(sql).tokenize(&Session::current().arena);
+            PLSQLParser parser(tokens);
+            return parser.parse();
+        } catch (const std::exception& e) {
+            QueryResult result;
+            result.error_message = e.what();
+            return result;
+        }
+    }
+    
+    std::string error;
+    Row literals;
+    std::shared_ptr<const PreparedStatement> plan = PlanCache::instance().get(sql, literals, error);
+    if (!plan) {
+        QueryResult result;
+        result.error_message = error;
+        return result;
+    }
+    return plan->execute(literals);
+}
+
+}
@@ -0,0 +1,427 @@
+#include "aggregate.h"
+#include "hash.h"
+#include "predicate.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <type_traits>
+
+namespace InMemoryDB {
+
+namespace {
+
+constexpr size_t kPartitionBits = 6;
+constexpr size_t kMergePartitions = size_t(1) << kPartitionBits;
+constexpr uint64_t kFingerprintMask = 0xffffffff00000000ull;
+
+// Folds one key column into the hashes of a batch of rows
+void hashColumn(const ColumnVector& column, const size_t* positions, size_t count, uint64_t* hashes) {
+    const Bitmap& validity = column.validity();
+    switch (column.type()) {
+        case DataType::INTEGER:
+            for (size_t i = 0; i < count; ++i) {
+                size_t pos = positions[i];
+                hashes[i] = combineHash(hashes[i], validity.get(pos) ? static_cast<uint64_t>(column.intAt(pos)) : kNullHash);
+            }
+            break;
+        case DataType::DOUBLE: {
+            const double* values = column.doubleData();
+            for (size_t i = 0; i < count; ++i) {
+                size_t pos = positions[i];
+                hashes[i] = combineHash(hashes[i], validity.get(pos) ? hashDouble(values[pos]) : kNullHash);
+            }
+            break;
+        }
+        case DataType::STRING:
+            for (size_t i = 0; i < count; ++i) {
+                size_t pos = positions[i];
+                hashes[i] = combineHash(hashes[i], validity.get(pos) ? hashString(column.stringAt(pos)) : kNullHash);
+            }
+            break;
+        case DataType::BOOLEAN: {
+            const Bitmap& values = column.boolData();
+            for (size_t i = 0; i < count; ++i) {
+                size_t pos = positions[i];
+                hashes[i] = combineHash(hashes[i], validity.get(pos) ? static_cast<uint64_t>(values.get(pos)) : kNullHash);
+            }
+            break;
+        }
+    }
+}
+
+bool keyEquals(const Value& key, const ColumnVector& column, size_t pos) {
+    if (column.isNull(pos) || key.isNull()) {
+        return column.isNull(pos) && key.isNull();
+    }
+    switch (column.type()) {
+        case DataType::INTEGER: return key.asInt() == column.intAt(pos);
+        case DataType::DOUBLE: return key.asDouble() == column.doubleData()[pos];
+        case DataType::STRING: return key.asString() == column.stringAt(pos);
+        case DataType::BOOLEAN: return key.asBool() == column.boolData().get(pos);
+    }
+    return false;
+}
+
+void grow(GroupTable& table) {
+    table.slots.assign(std::max<size_t>(64, table.slots.size() * 2), 0);
+    size_t mask = table.slots.size() - 1;
+    for (size_t group = 0; group < table.size(); ++group) {
+        uint64_t hash = table.hashes[group];
+        size_t slot = hash & mask;
+        while (table.slots[slot]) {
+            slot = (slot + 1) & mask;
+        }
+        table.slots[slot] = (hash & kFingerprintMask) | (group + 1);
+    }
+}
+
+// Linear probing; a group whose fingerprint matches is confirmed with
+// equal(group). On a miss the group is added to the slots and hashes
+// only, and the caller appends its key and states.
+template <typename Equal>
+size_t probe(GroupTable& table, uint64_t hash, Equal equal, bool& inserted) {
+    if (table.size() * 2 >= table.slots.size()) {
+        grow(table);
+    }
+    size_t mask = table.slots.size() - 1;
+    uint64_t fingerprint = hash & kFingerprintMask;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        uint64_t entry = table.slots[slot];
+        if (entry == 0) {
+            size_t group = table.size();
+            table.slots[slot] = fingerprint | (group + 1);
+            table.hashes.push_back(hash);
+            inserted = true;
+            return group;
+        }
+        if ((entry & kFingerprintMask) == fingerprint) {
+            size_t group = static_cast<uint32_t>(entry) - 1;
+            if (equal(group)) {
+                inserted = false;
+                return group;
+            }
+        }
+    }
+}
+
+template <typename T> T extremeAs(const Value& value);
+template <> int64_t extremeAs<int64_t>(const Value& value) { return value.asInt(); }
+template <> double extremeAs<double>(const Value& value) { return value.asDouble(); }
+template <> std::string_view extremeAs<std::string_view>(const Value& value) { return value.asString(); }
+template <> bool extremeAs<bool>(const Value& value) { return value.asBool(); }
+
+// Updates one aggregate over a batch, a column at a time. states points at
+// the aggregate's state in group 0 and width is the states per group.
+template <typename T, typename Get>
+void accumulate(AggregateFunction function, AggregateState* states, size_t width, const Bitmap& validity,
+                const size_t* positions, const uint32_t* groups, size_t count, Get get) {
+    for (size_t i = 0; i < count; ++i) {
+        size_t pos = positions[i];
+        if (!validity.get(pos)) {
+            continue;
+        }
+        AggregateState& state = states[groups[i] * width];
+        if (function == AggregateFunction::COUNT) {
+            state.count++;
+        } else if (function == AggregateFunction::SUM || function == AggregateFunction::AVG) {
+            state.count++;
+            if constexpr (std::is_same<T, int64_t>::value) {
+                state.int_sum += get(pos);
+            } else if constexpr (std::is_same<T, double>::value) {
+                state.double_sum += get(pos);
+            }
+        } else {
+            T value = get(pos);
+            if (state.count++ == 0 ||
+                (function == AggregateFunction::MIN ? value < extremeAs<T>(state.extreme)
+                                                    : value > extremeAs<T>(state.extreme))) {
+                state.extreme = Value(value);
+            }
+        }
+    }
+}
+
+// Orders two non-NULL values of the same kind
+bool lessThan(const Value& a, const Value& b) {
+    switch (a.kind()) {
+        case Value::Kind::INTEGER: return a.asInt() < b.asInt();
+        case Value::Kind::DOUBLE: return a.asDouble() < b.asDouble();
+        case Value::Kind::STRING: return a.asString() < b.asString();
+        case Value::Kind::BOOLEAN: return a.asBool() < b.asBool();
+        default: return false;
+    }
+}
+
+const char* functionName(AggregateFunction function) {
+    switch (function) {
+        case AggregateFunction::COUNT: return "COUNT";
+        case AggregateFunction::SUM: return "SUM";
+        case AggregateFunction::AVG: return "AVG";
+        case AggregateFunction::MIN: return "MIN";
+        case AggregateFunction::MAX: return "MAX";
+        default: return "";
+    }
+}
+
+}
+
+std::string SelectItem::label() const {
+    if (function == AggregateFunction::NONE) {
+        return column;
+    }
+    return std::string(functionName(function)) + "(" + (column.empty() ? "*" : column) + ")";
+}
+
+bool HashAggregator::bind(const std::vector<Column>& columns, const std::vector<SelectItem>& items,
+                          const std::vector<std::string>& group_by, std::string& error) {
+    auto find = [&](const std::string& name) {
+        for (size_t i = 0; i < columns.size(); ++i) {
+            if (columns[i].name == name) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    };
+
+    for (const std::string& name : group_by) {
+        int column = find(name);
+        if (column < 0) {
+            error = "Unknown column '" + name + "' in GROUP BY";
+            return false;
+        }
+        group_columns_.push_back(column);
+    }
+
+    for (const SelectItem& item : items) {
+        if (item.function == AggregateFunction::NONE) {
+            auto it = std::find(group_by.begin(), group_by.end(), item.column);
+            if (it == group_by.end()) {
+                error = "Column '" + item.column + "' must appear in GROUP BY or be used in an aggregate";
+                return false;
+            }
+            size_t key = it - group_by.begin();
+            outputs_.push_back({true, key});
+            result_columns_.emplace_back(item.column, columns[group_columns_[key]].type);
+            continue;
+        }
+
+        int column = -1;
+        DataType type = DataType::INTEGER;  // COUNT
+        if (!item.column.empty()) {
+            column = find(item.column);
+            if (column < 0) {
+                error = "Unknown column '" + item.column + "'";
+                return false;
+            }
+            DataType input = columns[column].type;
+            bool numeric = input == DataType::INTEGER || input == DataType::DOUBLE;
+            if (item.function == AggregateFunction::SUM || item.function == AggregateFunction::AVG) {
+                if (!numeric) {
+                    error = item.label() + " requires a numeric column";
+                    return false;
+                }
+                type = item.function == AggregateFunction::SUM ? input : DataType::DOUBLE;
+            } else if (item.function != AggregateFunction::COUNT) {
+                type = input;
+            }
+        }
+        aggregates_.push_back({item.function, column});
+        outputs_.push_back({false, aggregates_.size() - 1});
+        result_columns_.emplace_back(item.label(), type);
+    }
+    return true;
+}
+
+void HashAggregator::start(size_t workers) {
+    tables_.assign(std::max<size_t>(1, workers), GroupTable());
+}
+
+size_t HashAggregator::findGroup(GroupTable& table, uint64_t hash, size_t position) const {
+    size_t width = group_columns_.size();
+    bool inserted;
+    size_t group = probe(table, hash, [&](size_t candidate) {
+        const Value* key = table.keys.data() + candidate * width;
+        for (size_t k = 0; k < width; ++k) {
+            if (!keyEquals(key[k], data_[group_columns_[k]], position)) {
+                return false;
+            }
+        }
+        return true;
+    }, inserted);
+
+    if (inserted) {
+        for (int column : group_columns_) {
+            table.keys.push_back(data_[column].get(position));
+        }
+        table.states.resize(table.states.size() + aggregates_.size());
+    }
+    return group;
+}
+
+void HashAggregator::consume(size_t worker, const size_t* positions, size_t count) {
+    GroupTable& table = tables_[worker];
+    uint64_t hashes[kBatchSize];
+    uint32_t groups[kBatchSize];
+
+    // Hash and look up a batch of rows, then fold each aggregate's column
+    // into the batch's groups
+    for (size_t done = 0; done < count; done += kBatchSize) {
+        size_t n = std::min(kBatchSize, count - done);
+        const size_t* batch = positions + done;
+        std::fill(hashes, hashes + n, kHashSeed);
+        for (int column : group_columns_) {
+            hashColumn(data_[column], batch, n, hashes);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            groups[i] = static_cast<uint32_t>(findGroup(table, hashes[i], batch[i]));
+        }
+        update(table, batch, groups, n);
+    }
+}
+
+void HashAggregator::update(GroupTable& table, const size_t* positions, const uint32_t* groups, size_t count) const {
+    size_t width = aggregates_.size();
+    for (size_t k = 0; k < width; ++k) {
+        AggregateFunction function = aggregates_[k].function;
+        AggregateState* states = table.states.data() + k;
+        if (aggregates_[k].column < 0) {
+            for (size_t i = 0; i < count; ++i) {
+                states[groups[i] * width].count++;
+            }
+            continue;
+        }
+
+        const ColumnVector& column = data_[aggregates_[k].column];
+        const Bitmap& validity = column.validity();
+        switch (column.type()) {
+            case DataType::INTEGER:
+                accumulate<int64_t>(function, states, width, validity, positions, groups, count,
+                                    [&](size_t pos) { return static_cast<int64_t>(column.intAt(pos)); });
+                break;
+            case DataType::DOUBLE: {
+                const double* values = column.doubleData();
+                accumulate<double>(function, states, width, validity, positions, groups, count,
+                                   [values](size_t pos) { return values[pos]; });
+                break;
+            }
+            case DataType::STRING:
+                accumulate<std::string_view>(function, states, width, validity, positions, groups, count,
+                                             [&](size_t pos) { return column.stringAt(pos); });
+                break;
+            case DataType::BOOLEAN: {
+                const Bitmap& values = column.boolData();
+                accumulate<bool>(function, states, width, validity, positions, groups, count,
+                                 [&](size_t pos) { return values.get(pos); });
+                break;
+            }
+        }
+    }
+}
+
+void HashAggregator::mergeState(AggregateState& into, const AggregateState& from, AggregateFunction function) const {
+    if ((function == AggregateFunction::MIN || function == AggregateFunction::MAX) && from.count > 0 &&
+        (into.count == 0 || (function == AggregateFunction::MIN ? lessThan(from.extreme, into.extreme)
+                                                                : lessThan(into.extreme, from.extreme)))) {
+        into.extreme = from.extreme;
+    }
+    into.count += from.count;
+    into.int_sum += from.int_sum;
+    into.double_sum += from.double_sum;
+}
+
+void HashAggregator::emit(const GroupTable& table, std::vector<Row>& rows) const {
+    size_t key_width = group_columns_.size();
+    size_t width = aggregates_.size();
+    rows.reserve(rows.size() + table.size());
+    for (size_t group = 0; group < table.size(); ++group) {
+        Row row;
+        row.reserve(outputs_.size());
+        for (const Output& output : outputs_) {
+            if (output.is_key) {
+                row.push_back(table.keys[group * key_width + output.index]);
+                continue;
+            }
+            const Aggregate& aggregate = aggregates_[output.index];
+            const AggregateState& state = table.states[group * width + output.index];
+            bool integer = aggregate.column >= 0 && data_[aggregate.column].type() == DataType::INTEGER;
+            if (aggregate.function == AggregateFunction::COUNT) {
+                row.emplace_back(state.count);
+            } else if (state.count == 0) {
+                row.emplace_back();
+            } else if (aggregate.function == AggregateFunction::SUM) {
+                row.push_back(integer ? Value(state.int_sum) : Value(state.double_sum));
+            } else if (aggregate.function == AggregateFunction::AVG) {
+                double sum = integer ? static_cast<double>(state.int_sum) : state.double_sum;
+                row.emplace_back(sum / static_cast<double>(state.count));
+            } else {
+                row.push_back(state.extreme);
+            }
+        }
+        rows.push_back(std::move(row));
+    }
+}
+
+void HashAggregator::finish(size_t parallelism, QueryResult& result) {
+    result.columns = result_columns_;
+    result.success = true;
+
+    size_t key_width = group_columns_.size();
+    size_t width = aggregates_.size();
+    if (tables_.size() == 1) {
+        emit(tables_[0], result.rows);
+    } else {
+        // Split every worker's groups by the top bits of their hashes, so
+        // each partition can be merged without touching the others
+        ThreadPool::instance().parallelFor(tables_.size(), parallelism, [&](size_t w) {
+            GroupTable& table = tables_[w];
+            table.partitions.assign(kMergePartitions, {});
+            for (size_t group = 0; group < table.size(); ++group) {
+                table.partitions[table.hashes[group] >> (64 - kPartitionBits)].push_back(static_cast<uint32_t>(group));
+            }
+        });
+
+        std::vector<std::vector<Row>> parts(kMergePartitions);
+        ThreadPool::instance().parallelFor(kMergePartitions, parallelism, [&](size_t p) {
+            GroupTable merged;
+            for (const GroupTable& table : tables_) {
+                for (uint32_t from : table.partitions[p]) {
+                    const Value* key = table.keys.data() + from * key_width;
+                    bool inserted;
+                    size_t group = probe(merged, table.hashes[from], [&](size_t candidate) {
+                        return std::equal(key, key + key_width, merged.keys.data() + candidate * key_width);
+                    }, inserted);
+
+                    const AggregateState* states = &table.states[from * width];
+                    if (inserted) {
+                        merged.keys.insert(merged.keys.end(), key, key + key_width);
+                        merged.states.insert(merged.states.end(), states, states + width);
+                        continue;
+                    }
+                    for (size_t k = 0; k < width; ++k) {
+                        mergeState(merged.states[group * width + k], states[k], aggregates_[k].function);
+                    }
+                }
+            }
+            emit(merged, parts[p]);
+        });
+
+        size_t total = 0;
+        for (const auto& part : parts) {
+            total += part.size();
+        }
+        result.rows.reserve(total);
+        for (auto& part : parts) {
+            std::move(part.begin(), part.end(), std::back_inserter(result.rows));
+        }
+    }
+
+    // Without GROUP BY there is exactly one row, even over no input
+    if (key_width == 0 && result.rows.empty()) {
+        GroupTable empty;
+        empty.hashes.push_back(kHashSeed);
+        empty.states.resize(width);
+        emit(empty, result.rows);
+    }
+    tables_.clear();
+}
+
+}
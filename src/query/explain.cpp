@@ -0,0 +1,58 @@
+#include "explain.h"
+#include <cmath>
+
+namespace InMemoryDB {
+
+namespace {
+
+void appendPlanRows(const PlanNode& node, size_t depth, bool analyzed, std::vector<Row>& rows) {
+    const OperatorProfile& profile = node.profile;
+    bool skipped = analyzed && profile.loops == 0;
+    std::string label = depth ? std::string(2 * (depth - 1), ' ') + "-> " + node.label : node.label;
+    if (skipped) {
+        label += " (never executed)";
+    }
+
+    Row row{label, node.estimated_rows < 0 ? Value() : Value(static_cast<int64_t>(std::llround(node.estimated_rows)))};
+    if (analyzed) {
+        if (skipped) {
+            row.resize(8);
+        } else {
+            row.push_back(static_cast<int64_t>(profile.loops));
+            row.push_back(static_cast<int64_t>(profile.rows_in));
+            row.push_back(static_cast<int64_t>(profile.rows_out));
+            row.push_back(profile.wall_ns / 1e6);
+            row.push_back(static_cast<int64_t>(profile.heap_bytes));
+            row.push_back(profile.lock_wait_ns / 1e6);
+        }
+    }
+    rows.push_back(std::move(row));
+
+    for (const auto& child : node.children) {
+        appendPlanRows(*child, depth + 1, analyzed, rows);
+    }
+}
+
+}
+
+std::unique_ptr<PlanNode> wrapPlan(std::string label, std::unique_ptr<PlanNode> child, double estimated_rows) {
+    auto node = std::make_unique<PlanNode>(std::move(label), estimated_rows);
+    node->add(std::move(child));
+    return node;
+}
+
+QueryResult explainResult(const PlanNode& root, bool analyzed) {
+    QueryResult result;
+    result.columns = {Column("plan", DataType::STRING), Column("estimated_rows", DataType::INTEGER)};
+    if (analyzed) {
+        result.columns.insert(result.columns.end(), {
+            Column("loops", DataType::INTEGER), Column("rows_in", DataType::INTEGER),
+            Column("rows_out", DataType::INTEGER), Column("time_ms", DataType::DOUBLE),
+            Column("heap_bytes", DataType::INTEGER), Column("lock_wait_ms", DataType::DOUBLE)});
+    }
+    appendPlanRows(root, 0, analyzed, result.rows);
+    result.success = true;
+    return result;
+}
+
+}
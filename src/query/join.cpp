@@ -0,0 +1,460 @@
+#include "join.h"
+#include "hash.h"
+#include "session.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <functional>
+
+namespace InMemoryDB {
+
+namespace {
+
+// Partitions are sized so that one partition's build side, its entries
+// plus the bucket and chain arrays, fits in a typical L2 cache
+constexpr size_t kCacheBytes = 256 * 1024;
+constexpr size_t kBuildBytesPerRow = 16 + 2 * sizeof(uint32_t);
+constexpr size_t kMaxPartitionBits = 12;
+
+// Look rows up in an index when the indexed table has at least this many
+// times as many rows as there are rows to look up
+constexpr size_t kIndexJoinRatio = 16;
+
+constexpr uint32_t kEndOfChain = UINT32_MAX;
+
+uint64_t hashKey(const ColumnVector& column, size_t pos) {
+    switch (column.type()) {
+        case DataType::INTEGER: return mixHash(static_cast<uint64_t>(static_cast<int64_t>(column.intAt(pos))));
+        case DataType::DOUBLE: return mixHash(hashDouble(column.doubleData()[pos]));
+        case DataType::STRING: return mixHash(hashString(column.stringAt(pos)));
+        case DataType::BOOLEAN: return mixHash(column.boolData().get(pos));
+    }
+    return 0;
+}
+
+// Both columns have the same type and neither row is NULL
+bool keysEqual(const ColumnVector& a, size_t i, const ColumnVector& b, size_t j) {
+    switch (a.type()) {
+        case DataType::INTEGER: return a.intAt(i) == b.intAt(j);
+        case DataType::DOUBLE: return a.doubleData()[i] == b.doubleData()[j];
+        case DataType::STRING: return a.stringAt(i) == b.stringAt(j);
+        case DataType::BOOLEAN: return a.boolData().get(i) == b.boolData().get(j);
+    }
+    return false;
+}
+
+void collectColumns(const Predicate* where, std::vector<std::string>& out) {
+    if (where->kind() == Predicate::Kind::COMPARE) {
+        out.push_back(where->columnName());
+    }
+    for (const auto& child : where->children()) {
+        collectColumns(child.get(), out);
+    }
+}
+
+int findColumn(const Table& table, const std::string& name) {
+    const std::vector<Column>& columns = table.getColumns();
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (columns[i].name == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+}
+
+HashJoin::HashJoin(JoinType type, std::shared_ptr<Table> left, const std::string& left_name,
+                   std::shared_ptr<Table> right, const std::string& right_name)
+    : type_(type) {
+    left_.table = std::move(left);
+    left_.name = left_name;
+    right_.table = std::move(right);
+    right_.name = right_name;
+}
+
+bool HashJoin::resolve(const std::string& name, bool& right, int& column, std::string& error) const {
+    size_t dot = name.find('.');
+    if (dot != std::string::npos) {
+        std::string qualifier = name.substr(0, dot);
+        if (qualifier != left_.name && qualifier != right_.name) {
+            error = "Unknown table '" + qualifier + "'";
+            return false;
+        }
+        right = qualifier == right_.name;
+        column = findColumn(*(right ? right_ : left_).table, name.substr(dot + 1));
+    } else {
+        int in_left = findColumn(*left_.table, name);
+        int in_right = findColumn(*right_.table, name);
+        if (in_left >= 0 && in_right >= 0) {
+            error = "Column '" + name + "' is ambiguous";
+            return false;
+        }
+        right = in_right >= 0;
+        column = right ? in_right : in_left;
+    }
+    if (column < 0) {
+        error = "Unknown column '" + name + "'";
+        return false;
+    }
+    return true;
+}
+
+bool HashJoin::bind(const std::string& left_key, const std::string& right_key,
+                    const std::vector<std::string>& columns, std::unique_ptr<Predicate> where, std::string& error) {
+    if (left_.name == right_.name) {
+        error = "Both tables of the join are named '" + left_.name + "'; give one an alias";
+        return false;
+    }
+
+    bool first_right, second_right;
+    int first, second;
+    if (!resolve(left_key, first_right, first, error) || !resolve(right_key, second_right, second, error)) {
+        return false;
+    }
+    if (first_right == second_right) {
+        error = "ON must compare a column of each table";
+        return false;
+    }
+    left_.key = first_right ? second : first;
+    right_.key = first_right ? first : second;
+    if (left_.table->getColumns()[left_.key].type != right_.table->getColumns()[right_.key].type) {
+        error = "Join columns '" + left_key + "' and '" + right_key + "' have different types";
+        return false;
+    }
+
+    if (columns.empty()) {
+        for (bool right : {false, true}) {
+            const std::vector<Column>& side_columns = (right ? right_ : left_).table->getColumns();
+            for (size_t i = 0; i < side_columns.size(); ++i) {
+                outputs_.push_back({right, static_cast<int>(i)});
+                result_columns_.push_back(side_columns[i]);
+            }
+        }
+    }
+    for (const std::string& name : columns) {
+        bool right;
+        int column;
+        if (!resolve(name, right, column, error)) {
+            return false;
+        }
+        outputs_.push_back({right, column});
+        result_columns_.emplace_back(name, (right ? right_ : left_).table->getColumns()[column].type);
+    }
+
+    if (!where) {
+        return true;
+    }
+    std::vector<std::unique_ptr<Predicate>> conjuncts;
+    Predicate::splitConjuncts(std::move(where), conjuncts);
+    for (auto& conjunct : conjuncts) {
+        std::vector<std::string> names;
+        collectColumns(conjunct.get(), names);
+        bool on_right = false;
+        for (size_t i = 0; i < names.size(); ++i) {
+            bool right;
+            int column;
+            if (!resolve(names[i], right, column, error)) {
+                return false;
+            }
+            if (i > 0 && right != on_right) {
+                error = "Conditions on different tables must be combined with AND";
+                return false;
+            }
+            on_right = right;
+        }
+
+        Side& side = on_right ? right_ : left_;
+        if (!conjunct->bind(side.table->getColumns(), error, side.name)) {
+            return false;
+        }
+        side.where = side.where ? Predicate::logical(Predicate::Kind::AND, std::move(side.where), std::move(conjunct))
+                                : std::move(conjunct);
+
+        // Every comparison is false or unknown on the NULLs a LEFT join
+        // pads unmatched rows with, so a condition on the right table
+        // turns it into an inner join
+        if (on_right) {
+            type_ = JoinType::INNER;
+        }
+    }
+    return true;
+}
+
+bool HashJoin::indexable(size_t outer_rows, const Side& inner) const {
+    return inner.table->indexes_[inner.key] && outer_rows * kIndexJoinRatio <= inner.table->getRowCount();
+}
+
+// Index nested loops: each outer row's key is looked up in the inner
+// table's index, and the candidates are checked like an index scan's
+void HashJoin::indexJoin(const Side& outer, const std::vector<size_t>& outer_rows, const Side& inner,
+                         const ReadView& view, std::vector<Match>& matches) const {
+    const Index& index = *inner.table->indexes_[inner.key];
+    const ColumnVector& keys = outer.table->data_[outer.key];
+    bool outer_is_left = &outer == &left_;
+    std::vector<int> candidates;
+    for (size_t pos : outer_rows) {
+        bool matched = false;
+        if (!keys.isNull(pos)) {
+            candidates.clear();
+            index.findInto(keys.get(pos), candidates);
+            for (int row_id : candidates) {
+                uint32_t inner_pos = inner.table->slots_[row_id];
+                if (inner_pos == Table::kTombstone || !inner.table->visible(view, inner_pos) ||
+                    (inner.where && !inner.where->matches(inner.table->data_, inner_pos))) {
+                    continue;
+                }
+                matches.push_back(outer_is_left ? Match{pos, inner_pos} : Match{inner_pos, pos});
+                matched = true;
+            }
+        }
+        if (!matched && type_ == JoinType::LEFT) {
+            matches.push_back({pos, kNoRow});
+        }
+    }
+}
+
+// Hashes the keys of rows and scatters them by the top bits of the hash
+// into 2^bits partitions; partition p is entries[offsets[p], offsets[p + 1]).
+// Rows with a NULL key never match and go to null_rows, if given.
+void HashJoin::partition(const Side& side, const std::vector<size_t>& rows, size_t bits,
+                         std::vector<Entry>& entries, std::vector<size_t>& offsets,
+                         std::vector<size_t>* null_rows) const {
+    const ColumnVector& keys = side.table->data_[side.key];
+    std::vector<Entry> hashed(rows.size());
+    size_t morsels = (rows.size() + kMorselSize - 1) / kMorselSize;
+    ThreadPool::instance().parallelFor(morsels, Session::current().parallelism, [&](size_t m) {
+        size_t end = std::min(rows.size(), (m + 1) * kMorselSize);
+        for (size_t i = m * kMorselSize; i < end; ++i) {
+            hashed[i] = {keys.isNull(rows[i]) ? 0 : hashKey(keys, rows[i]), rows[i]};
+        }
+    });
+
+    auto partitionOf = [bits](uint64_t hash) { return bits ? hash >> (64 - bits) : 0; };
+    size_t partitions = size_t(1) << bits;
+    offsets.assign(partitions + 1, 0);
+    for (const Entry& entry : hashed) {
+        if (!keys.isNull(entry.position)) {
+            offsets[partitionOf(entry.hash) + 1]++;
+        }
+    }
+    for (size_t p = 0; p < partitions; ++p) {
+        offsets[p + 1] += offsets[p];
+    }
+
+    entries.resize(offsets[partitions]);
+    std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+    for (const Entry& entry : hashed) {
+        if (!keys.isNull(entry.position)) {
+            entries[next[partitionOf(entry.hash)]++] = entry;
+        } else if (null_rows) {
+            null_rows->push_back(entry.position);
+        }
+    }
+}
+
+void HashJoin::hashJoin(const std::vector<size_t>& left_rows, const std::vector<size_t>& right_rows,
+                        std::vector<Match>& matches) const {
+    // Build on the smaller input. Of a LEFT join, the left rows without a
+    // match are kept, whichever side they are on.
+    bool build_left = left_rows.size() < right_rows.size();
+    const Side& build = build_left ? left_ : right_;
+    const Side& probe = build_left ? right_ : left_;
+    const std::vector<size_t>& build_rows = build_left ? left_rows : right_rows;
+    const std::vector<size_t>& probe_rows = build_left ? right_rows : left_rows;
+    bool keep_build = type_ == JoinType::LEFT && build_left;
+    bool keep_probe = type_ == JoinType::LEFT && !build_left;
+
+    size_t bits = 0;
+    while (bits < kMaxPartitionBits && (build_rows.size() * kBuildBytesPerRow >> bits) > kCacheBytes) {
+        bits++;
+    }
+    std::vector<Entry> build_entries, probe_entries;
+    std::vector<size_t> build_offsets, probe_offsets, unmatched;
+    partition(build, build_rows, bits, build_entries, build_offsets, keep_build ? &unmatched : nullptr);
+    partition(probe, probe_rows, bits, probe_entries, probe_offsets, keep_probe ? &unmatched : nullptr);
+
+    const ColumnVector& build_keys = build.table->data_[build.key];
+    const ColumnVector& probe_keys = probe.table->data_[probe.key];
+    size_t partitions = size_t(1) << bits;
+    std::vector<std::vector<Match>> parts(partitions);
+    ThreadPool::instance().parallelFor(partitions, Session::current().parallelism, [&](size_t p) {
+        const Entry* entries = build_entries.data() + build_offsets[p];
+        size_t count = build_offsets[p + 1] - build_offsets[p];
+
+        // Chained hash table over the partition's build entries
+        size_t buckets = 1;
+        while (buckets < count * 2) {
+            buckets <<= 1;
+        }
+        std::vector<uint32_t> heads(buckets, kEndOfChain);
+        std::vector<uint32_t> chain(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            size_t bucket = entries[i].hash & (buckets - 1);
+            chain[i] = heads[bucket];
+            heads[bucket] = i;
+        }
+
+        std::vector<bool> matched(keep_build ? count : 0);
+        std::vector<Match>& out = parts[p];
+        for (size_t j = probe_offsets[p]; j < probe_offsets[p + 1]; ++j) {
+            const Entry& row = probe_entries[j];
+            bool found = false;
+            for (uint32_t i = heads[row.hash & (buckets - 1)]; i != kEndOfChain; i = chain[i]) {
+                if (entries[i].hash != row.hash ||
+                    !keysEqual(build_keys, entries[i].position, probe_keys, row.position)) {
+                    continue;
+                }
+                out.push_back(build_left ? Match{entries[i].position, row.position}
+                                         : Match{row.position, entries[i].position});
+                found = true;
+                if (keep_build) {
+                    matched[i] = true;
+                }
+            }
+            if (!found && keep_probe) {
+                out.push_back({row.position, kNoRow});
+            }
+        }
+        for (size_t i = 0; i < matched.size(); ++i) {
+            if (!matched[i]) {
+                out.push_back({entries[i].position, kNoRow});
+            }
+        }
+    });
+
+    size_t total = unmatched.size();
+    for (const auto& part : parts) {
+        total += part.size();
+    }
+    matches.reserve(total);
+    for (const auto& part : parts) {
+        matches.insert(matches.end(), part.begin(), part.end());
+    }
+    for (size_t pos : unmatched) {
+        matches.push_back({pos, kNoRow});
+    }
+}
+
+// Shares both table locks, taken in address order; a self-join takes its
+// table's lock once
+std::pair<std::shared_lock<std::shared_mutex>, std::shared_lock<std::shared_mutex>> HashJoin::lockTables() const {
+    Table* first = std::min(left_.table.get(), right_.table.get(), std::less<Table*>());
+    Table* second = std::max(left_.table.get(), right_.table.get(), std::less<Table*>());
+    std::pair<std::shared_lock<std::shared_mutex>, std::shared_lock<std::shared_mutex>> locks;
+    locks.first = sharedLock(first->mutex_);
+    if (second != first) {
+        locks.second = sharedLock(second->mutex_);
+    }
+    return locks;
+}
+
+// An inner join starts from the side statistics expect to be smaller, so
+// that if it drives index lookups the other side is never scanned
+bool HashJoin::rightFirst() const {
+    double left_estimate = left_.table->estimateRows(left_.where.get());
+    double right_estimate = right_.table->estimateRows(right_.where.get());
+    return type_ == JoinType::INNER && left_estimate >= 0 && right_estimate >= 0 && right_estimate < left_estimate;
+}
+
+// How EXPLAIN names the join; index_outer is the side whose rows are
+// looked up in the other's index, or null for a hash join
+std::string HashJoin::label(const Side* index_outer) const {
+    const Side& inner = index_outer == &left_ ? right_ : left_;
+    std::string kind = type_ == JoinType::LEFT ? "Left Join" : "Join";
+    std::string label = (index_outer ? "Index Nested Loop " : "Hash ") + kind + " on " + left_.name + "." +
+                        left_.table->getColumns()[left_.key].name + " = " + right_.name + "." +
+                        right_.table->getColumns()[right_.key].name;
+    if (index_outer) {
+        label += ", outer: " + index_outer->name + ", index: " + inner.table->index_names_[inner.key];
+    }
+    return label;
+}
+
+// Without statistics the strategy is only known at run time, so a hash
+// join is shown. The row estimate assumes each key value of the side
+// with fewer of them matches rows on the other side.
+std::unique_ptr<PlanNode> HashJoin::explain() const {
+    auto locks = lockTables();
+    bool right_first = rightFirst();
+    const Side& outer = right_first ? right_ : left_;
+    const Side& inner = right_first ? left_ : right_;
+    double outer_estimate = outer.table->estimateRows(outer.where.get());
+
+    double rows = -1;
+    std::shared_ptr<const TableStatistics> left_stats = left_.table->statistics();
+    std::shared_ptr<const TableStatistics> right_stats = right_.table->statistics();
+    if (left_stats && right_stats) {
+        double left_rows = left_.table->estimateRows(left_.where.get());
+        double right_rows = right_.table->estimateRows(right_.where.get());
+        double distinct = std::max({left_stats->columns[left_.key].distinctCount(),
+                                    right_stats->columns[right_.key].distinctCount(), 1.0});
+        rows = left_rows * right_rows / distinct;
+        if (type_ == JoinType::LEFT) {
+            rows = std::max(rows, left_rows);
+        }
+    }
+
+    bool index_join = outer_estimate >= 0 && indexable(static_cast<size_t>(outer_estimate), inner);
+    auto node = std::make_unique<PlanNode>(label(index_join ? &outer : nullptr), rows);
+    node->add(left_.table->accessNode(left_.where.get()));
+    node->add(right_.table->accessNode(right_.where.get()));
+    return node;
+}
+
+QueryResult HashJoin::execute(const ReadView& view, PlanNode* plan) const {
+    ProfileScope scope(plan ? &plan->profile : nullptr);
+    auto locks = lockTables();
+
+    bool right_first = rightFirst();
+    const Side& outer = right_first ? right_ : left_;
+    const Side& inner = right_first ? left_ : right_;
+    PlanNode* outer_access = plan ? plan->child(right_first ? 1 : 0) : nullptr;
+    PlanNode* inner_access = plan ? plan->child(right_first ? 0 : 1) : nullptr;
+
+    std::vector<size_t> left_rows, right_rows;
+    std::vector<size_t>& outer_rows = right_first ? right_rows : left_rows;
+    std::vector<size_t>& inner_rows = right_first ? left_rows : right_rows;
+    std::vector<Match> matches;
+    const Side* index_outer = nullptr;
+    outer.table->filterPositions(outer.where.get(), view, outer_rows, outer_access);
+    if (indexable(outer_rows.size(), inner)) {
+        index_outer = &outer;
+        indexJoin(outer, outer_rows, inner, view, matches);
+    } else {
+        inner.table->filterPositions(inner.where.get(), view, inner_rows, inner_access);
+        if (type_ == JoinType::INNER && indexable(inner_rows.size(), outer)) {
+            index_outer = &inner;
+            indexJoin(inner, inner_rows, outer, view, matches);
+        } else {
+            hashJoin(left_rows, right_rows, matches);
+        }
+    }
+    if (plan) {
+        plan->label = label(index_outer);
+        plan->profile.rows_in += left_rows.size() + right_rows.size();
+        plan->profile.rows_out += matches.size();
+    }
+
+    QueryResult result;
+    result.columns = result_columns_;
+    result.success = true;
+    result.rows.resize(matches.size());
+    size_t morsels = (matches.size() + kMorselSize - 1) / kMorselSize;
+    ThreadPool::instance().parallelFor(morsels, Session::current().parallelism, [&](size_t m) {
+        size_t begin = m * kMorselSize;
+        size_t end = std::min(matches.size(), begin + kMorselSize);
+        for (size_t i = begin; i < end; ++i) {
+            result.rows[i].reserve(outputs_.size());
+        }
+        for (const Output& output : outputs_) {
+            const ColumnVector& column = (output.right ? right_ : left_).table->data_[output.column];
+            for (size_t i = begin; i < end; ++i) {
+                size_t pos = output.right ? matches[i].second : matches[i].first;
+                result.rows[i].push_back(pos == kNoRow ? Value() : column.get(pos));
+            }
+        }
+    });
+    return result;
+}
+
+}
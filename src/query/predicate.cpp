@@ -0,0 +1,494 @@
+#include "predicate.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <string_view>
+
+namespace InMemoryDB {
+
+namespace {
+
+size_t wordCount(size_t count) {
+    return (count + 63) / 64;
+}
+
+uint64_t tailMask(size_t count, size_t word) {
+    size_t base = word * 64;
+    if (count >= base + 64) return ~uint64_t(0);
+    if (count <= base) return 0;
+    return (uint64_t(1) << (count - base)) - 1;
+}
+
+// Pack one byte per row into a bitmap. Kept separate from the compare loop
+// so that both loops are simple enough for the compiler to vectorize.
+void packFlags(const uint8_t* flags, size_t count, uint64_t* out) {
+    for (size_t w = 0; w < kBatchWords; ++w) {
+        size_t base = w * 64;
+        size_t n = count > base ? std::min<size_t>(64, count - base) : 0;
+        uint64_t word = 0;
+        for (size_t j = 0; j < n; ++j) {
+            word |= uint64_t(flags[base + j]) << j;
+        }
+        out[w] = word;
+    }
+}
+
+template <typename T, typename L, typename Cmp>
+void compareKernel(const T* values, L literal, size_t count, uint64_t* out) {
+    uint8_t flags[kBatchSize];
+    Cmp cmp;
+    for (size_t i = 0; i < count; ++i) {
+        flags[i] = cmp(static_cast<L>(values[i]), literal);
+    }
+    packFlags(flags, count, out);
+}
+
+template <typename T, typename L>
+void compareKernel(const T* values, L literal, CompareOp op, size_t count, uint64_t* out) {
+    switch (op) {
+        case CompareOp::EQ: compareKernel<T, L, std::equal_to<L>>(values, literal, count, out); break;
+        case CompareOp::NE: compareKernel<T, L, std::not_equal_to<L>>(values, literal, count, out); break;
+        case CompareOp::LT: compareKernel<T, L, std::less<L>>(values, literal, count, out); break;
+        case CompareOp::LE: compareKernel<T, L, std::less_equal<L>>(values, literal, count, out); break;
+        case CompareOp::GT: compareKernel<T, L, std::greater<L>>(values, literal, count, out); break;
+        case CompareOp::GE: compareKernel<T, L, std::greater_equal<L>>(values, literal, count, out); break;
+    }
+}
+
+template <typename T>
+bool compareScalar(const T& a, const T& b, CompareOp op) {
+    switch (op) {
+        case CompareOp::EQ: return a == b;
+        case CompareOp::NE: return a != b;
+        case CompareOp::LT: return a < b;
+        case CompareOp::LE: return a <= b;
+        case CompareOp::GT: return a > b;
+        case CompareOp::GE: return a >= b;
+    }
+    return false;
+}
+
+// Integer blocks are compared in their encoded form: one comparison per
+// run, or packed offsets against the literal shifted by the block's base
+void compareInts(const ColumnBlock& block, size_t offset, const Value& literal, CompareOp op,
+                 size_t count, uint64_t* out) {
+    switch (block.encoding) {
+        case Encoding::RLE: {
+            uint8_t flags[kBatchSize];
+            size_t run = std::upper_bound(block.run_ends.begin(), block.run_ends.end(), offset) -
+                         block.run_ends.begin();
+            for (size_t i = 0; i < count; ++run) {
+                size_t run_end = std::min<size_t>(block.run_ends[run] - offset, count);
+                bool match = literal.isInt()
+                                 ? compareScalar<int64_t>(block.run_values[run], literal.asInt(), op)
+                                 : compareScalar<double>(block.run_values[run], literal.asDouble(), op);
+                std::memset(flags + i, match, run_end - i);
+                i = run_end;
+            }
+            packFlags(flags, count, out);
+            break;
+        }
+        case Encoding::BITPACK: {
+            uint32_t codes[kBatchSize];
+            block.codes.unpack(offset, count, codes);
+            if (literal.isInt()) {
+                compareKernel(codes, literal.asInt() - int64_t(block.base), op, count, out);
+            } else {
+                compareKernel(codes, literal.asDouble() - block.base, op, count, out);
+            }
+            break;
+        }
+        default:
+            if (literal.isInt()) {
+                compareKernel(block.ints.data() + offset, static_cast<int32_t>(literal.asInt()), op, count, out);
+            } else {
+                compareKernel(block.ints.data() + offset, literal.asDouble(), op, count, out);
+            }
+            break;
+    }
+}
+
+// A dictionary is sorted, so the literal maps to a range of codes once per
+// batch and each row then costs one code comparison
+void compareStrings(const ColumnBlock& block, size_t offset, std::string_view literal,
+                    CompareOp op, size_t count, uint64_t* out) {
+    auto text = [&](const StringRef& ref) { return std::string_view(block.heap.data() + ref.offset, ref.length); };
+    uint8_t flags[kBatchSize];
+
+    if (block.encoding == Encoding::DICTIONARY) {
+        const std::vector<StringRef>& dictionary = block.strings;
+        uint32_t lower = static_cast<uint32_t>(
+            std::lower_bound(dictionary.begin(), dictionary.end(), literal,
+                             [&](const StringRef& ref, std::string_view s) { return text(ref) < s; }) -
+            dictionary.begin());
+        uint32_t upper = static_cast<uint32_t>(
+            std::upper_bound(dictionary.begin(), dictionary.end(), literal,
+                             [&](std::string_view s, const StringRef& ref) { return s < text(ref); }) -
+            dictionary.begin());
+        uint32_t size = static_cast<uint32_t>(dictionary.size());
+
+        // Rows match when their code is (or, for NE, is not) in [low, high)
+        uint32_t low = 0;
+        uint32_t high = 0;
+        bool inside = true;
+        switch (op) {
+            case CompareOp::EQ: low = lower; high = upper; break;
+            case CompareOp::NE: low = lower; high = upper; inside = false; break;
+            case CompareOp::LT: low = 0; high = lower; break;
+            case CompareOp::LE: low = 0; high = upper; break;
+            case CompareOp::GT: low = upper; high = size; break;
+            case CompareOp::GE: low = lower; high = size; break;
+        }
+
+        uint32_t codes[kBatchSize];
+        block.codes.unpack(offset, count, codes);
+        uint32_t span = high - low;
+        for (size_t i = 0; i < count; ++i) {
+            flags[i] = (codes[i] - low < span) == inside;
+        }
+        packFlags(flags, count, out);
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        int c = text(block.strings[offset + i]).compare(literal);
+        switch (op) {
+            case CompareOp::EQ: flags[i] = c == 0; break;
+            case CompareOp::NE: flags[i] = c != 0; break;
+            case CompareOp::LT: flags[i] = c < 0; break;
+            case CompareOp::LE: flags[i] = c <= 0; break;
+            case CompareOp::GT: flags[i] = c > 0; break;
+            case CompareOp::GE: flags[i] = c >= 0; break;
+        }
+    }
+    packFlags(flags, count, out);
+}
+
+// Booleans are already bit-packed, so compare a whole word at a time
+void compareBools(const uint64_t* bits, bool literal, CompareOp op, size_t count, uint64_t* out) {
+    size_t words = wordCount(count);
+    for (size_t w = 0; w < kBatchWords; ++w) {
+        if (w >= words) {
+            out[w] = 0;
+            continue;
+        }
+        uint64_t b = bits[w];
+        uint64_t r = 0;
+        switch (op) {
+            case CompareOp::EQ: r = literal ? b : ~b; break;
+            case CompareOp::NE: r = literal ? ~b : b; break;
+            case CompareOp::LT: r = literal ? ~b : 0; break;
+            case CompareOp::LE: r = literal ? ~uint64_t(0) : ~b; break;
+            case CompareOp::GT: r = literal ? 0 : b; break;
+            case CompareOp::GE: r = literal ? b : ~uint64_t(0); break;
+        }
+        out[w] = r & tailMask(count, w);
+    }
+}
+
+}
+
+const char* compareOpName(CompareOp op) {
+    switch (op) {
+        case CompareOp::EQ: return "=";
+        case CompareOp::NE: return "!=";
+        case CompareOp::LT: return "<";
+        case CompareOp::LE: return "<=";
+        case CompareOp::GT: return ">";
+        case CompareOp::GE: return ">=";
+    }
+    return "";
+}
+
+std::string literalText(const Value& value) {
+    if (value.isBool()) {
+        return value.asBool() ? "TRUE" : "FALSE";
+    }
+    if (!value.isString()) {
+        std::ostringstream out;
+        out << value;
+        return out.str();
+    }
+    std::string text = "'";
+    for (char c : value.asString()) {
+        text += c;
+        if (c == '\'') text += c;
+    }
+    return text + "'";
+}
+
+std::string Predicate::toString() const {
+    switch (kind_) {
+        case Kind::COMPARE:
+            return column_name_ + " " + compareOpName(op_) + " " + literalText(literal_);
+        case Kind::NOT:
+            return "NOT (" + children_[0]->toString() + ")";
+        case Kind::AND:
+        case Kind::OR: {
+            std::string text;
+            for (const auto& child : children_) {
+                if (!text.empty()) text += kind_ == Kind::AND ? " AND " : " OR ";
+                bool nested = child->kind_ == Kind::AND || child->kind_ == Kind::OR;
+                text += nested && child->kind_ != kind_ ? "(" + child->toString() + ")" : child->toString();
+            }
+            return text;
+        }
+    }
+    return "";
+}
+
+CompareOp reverseCompareOp(CompareOp op) {
+    switch (op) {
+        case CompareOp::LT: return CompareOp::GT;
+        case CompareOp::LE: return CompareOp::GE;
+        case CompareOp::GT: return CompareOp::LT;
+        case CompareOp::GE: return CompareOp::LE;
+        default: return op;
+    }
+}
+
+std::unique_ptr<Predicate> Predicate::compare(const std::string& column, CompareOp op, const Value& literal) {
+    std::unique_ptr<Predicate> pred(new Predicate(Kind::COMPARE));
+    pred->column_name_ = column;
+    pred->op_ = op;
+    pred->literal_ = literal;
+    return pred;
+}
+
+std::unique_ptr<Predicate> Predicate::logical(Kind kind, std::unique_ptr<Predicate> left,
+                                              std::unique_ptr<Predicate> right) {
+    std::unique_ptr<Predicate> pred(new Predicate(kind));
+    pred->children_.push_back(std::move(left));
+    if (right) {
+        pred->children_.push_back(std::move(right));
+    }
+    return pred;
+}
+
+void Predicate::splitConjuncts(std::unique_ptr<Predicate> where, std::vector<std::unique_ptr<Predicate>>& out) {
+    if (where->kind_ != Kind::AND) {
+        out.push_back(std::move(where));
+        return;
+    }
+    for (auto& child : where->children_) {
+        splitConjuncts(std::move(child), out);
+    }
+}
+
+bool Predicate::bind(const std::vector<Column>& columns, std::string& error, const std::string& table) {
+    if (kind_ != Kind::COMPARE) {
+        for (auto& child : children_) {
+            if (!child->bind(columns, error, table)) return false;
+        }
+        return true;
+    }
+
+    std::string_view name = column_name_;
+    if (!table.empty() && name.size() > table.size() && name.compare(0, table.size(), table) == 0 &&
+        name[table.size()] == '.') {
+        name.remove_prefix(table.size() + 1);
+    }
+    column_index_ = -1;
+    for (size_t i = 0; i < columns.size(); ++i) {
+        if (columns[i].name == name) {
+            column_index_ = static_cast<int>(i);
+            break;
+        }
+    }
+    if (column_index_ < 0) {
+        error = "Unknown column '" + column_name_ + "' in WHERE clause";
+        return false;
+    }
+
+    // Coerce the literal to the column's type once, so kernels never branch on it
+    bool ok = false;
+    switch (columns[column_index_].type) {
+        case DataType::INTEGER:
+            // Integers outside the column's range compare as doubles
+            if (literal_.isInt() && static_cast<int32_t>(literal_.asInt()) != literal_.asInt()) {
+                literal_ = literal_.asDouble();
+            }
+            ok = literal_.isNumber();
+            break;
+        case DataType::DOUBLE:
+            if (literal_.isInt()) {
+                literal_ = literal_.asDouble();
+            }
+            ok = literal_.isDouble();
+            break;
+        case DataType::STRING:
+            ok = literal_.isString();
+            break;
+        case DataType::BOOLEAN:
+            ok = literal_.isBool();
+            break;
+    }
+    if (!ok) {
+        error = "Type mismatch comparing column '" + column_name_ + "'";
+        return false;
+    }
+    return true;
+}
+
+void Predicate::evaluateCompare(const ColumnVector& column, size_t start, size_t count, BatchMask& mask) const {
+    uint64_t* cmp = mask.is_true;
+
+    switch (column.type()) {
+        case DataType::INTEGER:
+            compareInts(column.blockOf(start), start & kBlockMask, literal_, op_, count, cmp);
+            break;
+        case DataType::DOUBLE:
+            compareKernel(column.doubleData() + start, literal_.asDouble(), op_, count, cmp);
+            break;
+        case DataType::STRING:
+            compareStrings(column.blockOf(start), start & kBlockMask, literal_.asString(), op_, count, cmp);
+            break;
+        case DataType::BOOLEAN:
+            compareBools(column.boolData().words() + start / 64, literal_.asBool(), op_, count, cmp);
+            break;
+    }
+
+    // A comparison against NULL is neither true nor false
+    const uint64_t* valid = column.validity().words() + start / 64;
+    size_t words = wordCount(count);
+    for (size_t w = 0; w < kBatchWords; ++w) {
+        uint64_t v = w < words ? valid[w] & tailMask(count, w) : 0;
+        mask.is_false[w] = ~cmp[w] & v;
+        mask.is_true[w] = cmp[w] & v;
+    }
+}
+
+void Predicate::evaluate(const std::vector<ColumnVector>& data, size_t start, size_t count, BatchMask& mask) const {
+    switch (kind_) {
+        case Kind::COMPARE:
+            evaluateCompare(data[column_index_], start, count, mask);
+            break;
+        case Kind::NOT:
+            children_[0]->evaluate(data, start, count, mask);
+            for (size_t w = 0; w < kBatchWords; ++w) {
+                std::swap(mask.is_true[w], mask.is_false[w]);
+            }
+            break;
+        case Kind::AND:
+        case Kind::OR: {
+            BatchMask right;
+            children_[0]->evaluate(data, start, count, mask);
+            children_[1]->evaluate(data, start, count, right);
+            for (size_t w = 0; w < kBatchWords; ++w) {
+                if (kind_ == Kind::AND) {
+                    mask.is_true[w] &= right.is_true[w];
+                    mask.is_false[w] |= right.is_false[w];
+                } else {
+                    mask.is_true[w] |= right.is_true[w];
+                    mask.is_false[w] &= right.is_false[w];
+                }
+            }
+            break;
+        }
+    }
+}
+
+// Whether some value in [min, max] can satisfy "value op literal"
+template <typename T>
+static bool rangeMayMatch(const T& min, const T& max, const T& literal, CompareOp op) {
+    switch (op) {
+        case CompareOp::EQ: return min <= literal && literal <= max;
+        case CompareOp::NE: return !(min == literal && max == literal);
+        case CompareOp::LT: return min < literal;
+        case CompareOp::LE: return min <= literal;
+        case CompareOp::GT: return max > literal;
+        case CompareOp::GE: return max >= literal;
+    }
+    return true;
+}
+
+static CompareOp negateCompareOp(CompareOp op) {
+    switch (op) {
+        case CompareOp::EQ: return CompareOp::NE;
+        case CompareOp::NE: return CompareOp::EQ;
+        case CompareOp::LT: return CompareOp::GE;
+        case CompareOp::LE: return CompareOp::GT;
+        case CompareOp::GT: return CompareOp::LE;
+        case CompareOp::GE: return CompareOp::LT;
+    }
+    return op;
+}
+
+// With negate set, asks instead whether some row may be definitely false,
+// which is what NOT needs; a comparison is false only on a non-NULL value
+// satisfying the negated operator
+bool Predicate::mayMatch(const std::vector<ColumnVector>& data, size_t block, bool negate) const {
+    switch (kind_) {
+        case Kind::COMPARE: {
+            const ColumnVector& column = data[column_index_];
+            const ZoneMap& zone = column.zone(block);
+            if (zone.value_count == 0) {
+                return false;
+            }
+            CompareOp op = negate ? negateCompareOp(op_) : op_;
+            switch (column.type()) {
+                case DataType::STRING:
+                    return rangeMayMatch<std::string_view>(zone.min_string, zone.max_string, literal_.asString(), op);
+                case DataType::BOOLEAN:
+                    return rangeMayMatch(zone.min, zone.max, literal_.asBool() ? 1.0 : 0.0, op);
+                default:
+                    return rangeMayMatch(zone.min, zone.max, literal_.asDouble(), op);
+            }
+        }
+        case Kind::NOT:
+            return children_[0]->mayMatch(data, block, !negate);
+        case Kind::AND:
+        case Kind::OR:
+            // NOT (a AND b) is (NOT a) OR (NOT b), and vice versa
+            if ((kind_ == Kind::AND) != negate) {
+                return children_[0]->mayMatch(data, block, negate) && children_[1]->mayMatch(data, block, negate);
+            }
+            return children_[0]->mayMatch(data, block, negate) || children_[1]->mayMatch(data, block, negate);
+    }
+    return true;
+}
+
+int Predicate::evaluateRow(const std::vector<ColumnVector>& data, size_t row) const {
+    switch (kind_) {
+        case Kind::COMPARE: {
+            const ColumnVector& column = data[column_index_];
+            if (column.isNull(row)) return -1;
+            switch (column.type()) {
+                case DataType::INTEGER:
+                    if (literal_.isInt()) {
+                        return compareScalar<int64_t>(column.intAt(row), literal_.asInt(), op_);
+                    }
+                    return compareScalar<double>(column.intAt(row), literal_.asDouble(), op_);
+                case DataType::DOUBLE:
+                    return compareScalar(column.doubleData()[row], literal_.asDouble(), op_);
+                case DataType::STRING:
+                    return compareScalar(column.stringAt(row), literal_.asString(), op_);
+                case DataType::BOOLEAN:
+                    return compareScalar(column.boolData().get(row), literal_.asBool(), op_);
+            }
+            return -1;
+        }
+        case Kind::NOT: {
+            int v = children_[0]->evaluateRow(data, row);
+            return v < 0 ? v : !v;
+        }
+        case Kind::AND: {
+            int l = children_[0]->evaluateRow(data, row);
+            if (l == 0) return 0;
+            int r = children_[1]->evaluateRow(data, row);
+            if (r == 0) return 0;
+            return (l < 0 || r < 0) ? -1 : 1;
+        }
+        case Kind::OR: {
+            int l = children_[0]->evaluateRow(data, row);
+            if (l == 1) return 1;
+            int r = children_[1]->evaluateRow(data, row);
+            if (r == 1) return 1;
+            return (l < 0 || r < 0) ? -1 : 0;
+        }
+    }
+    return -1;
+}
+
+}
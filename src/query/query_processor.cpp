@@ -3,6 +3,7 @@
 
 #include "storage_engine.h"
 #include "plsql_parser.h"
+#include "prepared_statement.h"
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -37,12 +38,8 @@ public:
             return result;
         }
         
-        // Parse and execute
-        PLSQLLexer lexer(normalized_sql);
-        auto tokens = lexer.tokenize();
-        
-        PLSQLParser parser(tokens);
-        return parser.parse();
+        // Parse and execute, reusing the cached plan of a repeated statement
+        return executeSql(normalized_sql);
     }
     
 private:
@@ -0,0 +1,297 @@
+#include "sort.h"
+#include "thread_pool.h"
+#include "predicate.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace InMemoryDB {
+
+namespace {
+
+// Serve a LIMIT from heaps only when it keeps at most this fraction of the
+// rows; beyond that, sorting everything is as cheap
+constexpr size_t kTopKFraction = 4;
+
+void appendBigEndian(uint64_t bits, std::string& out) {
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<char>(bits >> shift));
+    }
+}
+
+// Flipping the sign bit orders two's complement integers as unsigned
+uint64_t orderedInt(int64_t value) {
+    return static_cast<uint64_t>(value) ^ (uint64_t(1) << 63);
+}
+
+// Positive doubles order like their bits once the sign is set; negative
+// ones order in reverse, so all their bits are flipped
+uint64_t orderedDouble(double value) {
+    if (value == 0) {
+        value = 0;  // -0.0 equals 0.0
+    }
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return (bits >> 63) ? ~bits : bits | (uint64_t(1) << 63);
+}
+
+// Zero bytes are escaped as 00 FF and the string ends with 00 00, so a
+// string sorts before any string it is a prefix of
+void appendOrderedString(std::string_view value, std::string& out) {
+    for (char c : value) {
+        out.push_back(c);
+        if (c == '\0') {
+            out.push_back('\xFF');
+        }
+    }
+    out.push_back('\0');
+    out.push_back('\0');
+}
+
+void finishKey(bool descending, size_t start, std::string& out) {
+    if (descending) {
+        for (size_t i = start; i < out.size(); ++i) {
+            out[i] = static_cast<char>(~out[i]);
+        }
+    }
+}
+
+struct KeyRef {
+    const char* data;
+    size_t length;
+    size_t index;
+};
+
+bool keyLess(const char* a, size_t a_length, size_t a_index, const char* b, size_t b_length, size_t b_index) {
+    int c = std::memcmp(a, b, std::min(a_length, b_length));
+    if (c != 0) {
+        return c < 0;
+    }
+    if (a_length != b_length) {
+        return a_length < b_length;
+    }
+    return a_index < b_index;
+}
+
+bool refLess(const KeyRef& a, const KeyRef& b) {
+    return keyLess(a.data, a.length, a.index, b.data, b.length, b.index);
+}
+
+struct HeapEntry {
+    std::string key;
+    size_t index;
+};
+
+bool heapLess(const HeapEntry& a, const HeapEntry& b) {
+    return keyLess(a.key.data(), a.key.size(), a.index, b.key.data(), b.key.size(), b.index);
+}
+
+// How many of the first d merged elements come from a; keys are distinct
+// thanks to the index tie-break
+size_t coRank(size_t d, const KeyRef* a, size_t a_size, const KeyRef* b, size_t b_size) {
+    size_t low = d > b_size ? d - b_size : 0;
+    size_t high = std::min(d, a_size);
+    while (low < high) {
+        size_t i = (low + high) / 2;
+        if (refLess(a[i], b[d - i - 1])) {
+            low = i + 1;
+        } else {
+            high = i;
+        }
+    }
+    return low;
+}
+
+// Each worker keeps a max-heap of the best limit rows it has seen and
+// replaces the top whenever it sees a better one
+std::vector<size_t> topK(size_t count, const std::function<void(size_t, std::string&)>& key, size_t limit,
+                         size_t parallelism) {
+    size_t morsels = (count + kMorselSize - 1) / kMorselSize;
+    size_t workers = std::max<size_t>(1, std::min(morsels, parallelism));
+    std::vector<std::vector<HeapEntry>> heaps(workers);
+    std::atomic<size_t> next_morsel(0);
+    ThreadPool::instance().parallelFor(workers, workers, [&](size_t worker) {
+        std::vector<HeapEntry>& heap = heaps[worker];
+        HeapEntry candidate;
+        for (size_t m = next_morsel++; m < morsels; m = next_morsel++) {
+            size_t end = std::min(count, (m + 1) * kMorselSize);
+            for (size_t i = m * kMorselSize; i < end; ++i) {
+                candidate.key.clear();
+                key(i, candidate.key);
+                candidate.index = i;
+                if (heap.size() < limit) {
+                    heap.push_back(std::move(candidate));
+                    std::push_heap(heap.begin(), heap.end(), heapLess);
+                    candidate = HeapEntry();
+                } else if (heapLess(candidate, heap.front())) {
+                    std::pop_heap(heap.begin(), heap.end(), heapLess);
+                    std::swap(heap.back(), candidate);
+                    std::push_heap(heap.begin(), heap.end(), heapLess);
+                }
+            }
+        }
+    });
+
+    std::vector<HeapEntry> best;
+    for (auto& heap : heaps) {
+        std::move(heap.begin(), heap.end(), std::back_inserter(best));
+    }
+    std::sort(best.begin(), best.end(), heapLess);
+    best.resize(std::min(best.size(), limit));
+
+    std::vector<size_t> indexes;
+    indexes.reserve(best.size());
+    for (const HeapEntry& entry : best) {
+        indexes.push_back(entry.index);
+    }
+    return indexes;
+}
+
+// Builds every key, sorts one run per thread, then merges runs pairwise;
+// each merge is split at co-ranks so every round uses all threads
+std::vector<size_t> mergeSort(size_t count, const std::function<void(size_t, std::string&)>& key,
+                              size_t parallelism) {
+    size_t morsels = (count + kMorselSize - 1) / kMorselSize;
+    std::vector<std::string> buffers(morsels);
+    std::vector<KeyRef> refs(count);
+    ThreadPool::instance().parallelFor(morsels, parallelism, [&](size_t m) {
+        size_t begin = m * kMorselSize;
+        size_t end = std::min(count, begin + kMorselSize);
+        std::string& buffer = buffers[m];
+        std::vector<size_t> offsets;
+        offsets.reserve(end - begin + 1);
+        for (size_t i = begin; i < end; ++i) {
+            offsets.push_back(buffer.size());
+            key(i, buffer);
+        }
+        offsets.push_back(buffer.size());
+        for (size_t i = begin; i < end; ++i) {
+            size_t offset = offsets[i - begin];
+            refs[i] = {buffer.data() + offset, offsets[i - begin + 1] - offset, i};
+        }
+    });
+
+    size_t runs = std::max<size_t>(1, std::min(parallelism, count / kBatchSize));
+    std::vector<size_t> bounds(runs + 1);
+    for (size_t r = 0; r <= runs; ++r) {
+        bounds[r] = count * r / runs;
+    }
+    ThreadPool::instance().parallelFor(runs, parallelism, [&](size_t r) {
+        std::sort(refs.begin() + bounds[r], refs.begin() + bounds[r + 1], refLess);
+    });
+
+    std::vector<KeyRef> merged(runs > 1 ? count : 0);
+    for (size_t width = 1; width < runs; width *= 2) {
+        size_t pairs = (runs + 2 * width - 1) / (2 * width);
+        size_t pieces = std::max<size_t>(1, parallelism / pairs);
+        ThreadPool::instance().parallelFor(pairs * pieces, parallelism, [&](size_t task) {
+            size_t pair = task / pieces;
+            size_t piece = task % pieces;
+            size_t low = bounds[std::min(runs, pair * 2 * width)];
+            size_t mid = bounds[std::min(runs, pair * 2 * width + width)];
+            size_t high = bounds[std::min(runs, (pair + 1) * 2 * width)];
+            const KeyRef* a = refs.data() + low;
+            const KeyRef* b = refs.data() + mid;
+            size_t a_size = mid - low;
+            size_t b_size = high - mid;
+
+            size_t first = (high - low) * piece / pieces;
+            size_t last = (high - low) * (piece + 1) / pieces;
+            size_t a_first = coRank(first, a, a_size, b, b_size);
+            size_t a_last = coRank(last, a, a_size, b, b_size);
+            std::merge(a + a_first, a + a_last, b + (first - a_first), b + (last - a_last),
+                       merged.begin() + low + first, refLess);
+        });
+        refs.swap(merged);
+    }
+
+    std::vector<size_t> indexes;
+    indexes.reserve(count);
+    for (const KeyRef& ref : refs) {
+        indexes.push_back(ref.index);
+    }
+    return indexes;
+}
+
+}
+
+void appendSortKey(const Value& value, bool descending, std::string& out) {
+    size_t start = out.size();
+    out.push_back(value.isNull() ? 1 : 0);
+    switch (value.kind()) {
+        case Value::Kind::NUL: break;
+        case Value::Kind::INTEGER: appendBigEndian(orderedInt(value.asInt()), out); break;
+        case Value::Kind::DOUBLE: appendBigEndian(orderedDouble(value.asDouble()), out); break;
+        case Value::Kind::STRING: appendOrderedString(value.asString(), out); break;
+        case Value::Kind::BOOLEAN: out.push_back(value.asBool() ? 1 : 0); break;
+    }
+    finishKey(descending, start, out);
+}
+
+void appendSortKey(const ColumnVector& column, size_t row, bool descending, std::string& out) {
+    size_t start = out.size();
+    bool null = column.isNull(row);
+    out.push_back(null ? 1 : 0);
+    if (!null) {
+        switch (column.type()) {
+            case DataType::INTEGER: appendBigEndian(orderedInt(column.intAt(row)), out); break;
+            case DataType::DOUBLE: appendBigEndian(orderedDouble(column.doubleData()[row]), out); break;
+            case DataType::STRING: appendOrderedString(column.stringAt(row), out); break;
+            case DataType::BOOLEAN: out.push_back(column.boolData().get(row) ? 1 : 0); break;
+        }
+    }
+    finishKey(descending, start, out);
+}
+
+std::vector<size_t> sortIndexes(size_t count, const std::function<void(size_t, std::string&)>& key, size_t limit,
+                                size_t parallelism) {
+    if (limit == 0) {
+        return {};
+    }
+    if (limit <= count / kTopKFraction) {
+        return topK(count, key, limit, parallelism);
+    }
+    std::vector<size_t> indexes = mergeSort(count, key, std::max<size_t>(1, parallelism));
+    if (indexes.size() > limit) {
+        indexes.resize(limit);
+    }
+    return indexes;
+}
+
+bool sortRows(QueryResult& result, const std::vector<SortKey>& order, size_t limit, size_t parallelism,
+              std::string& error) {
+    std::vector<size_t> key_columns;
+    for (const SortKey& key : order) {
+        auto it = std::find_if(result.columns.begin(), result.columns.end(),
+                               [&](const Column& column) { return column.name == key.column; });
+        if (it == result.columns.end()) {
+            error = "ORDER BY column '" + key.column + "' must appear in the select list";
+            return false;
+        }
+        key_columns.push_back(it - result.columns.begin());
+    }
+
+    std::vector<Row>& rows = result.rows;
+    if (order.empty()) {
+        if (rows.size() > limit) {
+            rows.resize(limit);
+        }
+        return true;
+    }
+
+    std::vector<size_t> indexes = sortIndexes(rows.size(), [&](size_t i, std::string& out) {
+        for (size_t k = 0; k < order.size(); ++k) {
+            appendSortKey(rows[i][key_columns[k]], order[k].descending, out);
+        }
+    }, limit, parallelism);
+
+    std::vector<Row> sorted;
+    sorted.reserve(indexes.size());
+    for (size_t i : indexes) {
+        sorted.push_back(std::move(rows[i]));
+    }
+    rows.swap(sorted);
+    return true;
+}
+
+}
@@ -0,0 +1,117 @@
+#include "arena.h"
+#include "session.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local uint64_t t_heap_allocations = 0;
+thread_local uint64_t t_heap_bytes = 0;
+thread_local int t_statement_depth = 0;
+
+void* countedAllocate(std::size_t size) {
+    t_heap_allocations++;
+    t_heap_bytes += size;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* countedAllocate(std::size_t size, std::align_val_t alignment) {
+    t_heap_allocations++;
+    t_heap_bytes += size;
+    std::size_t align = static_cast<std::size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+}
+
+// Replacement global allocation functions; they only add per-thread counting
+void* operator new(std::size_t size) { return countedAllocate(size); }
+void* operator new[](std::size_t size) { return countedAllocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return countedAllocate(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return countedAllocate(size, alignment); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace InMemoryDB {
+
+void* QueryArena::do_allocate(size_t bytes, size_t alignment) {
+    for (;;) {
+        if (block_ < blocks_.size()) {
+            Block& block = blocks_[block_];
+            uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+            size_t start = ((base + offset_ + alignment - 1) & ~(uintptr_t(alignment) - 1)) - base;
+            if (start + bytes <= block.size) {
+                offset_ = start + bytes;
+                used_ += bytes;
+                return block.data.get() + start;
+            }
+            if (block_ + 1 < blocks_.size()) {
+                block_++;
+                offset_ = 0;
+                continue;
+            }
+        }
+
+        // Out of blocks: each new one at least doubles the arena
+        size_t size = std::max(bytes + alignment, blocks_.empty() ? kFirstBlock : blocks_.back().size * 2);
+        blocks_.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+        heap_allocations_++;
+        block_ = blocks_.size() - 1;
+        offset_ = 0;
+    }
+}
+
+void QueryArena::reset() {
+    peak_ = std::max(peak_, used_);
+    used_ = 0;
+    block_ = 0;
+    offset_ = 0;
+}
+
+size_t QueryArena::capacity() const {
+    size_t total = 0;
+    for (const Block& block : blocks_) {
+        total += block.size;
+    }
+    return total;
+}
+
+HeapCounters HeapCounters::thread() {
+    HeapCounters counters;
+    counters.allocations = t_heap_allocations;
+    counters.bytes = t_heap_bytes;
+    return counters;
+}
+
+StatementScope::StatementScope() : outermost_(t_statement_depth++ == 0) {
+    if (outermost_) {
+        Session::current().arena.reset();
+        start_ = HeapCounters::thread();
+    }
+}
+
+StatementScope::~StatementScope() {
+    t_statement_depth--;
+    if (outermost_) {
+        HeapCounters end = HeapCounters::thread();
+        StatementAllocations& stats = Session::current().last_statement;
+        stats.heap_allocations = end.allocations - start_.allocations;
+        stats.heap_bytes = end.bytes - start_.bytes;
+        stats.arena_bytes = Session::current().arena.used();
+    }
+}
+
+}
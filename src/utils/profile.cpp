@@ -0,0 +1,81 @@
+#include "profile.h"
+#include "arena.h"
+#include <chrono>
+
+namespace InMemoryDB {
+
+namespace {
+
+thread_local OperatorProfile* t_profile = nullptr;
+
+uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Costs that no enclosing scope's span covers (other threads' heap use,
+// lock waits) are added to every enclosing operator directly
+void chargeUp(OperatorProfile* profile, std::atomic<uint64_t> OperatorProfile::*counter, uint64_t amount) {
+    for (; profile; profile = profile->parent) {
+        (profile->*counter) += amount;
+    }
+}
+
+}
+
+OperatorProfile* currentProfile() {
+    return t_profile;
+}
+
+// Re-entering the current operator, e.g. the node a caller opened a scope
+// on being run by itself, counts once
+ProfileScope::ProfileScope(OperatorProfile* profile)
+    : profile_(profile == t_profile ? nullptr : profile), previous_(t_profile), start_ns_(0), start_bytes_(0) {
+    if (!profile_) {
+        return;
+    }
+    profile_->loops++;
+    t_profile = profile_;
+    start_bytes_ = HeapCounters::thread().bytes;
+    start_ns_ = nowNs();
+}
+
+ProfileScope::~ProfileScope() {
+    if (!profile_) {
+        return;
+    }
+    profile_->wall_ns += nowNs() - start_ns_;
+    profile_->heap_bytes += HeapCounters::thread().bytes - start_bytes_;
+    t_profile = previous_;
+}
+
+// The thread that called parallelFor runs tasks too; it is already inside
+// the operator's scope, so nothing is charged twice
+ProfileTask::ProfileTask(OperatorProfile* profile)
+    : profile_(profile == t_profile ? nullptr : profile), previous_(t_profile), start_bytes_(0) {
+    if (!profile_) {
+        return;
+    }
+    t_profile = profile_;
+    start_bytes_ = HeapCounters::thread().bytes;
+}
+
+ProfileTask::~ProfileTask() {
+    if (!profile_) {
+        return;
+    }
+    chargeUp(profile_, &OperatorProfile::heap_bytes, HeapCounters::thread().bytes - start_bytes_);
+    t_profile = previous_;
+}
+
+std::shared_lock<std::shared_mutex> sharedLock(std::shared_mutex& mutex) {
+    std::shared_lock<std::shared_mutex> lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        uint64_t start = nowNs();
+        lock.lock();
+        chargeUp(t_profile, &OperatorProfile::lock_wait_ns, nowNs() - start);
+    }
+    return lock;
+}
+
+}
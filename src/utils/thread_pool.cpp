@@ -0,0 +1,154 @@
+#include "thread_pool.h"
+#include "profile.h"
+#include <exception>
+
+namespace InMemoryDB {
+
+// Index of the pool worker running on this thread, or -1 for other threads
+static thread_local int tls_worker_index = -1;
+
+ThreadPool::ThreadPool(size_t threads) : pending_(0), next_queue_(0), stopping_(false) {
+    if (threads == 0) threads = 1;
+    for (size_t i = 0; i < threads; ++i) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool(std::thread::hardware_concurrency());
+    return pool;
+}
+
+void ThreadPool::submit(std::function<void()> job) {
+    // Workers push onto their own deque; other threads spread jobs round-robin
+    size_t target = tls_worker_index >= 0 ? static_cast<size_t>(tls_worker_index)
+                                          : next_queue_++ % queues_.size();
+    {
+        // Count the job first so pending_ never drops below zero
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        pending_++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+        queues_[target]->jobs.push_back(std::move(job));
+    }
+    wake_.notify_one();
+}
+
+bool ThreadPool::tryPop(size_t self, std::function<void()>& job) {
+    {
+        WorkQueue& own = *queues_[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+    
+    for (size_t i = 1; i < queues_.size(); ++i) {
+        WorkQueue& victim = *queues_[(self + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t self) {
+    tls_worker_index = static_cast<int>(self);
+    
+    while (true) {
+        std::function<void()> job;
+        if (tryPop(self, job)) {
+            pending_--;
+            job();
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        wake_.wait(lock, [this] { return stopping_ || pending_ > 0; });
+        if (stopping_) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t parallelism, const std::function<void(size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    if (parallelism <= 1 || count == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            body(i);
+        }
+        return;
+    }
+    
+    // Shared so helpers that start after the loop has finished can still
+    // look at it safely; they find no work left and never touch body
+    struct State {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        size_t count = 0;
+        const std::function<void(size_t)>* body = nullptr;
+        OperatorProfile* profile = nullptr;  // charged for helpers' work
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+    state->count = count;
+    state->body = &body;
+    state->profile = currentProfile();
+    
+    auto run = [state]() {
+        size_t i;
+        while ((i = state->next++) < state->count) {
+            // Charged before the task counts as done, while the profile
+            // is certain to exist
+            try {
+                ProfileTask task(state->profile);
+                (*state->body)(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->error) state->error = std::current_exception();
+            }
+            if (++state->done == state->count) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }
+    };
+    
+    size_t helpers = std::min(parallelism, count) - 1;
+    for (size_t i = 0; i < helpers; ++i) {
+        submit(run);
+    }
+    run();
+    
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&] { return state->done == state->count; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+}
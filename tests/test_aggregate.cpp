@@ -0,0 +1,157 @@
+#include "test_support.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <numeric>
+#include <optional>
+
+using namespace InMemoryDB;
+using namespace InMemoryDB::Test;
+
+namespace {
+
+Value value(const std::string& sql) {
+    std::vector<Row> rows = query(sql);
+    return rows.size() == 1 && rows[0].size() == 1 ? rows[0][0] : Value("no single value");
+}
+
+bool near(const Value& value, double expected) {
+    return value.isNumber() && std::fabs(value.asDouble() - expected) <= 1e-9 * std::max(1.0, std::fabs(expected));
+}
+
+// Aggregates skip NULL inputs; a group with only NULLs counts none and
+// has NULL for the rest, and a NULL key is a group of its own
+void testNulls() {
+    Database db;
+    CHECK(execute("CREATE TABLE g (k INT, v INT, d DOUBLE, s STRING)"));
+    CHECK(execute("INSERT INTO g VALUES (1, NULL, NULL, NULL), (1, 2, 1.5, 'b'), (1, 6, NULL, 'a'), "
+                  "(2, NULL, NULL, NULL), (NULL, 5, 2.5, 'c')"));
+
+    std::vector<Row> rows = query("SELECT k, COUNT(*), COUNT(v), SUM(v), AVG(v), MIN(v), MAX(v), MIN(s), MAX(d) "
+                                  "FROM g GROUP BY k ORDER BY k");
+    CHECK(rows.size() == 3);
+    if (rows.size() == 3) {
+        CHECK(rows[0][0] == Value(int64_t(1)));
+        CHECK(rows[0][1] == Value(int64_t(3)));
+        CHECK(rows[0][2] == Value(int64_t(2)));
+        CHECK(rows[0][3] == Value(int64_t(8)));
+        CHECK(near(rows[0][4], 4.0));
+        CHECK(rows[0][5] == Value(int64_t(2)));
+        CHECK(rows[0][6] == Value(int64_t(6)));
+        CHECK(rows[0][7] == Value("a"));
+        CHECK(rows[0][8] == Value(1.5));
+
+        CHECK(rows[1][0] == Value(int64_t(2)));
+        CHECK(rows[1][1] == Value(int64_t(1)));
+        CHECK(rows[1][2] == Value(int64_t(0)));
+        for (size_t column = 3; column < rows[1].size(); ++column) {
+            CHECK(rows[1][column].isNull());
+        }
+
+        CHECK(rows[2][0].isNull());
+        CHECK(rows[2][1] == Value(int64_t(1)));
+        CHECK(rows[2][3] == Value(int64_t(5)));
+        CHECK(rows[2][7] == Value("c"));
+    }
+
+    // Without GROUP BY, one group over the whole table
+    rows = query("SELECT COUNT(*), COUNT(v), SUM(v), MIN(v), MAX(v) FROM g");
+    CHECK(rows.size() == 1);
+    CHECK(rows[0] ==
+          Row({Value(int64_t(5)), Value(int64_t(3)), Value(int64_t(13)), Value(int64_t(2)), Value(int64_t(6))}));
+    CHECK(near(value("SELECT AVG(v) FROM g"), 13.0 / 3));
+}
+
+// No input rows: one row without GROUP BY, counts 0 and the rest NULL;
+// no rows with it
+void testEmptyInput() {
+    Database db;
+    CHECK(execute("CREATE TABLE g (k INT, v INT)"));
+    for (int pass = 0; pass < 2; ++pass) {
+        std::vector<Row> rows = query("SELECT COUNT(*), COUNT(v), SUM(v), AVG(v), MIN(v), MAX(v) FROM g WHERE k > 100");
+        CHECK(rows.size() == 1);
+        if (rows.size() == 1) {
+            CHECK(rows[0][0] == Value(int64_t(0)));
+            CHECK(rows[0][1] == Value(int64_t(0)));
+            for (size_t column = 2; column < rows[0].size(); ++column) {
+                CHECK(rows[0][column].isNull());
+            }
+        }
+        CHECK(query("SELECT k, COUNT(*) FROM g WHERE k > 100 GROUP BY k").empty());
+        CHECK(execute("INSERT INTO g VALUES (1, 1), (2, NULL)"));
+    }
+}
+
+// Enough rows for several scan batches and a partitioned parallel merge
+constexpr int kRows = 200000;
+
+std::optional<int> kOf(int id) {
+    return id % 97 == 0 ? std::optional<int>() : std::optional<int>(id * 7919 % 3001);
+}
+
+std::optional<int> vOf(int id) {
+    return id % 13 == 0 ? std::optional<int>() : std::optional<int>(id % 1001 - 500);
+}
+
+struct Group {
+    int64_t rows = 0, count = 0, sum = 0;
+    int min = 0, max = 0;
+};
+
+// The same grouped query serially and in parallel, against sums taken here
+void testParallel() {
+    Database db;
+    CHECK(execute("CREATE TABLE p (id INT, k INT, v INT)"));
+    for (int first = 0; first < kRows; first += 50000) {
+        std::string sql = "INSERT INTO p VALUES ";
+        for (int id = first; id < first + 50000; ++id) {
+            std::string k = kOf(id) ? std::to_string(*kOf(id)) : "NULL";
+            std::string v = vOf(id) ? std::to_string(*vOf(id)) : "NULL";
+            sql += (id > first ? ", (" : "(") + std::to_string(id) + ", " + k + ", " + v + ")";
+        }
+        CHECK(execute(sql));
+    }
+
+    std::map<std::optional<int>, Group> expected;
+    for (int id = 0; id < kRows; ++id) {
+        Group& group = expected[kOf(id)];
+        ++group.rows;
+        if (vOf(id)) {
+            int v = *vOf(id);
+            group.min = group.count ? std::min(group.min, v) : v;
+            group.max = group.count ? std::max(group.max, v) : v;
+            ++group.count;
+            group.sum += v;
+        }
+    }
+
+    for (int parallelism : {1, 4}) {
+        CHECK(execute("SET PARALLELISM = " + std::to_string(parallelism)));
+        std::vector<Row> rows = query("SELECT k, COUNT(*), COUNT(v), SUM(v), AVG(v), MIN(v), MAX(v) FROM p GROUP BY k");
+        CHECK(rows.size() == expected.size());
+        size_t matched = 0;
+        for (const Row& row : rows) {
+            auto it = expected.find(row[0].isNull() ? std::optional<int>() : std::optional<int>(row[0].asInt()));
+            if (it == expected.end()) continue;
+            const Group& group = it->second;
+            matched += row[1] == Value(group.rows) && row[2] == Value(group.count) && row[3] == Value(group.sum) &&
+                       near(row[4], double(group.sum) / group.count) && row[5] == Value(group.min) &&
+                       row[6] == Value(group.max);
+        }
+        CHECK(matched == expected.size());
+
+        CHECK(value("SELECT SUM(v) FROM p") == Value(int64_t(std::accumulate(
+                  expected.begin(), expected.end(), int64_t(0), [](int64_t sum, const auto& group) {
+                      return sum + group.second.sum;
+                  }))));
+    }
+}
+
+}
+
+int main() {
+    testNulls();
+    testEmptyInput();
+    testParallel();
+    return report("aggregate");
+}
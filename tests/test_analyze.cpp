@@ -0,0 +1,100 @@
+#include "test_support.h"
+#include <algorithm>
+#include <functional>
+
+using namespace InMemoryDB;
+using namespace InMemoryDB::Test;
+
+namespace {
+
+// id is unique, b splits the rows in two and s in a thousand; each has
+// an index
+constexpr int kRows = 50000;
+
+void load() {
+    CHECK(execute("CREATE TABLE t (id INT, b INT, s STRING)"));
+    std::string sql = "INSERT INTO t VALUES ";
+    for (int id = 0; id < kRows; ++id) {
+        sql += (id ? ", (" : "(") + std::to_string(id) + ", " + std::to_string(id % 2) + ", 's" +
+               std::to_string(id % 1000) + "')";
+    }
+    CHECK(execute(sql));
+    CHECK(execute("CREATE INDEX ti ON t (id) USING BTREE"));
+    CHECK(execute("CREATE INDEX tb ON t (b)"));
+    CHECK(execute("CREATE INDEX ts ON t (s)"));
+}
+
+std::string plan(const std::string& where) {
+    std::vector<Row> rows = query("EXPLAIN SELECT id FROM t WHERE " + where);
+    return rows.size() == 1 ? std::string(rows[0][0].asString()) : "";
+}
+
+std::vector<int> ids(const std::string& where) {
+    std::vector<int> result;
+    for (const Row& row : query("SELECT id FROM t WHERE " + where)) {
+        result.push_back(static_cast<int>(row[0].asInt()));
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::vector<int> expected(const std::function<bool(int)>& where) {
+    std::vector<int> result;
+    for (int id = 0; id < kRows; ++id) {
+        if (where(id)) result.push_back(id);
+    }
+    return result;
+}
+
+struct Case {
+    std::string where;
+    std::function<bool(int)> matches;
+    const char* access;  // how EXPLAIN starts once statistics exist
+};
+
+// Without statistics any usable index is taken; with them, an index
+// only for a selective predicate and a scan otherwise, with the same rows
+// either way
+void testAccessPaths() {
+    Database db;
+    load();
+    std::vector<Case> cases = {
+        {"id < 100", [](int id) { return id < 100; }, "B+tree Index Scan on t using ti"},
+        {"id BETWEEN 10 AND 20", [](int id) { return id >= 10 && id <= 20; }, "B+tree Index Scan on t using ti"},
+        {"id > 100", [](int id) { return id > 100; }, "Seq Scan on t"},
+        {"id >= 0", [](int) { return true; }, "Seq Scan on t"},
+        {"b = 1", [](int id) { return id % 2 == 1; }, "Seq Scan on t"},
+        {"s = 's7'", [](int id) { return id % 1000 == 7; }, "Hash Index Scan on t using ts"},
+        {"b = 1 AND id < 30", [](int id) { return id % 2 == 1 && id < 30; }, "B+tree Index Scan on t using ti"},
+        {"b = 0 AND s = 's8'", [](int id) { return id % 1000 == 8; }, "Hash Index Scan on t using ts"},
+        {"b = 0 AND id > 10", [](int id) { return id % 2 == 0 && id > 10; }, "Seq Scan on t"},
+    };
+
+    for (const Case& c : cases) {
+        CHECK(plan(c.where).find("Seq Scan") != 0);
+        CHECK(ids(c.where) == expected(c.matches));
+    }
+
+    CHECK(execute("ANALYZE t"));
+    for (const Case& c : cases) {
+        CHECK(plan(c.where).find(c.access) == 0);
+        CHECK(ids(c.where) == expected(c.matches));
+    }
+
+    // Fresh statistics follow the data: once nearly every row has the
+    // same s, that value is no longer selective
+    CHECK(plan("s = 'same'").find("Hash Index Scan on t using ts") == 0);
+    CHECK(execute("UPDATE t SET s = 'same' WHERE id > 50"));
+    CHECK(execute("ANALYZE t"));
+    CHECK(plan("s = 'same'").find("Seq Scan on t") == 0);
+    CHECK(ids("s = 'same'") == expected([](int id) { return id > 50; }));
+    CHECK(plan("s = 's7'").find("Hash Index Scan on t using ts") == 0);
+    CHECK(ids("s = 's7'") == std::vector<int>{7});
+}
+
+}
+
+int main() {
+    testAccessPaths();
+    return report("analyze");
+}
@@ -0,0 +1,81 @@
+#include "test_support.h"
+#include "transaction.h"
+
+using namespace InMemoryDB;
+using namespace InMemoryDB::Test;
+
+namespace {
+
+size_t rows(const std::string& sql) {
+    return query(sql).size();
+}
+
+void insertRows(const std::string& table, int count) {
+    std::string sql = "INSERT INTO " + table + " VALUES ";
+    for (int id = 0; id < count; ++id) {
+        sql += (id ? ", (" : "(") + std::to_string(id) + ", " + std::to_string(id % 10) + ")";
+    }
+    CHECK(execute(sql));
+}
+
+// Garbage collection leaves a deleted row in place with its row id
+// tombstoned; an index built afterwards must not see it
+void testIndexAfterDelete() {
+    for (const char* type : {"HASH", "BTREE"}) {
+        Database db;
+        db.engine().setCompactionThreshold(1.0);  // keep the dead rows in place
+        CHECK(execute("CREATE TABLE t (id INT, k INT)"));
+        insertRows("t", 3);
+        CHECK(execute("DELETE FROM t WHERE id = 1"));
+        db.engine().getTable("t")->collectGarbage(kLatestSnapshot);  // unless the compactor already has
+
+        CHECK(execute(std::string("CREATE INDEX ti ON t (id) USING ") + type));
+        CHECK(rows("SELECT * FROM t WHERE id = 1") == 0);
+        CHECK(rows("SELECT * FROM t WHERE id = 2") == 1);
+        CHECK(rows("SELECT * FROM t WHERE id >= 0 ORDER BY id") == 2);
+        CHECK(rows("SELECT COUNT(*) FROM t WHERE id = 1") == 1);
+        CHECK(query("SELECT COUNT(*) FROM t WHERE id = 1")[0][0] == Value(int64_t(0)));
+
+        // The index drives a join from a small table
+        CHECK(execute("CREATE TABLE s (id INT)"));
+        CHECK(execute("INSERT INTO s VALUES (1), (2)"));
+        CHECK(rows("SELECT * FROM s JOIN t ON s.id = t.id") == 1);
+    }
+}
+
+// Compaction moves rows and rebuilds their indexes; lookups still find
+// exactly the live rows
+void testCompaction() {
+    Database db;
+    db.engine().setCompactionThreshold(1.0);
+    CHECK(execute("CREATE TABLE c (id INT, k INT)"));
+    CHECK(execute("CREATE INDEX ci ON c (id) USING BTREE"));
+    CHECK(execute("CREATE INDEX ck ON c (k)"));
+    insertRows("c", 50000);
+    CHECK(execute("DELETE FROM c WHERE k < 7"));
+    std::shared_ptr<Table> table = db.engine().getTable("c");
+    table->collectGarbage(kLatestSnapshot);
+    table->compact();
+    CHECK(table->deadRatio() == 0);
+    CHECK(table->getRowCount() == 15000);
+
+    CHECK(rows("SELECT * FROM c") == 15000);
+    CHECK(rows("SELECT * FROM c WHERE k = 3") == 0);
+    CHECK(rows("SELECT * FROM c WHERE k = 8") == 5000);
+    CHECK(rows("SELECT * FROM c WHERE id = 49999") == 1);
+    CHECK(rows("SELECT * FROM c WHERE id = 49990") == 0);
+    CHECK(rows("SELECT * FROM c WHERE id >= 100 AND id < 200") == 30);
+
+    // Rows appended after compaction get new ids and are indexed too
+    CHECK(execute("INSERT INTO c VALUES (60000, 3)"));
+    CHECK(rows("SELECT * FROM c WHERE k = 3") == 1);
+    CHECK(rows("SELECT * FROM c WHERE id = 60000") == 1);
+}
+
+}
+
+int main() {
+    testIndexAfterDelete();
+    testCompaction();
+    return report("compaction");
+}
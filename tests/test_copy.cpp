@@ -0,0 +1,140 @@
+#include "test_support.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+
+using namespace InMemoryDB;
+using namespace InMemoryDB::Test;
+
+namespace {
+
+std::string g_directory;
+
+Value value(const std::string& sql) {
+    std::vector<Row> rows = query(sql);
+    return rows.size() == 1 && rows[0].size() == 1 ? rows[0][0] : Value("no single value");
+}
+
+// Strings that need quoting, several of them spanning lines
+std::string textOf(int id) {
+    switch (id % 8) {
+        case 0: return "plain " + std::to_string(id);
+        case 1: return "two\nlines " + std::to_string(id);
+        case 2: return "comma, and \"quotes\"";
+        case 3: return "";
+        case 4: return "windows\r\nline\r\n";
+        case 5: return "\n";
+        case 6: return std::string(1500, 'x') + "\n" + std::to_string(id);
+        default: return "\"";
+    }
+}
+
+// Enough rows, and long enough, for the CSV to be cut into several chunks
+void load(const std::string& table, int rows) {
+    CHECK(execute("CREATE TABLE " + table + " (id INT, s STRING, d DOUBLE, b BOOLEAN)"));
+    for (int first = 0; first < rows; first += 5000) {
+        std::string sql = "INSERT INTO " + table + " VALUES ";
+        for (int id = first; id < std::min(rows, first + 5000); ++id) {
+            std::string s = id % 7 == 0 ? "NULL" : "'" + textOf(id) + "'";
+            std::string d = id % 9 == 0 ? "NULL" : std::to_string(id) + ".125";
+            std::string b = id % 11 == 0 ? "NULL" : id % 2 ? "TRUE" : "FALSE";
+            sql += (id > first ? ", (" : "(") + std::to_string(id) + ", " + s + ", " + d + ", " + b + ")";
+        }
+        CHECK(execute(sql));
+    }
+}
+
+// COPY TO then COPY FROM gives back the same rows, NULLs and empty
+// strings kept apart, in either format
+void testRoundTrip() {
+    Database db;
+    load("a", 30000);
+    for (const char* format : {"CSV", "CSV HEADER", "CSV DELIMITER '|'", "BINARY"}) {
+        std::string path = g_directory + "/a.copy";
+        CHECK(execute("COPY a TO '" + path + "' " + format));
+        CHECK(execute("CREATE TABLE r (id INT, s STRING, d DOUBLE, b BOOLEAN)"));
+        std::string error;
+        CHECK(execute("COPY r FROM '" + path + "' " + format, &error));
+        if (!error.empty()) std::cerr << format << ": " << error << std::endl;
+        CHECK(query("SELECT * FROM r ORDER BY id") == query("SELECT * FROM a ORDER BY id"));
+        CHECK(value("SELECT COUNT(*) FROM r WHERE s = ''") == value("SELECT COUNT(*) FROM a WHERE s = ''"));
+        CHECK(value("SELECT COUNT(*) FROM r WHERE s >= ''") == Value(int64_t(30000 - 30000 / 7 - 1)));
+        CHECK(execute("DROP TABLE r"));
+    }
+}
+
+void writeFile(const std::string& path, const std::string& text) {
+    std::ofstream out(path, std::ios::binary);
+    out << text;
+}
+
+// Hand-written CSV: quoted fields spanning lines, CRLF endings, blank lines
+void testQuotedFields() {
+    Database db;
+    CHECK(execute("CREATE TABLE q (id INT, s STRING)"));
+    std::string path = g_directory + "/q.csv";
+    writeFile(path, "1,\"a\nb\"\r\n\n2,\"\"\"\n\"\"\"\r\n3,\n4,\"\"\n5,\"x,\r\ny\"");
+    CHECK(execute("COPY q FROM '" + path + "'"));
+    CHECK(value("SELECT s FROM q WHERE id = 1") == Value("a\nb"));
+    CHECK(value("SELECT s FROM q WHERE id = 2") == Value("\"\n\""));
+    CHECK(query("SELECT s FROM q WHERE id = 3")[0][0].isNull());
+    CHECK(value("SELECT s FROM q WHERE id = 4") == Value(""));
+    CHECK(value("SELECT s FROM q WHERE id = 5") == Value("x,\r\ny"));
+
+    std::string error;
+    writeFile(path, "6,ok\n7,\"never closed\n8,x\n");
+    CHECK(!execute("COPY q FROM '" + path + "'", &error));
+    CHECK(error.find("Unterminated quoted field") != std::string::npos);
+    CHECK(value("SELECT COUNT(*) FROM q") == Value(int64_t(5)));
+}
+
+// A load that fails partway, after earlier chunks went in, leaves nothing
+// behind; inside a transaction, the transaction's own writes survive it
+void testFailedLoad() {
+    Database db;
+    load("a", 30000);
+    std::string path = g_directory + "/bad.csv";
+    CHECK(execute("COPY a TO '" + path + "'"));
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out << "30000,ok,1.5,true\nnot a number,x,1,true\n";
+    }
+    CHECK(execute("CREATE TABLE f (id INT, s STRING, d DOUBLE, b BOOLEAN)"));
+    std::string error;
+    CHECK(!execute("COPY f FROM '" + path + "'", &error));
+    CHECK(error.find("Invalid INTEGER value 'not a number'") != std::string::npos);
+    CHECK(value("SELECT COUNT(*) FROM f") == Value(int64_t(0)));
+
+    CHECK(execute("BEGIN"));
+    CHECK(execute("INSERT INTO f VALUES (-1, 'kept', 0, FALSE)"));
+    CHECK(!execute("COPY f FROM '" + path + "'"));
+    CHECK(value("SELECT COUNT(*) FROM f") == Value(int64_t(1)));
+    CHECK(execute("COMMIT"));
+    CHECK(value("SELECT s FROM f WHERE id = -1") == Value("kept"));
+    CHECK(value("SELECT COUNT(*) FROM f") == Value(int64_t(1)));
+
+    // A truncated binary file fails the same way
+    std::string binary = g_directory + "/bad.bin";
+    CHECK(execute("COPY a TO '" + binary + "' BINARY"));
+    CHECK(::truncate(binary.c_str(), 1000) == 0);
+    CHECK(!execute("COPY f FROM '" + binary + "' BINARY"));
+    CHECK(value("SELECT COUNT(*) FROM f") == Value(int64_t(1)));
+}
+
+}
+
+int main() {
+    char directory[] = "/tmp/imdb_copyXXXXXX";
+    if (!::mkdtemp(directory)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    g_directory = directory;
+    testRoundTrip();
+    testQuotedFields();
+    testFailedLoad();
+    std::system(("rm -rf " + g_directory).c_str());
+    return report("copy");
+}
@@ -0,0 +1,133 @@
+#include "test_support.h"
+#include "prepared_statement.h"
+
+using namespace InMemoryDB;
+using namespace InMemoryDB::Test;
+
+namespace {
+
+constexpr int kRows = 50000;
+
+void load() {
+    CHECK(execute("CREATE TABLE t (id INT, k INT, s STRING)"));
+    std::string sql = "INSERT INTO t VALUES ";
+    for (int id = 0; id < kRows; ++id) {
+        sql += (id ? ", (" : "(") + std::to_string(id) + ", " + std::to_string(id % 10) + ", 's" +
+               std::to_string(id % 3) + "')";
+    }
+    CHECK(execute(sql));
+    CHECK(execute("CREATE TABLE u (id INT, t INT)"));
+    CHECK(execute("INSERT INTO u VALUES (1, 1), (2, 2), (3, 3)"));
+}
+
+// The operator tree, one label per line, children indented under "-> "
+std::vector<std::string> tree(const std::string& sql) {
+    std::vector<std::string> labels;
+    for (const Row& row : query(sql)) {
+        labels.emplace_back(row[0].asString());
+    }
+    return labels;
+}
+
+using Tree = std::vector<std::string>;
+
+// EXPLAIN shows the operators a query runs, without running it
+void testShape() {
+    Database db;
+    load();
+    CHECK(tree("EXPLAIN SELECT * FROM t") == Tree({"Seq Scan on t"}));
+    CHECK(tree("EXPLAIN SELECT id FROM t LIMIT 5") == Tree({"Limit 5", "-> Seq Scan on t"}));
+    CHECK(tree("EXPLAIN SELECT * FROM t WHERE id > 100 AND s = 's1' ORDER BY k LIMIT 10") ==
+          Tree({"Sort by k, limit 10", "-> Seq Scan on t, filter: id > 100 AND s = 's1'"}));
+    CHECK(tree("EXPLAIN SELECT COUNT(*), MAX(id) FROM t WHERE k = 3") ==
+          Tree({"Aggregate", "-> Seq Scan on t, filter: k = 3"}));
+    CHECK(tree("EXPLAIN SELECT k, COUNT(*) FROM t WHERE id > 100 GROUP BY k ORDER BY k") ==
+          Tree({"Sort by k", "-> Hash Aggregate, group by k", "  -> Seq Scan on t, filter: id > 100"}));
+    CHECK(tree("EXPLAIN SELECT u.id, t.id FROM u JOIN t ON u.t = t.k ORDER BY u.id LIMIT 3") ==
+          Tree({"Sort by u.id, limit 3", "-> Hash Join on u.t = t.k", "  -> Seq Scan on u", "  -> Seq Scan on t"}));
+
+    // An index changes the access path shown
+    CHECK(execute("CREATE INDEX ti ON t (id) USING BTREE"));
+    CHECK(tree("EXPLAIN SELECT * FROM t WHERE id < 10") ==
+          Tree({"B+tree Index Scan on t using ti, cond: id < 10, filter: id < 10"}));
+
+    // Columns: the plan and its estimate, and with ANALYZE what happened
+    QueryResult result = executeSql("EXPLAIN SELECT * FROM t");
+    CHECK(result.success && result.columns.size() == 2 && result.columns[0].name == "plan" &&
+          result.columns[1].name == "estimated_rows");
+    result = executeSql("EXPLAIN ANALYZE SELECT * FROM t");
+    CHECK(result.success && result.columns.size() == 8 && result.columns[2].name == "loops" &&
+          result.columns[3].name == "rows_in" && result.columns[4].name == "rows_out");
+
+    std::string error;
+    CHECK(!execute("EXPLAIN DELETE FROM t", &error));
+    CHECK(error == "EXPLAIN supports SELECT statements only");
+    CHECK(!execute("EXPLAIN ANALYZE INSERT INTO u VALUES (4, 4)", &error));
+    CHECK(query("SELECT * FROM u").size() == 3);
+}
+
+// EXPLAIN ANALYZE runs the query: each operator's rows out are its
+// parent's rows in, and the root's are the rows the query returns
+void testActualRows() {
+    Database db;
+    load();
+    std::vector<std::string> queries = {
+        "SELECT * FROM t WHERE id < 0",
+        "SELECT * FROM t WHERE id > 100 AND s = 's1' ORDER BY k LIMIT 10",
+        "SELECT COUNT(*), MAX(id) FROM t WHERE k = 3",
+        "SELECT k, COUNT(*) FROM t WHERE id > 100 GROUP BY k ORDER BY k",
+        "SELECT s, k FROM t WHERE k < 4 ORDER BY s DESC, k",
+    };
+    for (const std::string& sql : queries) {
+        std::vector<Row> plan = query("EXPLAIN ANALYZE " + sql);
+        CHECK(!plan.empty());
+        if (plan.empty()) continue;
+        CHECK(plan[0][4] == Value(int64_t(query(sql).size())));
+        for (size_t i = 0; i < plan.size(); ++i) {
+            CHECK(plan[i][2].isInt() && plan[i][2].asInt() >= 1);
+            if (i + 1 < plan.size()) {
+                CHECK(plan[i][3] == plan[i + 1][4]);
+            }
+        }
+        CHECK(plan.back()[3] == Value(int64_t(kRows)));
+    }
+
+    // A join reads both sides
+    std::string join = "SELECT u.id, t.id FROM u JOIN t ON u.t = t.k WHERE t.id < 1000";
+    std::vector<Row> plan = query("EXPLAIN ANALYZE " + join);
+    CHECK(plan.size() == 3);
+    if (plan.size() == 3) {
+        CHECK(plan[0][4] == Value(int64_t(query(join).size())));
+        CHECK(plan[0][4] == Value(int64_t(300)));
+        CHECK(plan[0][3].asInt() == plan[1][4].asInt() + plan[2][4].asInt());
+        CHECK(plan[1][4] == Value(int64_t(3)));
+        CHECK(plan[2][4] == Value(int64_t(1000)));
+    }
+
+    // Index lookups from the small side; the big side is never scanned
+    CHECK(execute("CREATE INDEX tk ON t (k)"));
+    plan = query("EXPLAIN ANALYZE SELECT u.id, t.id FROM u JOIN t ON u.t = t.k");
+    CHECK(plan.size() == 3);
+    if (plan.size() == 3) {
+        CHECK(std::string(plan[0][0].asString()) == "Index Nested Loop Join on u.t = t.k, outer: u, index: tk");
+        CHECK(plan[0][4] == Value(int64_t(15000)));
+        CHECK(std::string(plan[2][0].asString()) == "-> Seq Scan on t (never executed)");
+        CHECK(plan[2][2].isNull() && plan[2][4].isNull());
+    }
+
+    // With statistics, the estimates come close to the actual rows
+    CHECK(execute("ANALYZE t"));
+    plan = query("EXPLAIN ANALYZE SELECT * FROM t WHERE k = 3");
+    CHECK(!plan.empty() && plan[0][1].isNumber() && plan[0][4] == Value(int64_t(5000)));
+    if (!plan.empty() && plan[0][1].isNumber()) {
+        CHECK(plan[0][1].asDouble() > 4000 && plan[0][1].asDouble() < 6000);
+    }
+}
+
+}
+
+int main() {
+    testShape();
+    testActualRows();
+    return report("explain");
+}
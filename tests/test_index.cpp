@@ -0,0 +1,104 @@
+#include "test_support.h"
+#include "index.h"
+#include <algorithm>
+#include <random>
+
+using namespace InMemoryDB;
+using namespace InMemoryDB::Test;
+
+namespace {
+
+// Row ids a B+tree range must return: every entry within the bounds, in
+// (key, row id) order
+std::vector<int> expectedRange(const std::vector<std::pair<int, int>>& entries, const KeyBound& low,
+                               const KeyBound& high) {
+    std::vector<int> rows;
+    for (const auto& [key, row] : entries) {
+        if (low.value && (low.inclusive ? key < low.value->asInt() : key <= low.value->asInt())) continue;
+        if (high.value && (high.inclusive ? key > high.value->asInt() : key >= high.value->asInt())) continue;
+        rows.push_back(row);
+    }
+    return rows;
+}
+
+// Enough duplicate keys to split leaves and inner nodes, then removals,
+// checked against every kind of bound
+void testRangeBounds() {
+    std::unique_ptr<Index> index = createTreeIndex(DataType::INTEGER);
+    std::mt19937 random(42);
+    std::vector<std::pair<int, int>> entries;
+    for (int row = 0; row < 20000; ++row) {
+        int key = static_cast<int>(random() % 5000) - 2500;
+        index->insert(Value(key), row);
+        entries.emplace_back(key, row);
+    }
+    for (int row = 0; row < 20000; row += 3) {
+        index->remove(Value(entries[row].first), row);
+    }
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [](const std::pair<int, int>& entry) { return entry.second % 3 == 0; }),
+                  entries.end());
+    std::sort(entries.begin(), entries.end());
+
+    std::vector<int> edges = {-3000, -2500, -1, 0, 1, 1234, 2499, 2500};
+    for (int i = 0; i < 200; ++i) {
+        edges.push_back(static_cast<int>(random() % 6000) - 3000);
+    }
+    for (size_t i = 0; i + 1 < edges.size(); ++i) {
+        Value a(std::min(edges[i], edges[i + 1]));
+        Value b(std::max(edges[i], edges[i + 1]));
+        for (int shape = 0; shape < 6; ++shape) {
+            KeyBound low{shape == 4 ? nullptr : &a, shape % 2 == 0};
+            KeyBound high{shape == 5 ? nullptr : &b, shape / 2 % 2 == 0};
+            std::vector<int> rows;
+            CHECK(index->findRangeInto(low, high, rows));
+            CHECK(rows == expectedRange(entries, low, high));
+        }
+    }
+
+    // Equality is a range with both bounds inclusive
+    std::vector<int> rows;
+    index->findInto(Value(entries[100].first), rows);
+    Value key(entries[100].first);
+    CHECK(rows == expectedRange(entries, {&key, true}, {&key, true}));
+}
+
+// A bound of the wrong type cannot be served
+void testMismatchedBound() {
+    std::unique_ptr<Index> index = createTreeIndex(DataType::INTEGER);
+    index->insert(Value(1), 0);
+    Value text("1");
+    std::vector<int> rows;
+    CHECK(!index->findRangeInto({&text, true}, {nullptr, true}, rows));
+}
+
+// Range queries through SQL return the same rows with and without the index
+void testRangeQueries() {
+    Database db;
+    CHECK(execute("CREATE TABLE r (id INT, k INT)"));
+    std::string sql = "INSERT INTO r VALUES ";
+    for (int id = 0; id < 5000; ++id) {
+        sql += (id ? ", (" : "(") + std::to_string(id) + ", " + (id % 11 ? std::to_string(id % 97) : "NULL") + ")";
+    }
+    CHECK(execute(sql));
+
+    std::vector<std::string> wheres = {"k > 10 AND k < 20", "k >= 10 AND k <= 20", "k BETWEEN 0 AND 5", "k < 3",
+                                       "k >= 96", "k = 50", "k > 40 AND k > 45 AND k < 60", "k > 90 OR k < 2"};
+    std::vector<size_t> counts;
+    for (const std::string& where : wheres) {
+        counts.push_back(query("SELECT id FROM r WHERE " + where).size());
+    }
+    CHECK(execute("CREATE INDEX rk ON r (k) USING BTREE"));
+    for (size_t i = 0; i < wheres.size(); ++i) {
+        CHECK(query("SELECT id FROM r WHERE " + wheres[i]).size() == counts[i]);
+    }
+}
+
+}
+
+int main() {
+    testRangeBounds();
+    testMismatchedBound();
+    testRangeQueries();
+    return report("index");
+}
@@ -0,0 +1,131 @@
+#include "test_support.h"
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <utility>
+
+using namespace InMemoryDB;
+using namespace InMemoryDB::Test;
+
+namespace {
+
+// l is small enough, against r, for its rows to drive index lookups into
+// r once r.k has an index. Both have NULL keys, and some keys of l have
+// no match in r.
+constexpr int kLeftRows = 200;
+constexpr int kRightRows = 20000;
+
+std::optional<int> leftKey(int id) {
+    return id % 10 == 0 ? std::optional<int>() : std::optional<int>(id * 3 % 400);
+}
+
+std::optional<int> rightKey(int id) {
+    return id % 7 == 0 ? std::optional<int>() : std::optional<int>(id % 300);
+}
+
+using Pairs = std::vector<std::pair<int, int>>;  // (l.id, r.id), -1 for no r row
+
+void load() {
+    CHECK(execute("CREATE TABLE l (id INT, k INT)"));
+    CHECK(execute("CREATE TABLE r (id INT, k INT, s STRING)"));
+    std::string sql = "INSERT INTO l VALUES ";
+    for (int id = 0; id < kLeftRows; ++id) {
+        std::string k = leftKey(id) ? std::to_string(*leftKey(id)) : "NULL";
+        sql += (id ? ", (" : "(") + std::to_string(id) + ", " + k + ")";
+    }
+    CHECK(execute(sql));
+    sql = "INSERT INTO r VALUES ";
+    for (int id = 0; id < kRightRows; ++id) {
+        std::string k = rightKey(id) ? std::to_string(*rightKey(id)) : "NULL";
+        sql += (id ? ", (" : "(") + std::to_string(id) + ", " + k + ", 'r" + std::to_string(id) + "')";
+    }
+    CHECK(execute(sql));
+}
+
+// The join computed here: NULL keys equal nothing, not even each other
+Pairs expected(bool left, const std::function<bool(int, int)>& where = nullptr) {
+    Pairs pairs;
+    for (int x = 0; x < kLeftRows; ++x) {
+        bool matched = false;
+        for (int y = 0; y < kRightRows; ++y) {
+            if (leftKey(x) && rightKey(y) && *leftKey(x) == *rightKey(y)) {
+                matched = true;
+                if (!where || where(x, y)) pairs.emplace_back(x, y);
+            }
+        }
+        if (left && !matched && (!where || where(x, -1))) pairs.emplace_back(x, -1);
+    }
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+Pairs pairs(const std::string& sql) {
+    Pairs result;
+    for (const Row& row : query(sql)) {
+        result.emplace_back(static_cast<int>(row[0].asInt()), row[1].isNull() ? -1 : static_cast<int>(row[1].asInt()));
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+std::string plan(const std::string& sql) {
+    std::vector<Row> rows = query("EXPLAIN ANALYZE " + sql);
+    return rows.empty() ? "" : std::string(rows[0][0].asString());
+}
+
+// Each query, run the way the plan says, against the join taken here
+void checkJoins(const std::string& strategy) {
+    std::string inner = "SELECT l.id, r.id FROM l JOIN r ON l.k = r.k";
+    CHECK(plan(inner).find(strategy + " Join on l.k = r.k") == 0);
+    CHECK(pairs(inner) == expected(false));
+    CHECK(pairs("SELECT x.id, y.id FROM l x INNER JOIN r y ON x.k = y.k") == expected(false));
+
+    std::string left = "SELECT l.id, r.id FROM l LEFT JOIN r ON l.k = r.k";
+    CHECK(plan(left).find(strategy + " Left Join on l.k = r.k") == 0);
+    CHECK(pairs(left) == expected(true));
+    CHECK(pairs("SELECT l.id, r.id FROM l LEFT OUTER JOIN r ON l.k = r.k WHERE l.id < 50") ==
+          expected(true, [](int x, int) { return x < 50; }));
+
+    // A WHERE on the right table is applied after the join, so it drops
+    // the rows a LEFT join padded with NULLs, as well as failing matches
+    CHECK(pairs("SELECT l.id, r.id FROM l LEFT JOIN r ON l.k = r.k WHERE r.id < 1000") ==
+          expected(true, [](int, int y) { return y >= 0 && y < 1000; }));
+    CHECK(pairs("SELECT l.id, r.id FROM l LEFT JOIN r ON l.k = r.k WHERE r.s = 'r301'") ==
+          expected(true, [](int, int y) { return y == 301; }));
+    CHECK(pairs("SELECT l.id, r.id FROM l LEFT JOIN r ON l.k = r.k WHERE l.id > 100 AND r.id < 5000") ==
+          expected(true, [](int x, int y) { return x > 100 && y >= 0 && y < 5000; }));
+}
+
+// The radix hash join and index nested loops give the same rows
+void testStrategies() {
+    Database db;
+    load();
+    Pairs hashed = pairs("SELECT l.id, r.id FROM l LEFT JOIN r ON l.k = r.k");
+    checkJoins("Hash");
+    CHECK(execute("CREATE INDEX rk ON r (k)"));
+    checkJoins("Index Nested Loop");
+    CHECK(pairs("SELECT l.id, r.id FROM l LEFT JOIN r ON l.k = r.k") == hashed);
+}
+
+// NULL keys on both sides: an inner join drops them, a LEFT join keeps
+// the left one unmatched
+void testNullKeys() {
+    Database db;
+    CHECK(execute("CREATE TABLE a (id INT, k INT)"));
+    CHECK(execute("CREATE TABLE b (id INT, k INT)"));
+    CHECK(execute("INSERT INTO a VALUES (1, NULL), (2, 5), (3, NULL)"));
+    CHECK(execute("INSERT INTO b VALUES (10, NULL), (20, 5), (30, NULL)"));
+    CHECK(pairs("SELECT a.id, b.id FROM a JOIN b ON a.k = b.k") == Pairs({{2, 20}}));
+    CHECK(pairs("SELECT a.id, b.id FROM a LEFT JOIN b ON a.k = b.k") == Pairs({{1, -1}, {2, 20}, {3, -1}}));
+    CHECK(execute("CREATE INDEX bk ON b (k)"));
+    CHECK(pairs("SELECT a.id, b.id FROM a JOIN b ON a.k = b.k") == Pairs({{2, 20}}));
+    CHECK(pairs("SELECT a.id, b.id FROM a LEFT JOIN b ON a.k = b.k") == Pairs({{1, -1}, {2, 20}, {3, -1}}));
+}
+
+}
+
+int main() {
+    testStrategies();
+    testNullKeys();
+    return report("join");
+}
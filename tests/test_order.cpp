@@ -0,0 +1,114 @@
+#include "test_support.h"
+#include <algorithm>
+#include <functional>
+#include <optional>
+
+using namespace InMemoryDB;
+using namespace InMemoryDB::Test;
+
+namespace {
+
+// Rows of o, enough for several scan batches and a parallel sort; k and s
+// have many duplicates and some NULLs
+constexpr int kRows = 50000;
+
+std::optional<int> kOf(int id) {
+    return id % 13 == 0 ? std::optional<int>() : std::optional<int>(id * 7919 % 1000 - 500);
+}
+
+std::optional<std::string> sOf(int id) {
+    return id % 17 == 0 ? std::optional<std::string>() : std::optional<std::string>("s" + std::to_string(id * 31 % 97));
+}
+
+// Orders two optional keys the way ORDER BY does: NULLs last ascending,
+// and so first descending. Returns <0, 0 or >0.
+template <typename T>
+int compareKeys(const std::optional<T>& x, const std::optional<T>& y, bool descending) {
+    int order = !x && !y ? 0 : !x ? 1 : !y ? -1 : *x < *y ? -1 : *y < *x ? 1 : 0;
+    return descending ? -order : order;
+}
+
+// Ids of the rows with where, sorted by less and cut to limit
+std::vector<int> expected(const std::function<bool(int, int)>& less, size_t limit,
+                          const std::function<bool(int)>& where = nullptr) {
+    std::vector<int> ids;
+    for (int id = 0; id < kRows; ++id) {
+        if (!where || where(id)) ids.push_back(id);
+    }
+    std::sort(ids.begin(), ids.end(), less);
+    ids.resize(std::min(ids.size(), limit));
+    return ids;
+}
+
+std::vector<int> ids(const std::string& sql) {
+    std::vector<int> result;
+    for (const Row& row : query(sql)) {
+        result.push_back(static_cast<int>(row[0].asInt()));
+    }
+    return result;
+}
+
+void load() {
+    CHECK(execute("CREATE TABLE o (id INT, k INT, s STRING)"));
+    std::string sql = "INSERT INTO o VALUES ";
+    for (int id = 0; id < kRows; ++id) {
+        std::string k = kOf(id) ? std::to_string(*kOf(id)) : "NULL";
+        std::string s = sOf(id) ? "'" + *sOf(id) + "'" : "NULL";
+        sql += (id ? ", (" : "(") + std::to_string(id) + ", " + k + ", " + s + ")";
+    }
+    CHECK(execute(sql));
+}
+
+// Small limits are served by top-k heaps, large ones by a full sort; both
+// must agree with sorting everything and cutting it short
+void testLimits() {
+    auto by_k = [](int x, int y) {
+        int order = compareKeys(kOf(x), kOf(y), false);
+        return order ? order < 0 : x < y;
+    };
+    for (size_t limit : {size_t(0), size_t(1), size_t(10), size_t(1000), size_t(12500), size_t(20000)}) {
+        CHECK(ids("SELECT * FROM o ORDER BY k, id LIMIT " + std::to_string(limit)) == expected(by_k, limit));
+    }
+    CHECK(ids("SELECT * FROM o ORDER BY k, id") == expected(by_k, kRows));
+    CHECK(ids("SELECT * FROM o ORDER BY k ASC, id ASC LIMIT 100000") == expected(by_k, kRows));
+
+    // Descending puts NULLs first
+    auto by_k_desc = [](int x, int y) {
+        int order = compareKeys(kOf(x), kOf(y), true);
+        return order ? order < 0 : x < y;
+    };
+    CHECK(ids("SELECT * FROM o ORDER BY k DESC, id LIMIT 100") == expected(by_k_desc, 100));
+    CHECK(ids("SELECT * FROM o ORDER BY k DESC, id LIMIT 30000") == expected(by_k_desc, 30000));
+}
+
+// Strings compare bytewise, a prefix first; mixed directions and a filter
+void testKeys() {
+    auto by_s = [](int x, int y) {
+        int order = compareKeys(sOf(x), sOf(y), false);
+        return order ? order < 0 : x > y;
+    };
+    CHECK(ids("SELECT * FROM o ORDER BY s, id DESC LIMIT 50") == expected(by_s, 50));
+    CHECK(ids("SELECT * FROM o ORDER BY s, id DESC LIMIT 40000") == expected(by_s, 40000));
+
+    auto by_s_k = [](int x, int y) {
+        int order = compareKeys(sOf(x), sOf(y), true);
+        if (!order) order = compareKeys(kOf(x), kOf(y), false);
+        return order ? order < 0 : x < y;
+    };
+    auto positive = [](int id) { return kOf(id) && *kOf(id) > 0; };
+    CHECK(ids("SELECT * FROM o WHERE k > 0 ORDER BY s DESC, k, id LIMIT 25") == expected(by_s_k, 25, positive));
+
+    // LIMIT alone keeps that many rows, whichever they are
+    CHECK(query("SELECT * FROM o LIMIT 7").size() == 7);
+    CHECK(query("SELECT * FROM o WHERE k > 0 LIMIT 100000").size() == expected(by_s_k, kRows, positive).size());
+}
+
+}
+
+int main() {
+    Database db;
+    load();
+    testLimits();
+    testKeys();
+    return report("order");
+}
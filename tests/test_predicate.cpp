@@ -0,0 +1,140 @@
+#include "test_support.h"
+#include <functional>
+#include <optional>
+
+using namespace InMemoryDB;
+using namespace InMemoryDB::Test;
+
+namespace {
+
+// Three-valued truth: empty is unknown
+using Truth = std::optional<bool>;
+
+Truth notOf(Truth x) {
+    return x ? Truth(!*x) : Truth();
+}
+
+Truth andOf(Truth x, Truth y) {
+    if ((x && !*x) || (y && !*y)) return false;
+    if (!x || !y) return Truth();
+    return true;
+}
+
+Truth orOf(Truth x, Truth y) {
+    if ((x && *x) || (y && *y)) return true;
+    if (!x || !y) return Truth();
+    return false;
+}
+
+// Rows of t, which spans several batches; a is NULL on every fifth row
+// and s on every third
+constexpr int kRows = 3000;
+
+std::optional<int> aOf(int id) {
+    return id % 5 == 0 ? std::optional<int>() : std::optional<int>(id % 7);
+}
+
+std::optional<std::string> sOf(int id) {
+    return id % 3 == 0 ? std::optional<std::string>() : std::optional<std::string>(id % 2 ? "x" : "y");
+}
+
+Truth aGreater(int id, int k) {
+    return aOf(id) ? Truth(*aOf(id) > k) : Truth();
+}
+
+Truth aEquals(int id, int k) {
+    return aOf(id) ? Truth(*aOf(id) == k) : Truth();
+}
+
+Truth sEquals(int id, const std::string& k) {
+    return sOf(id) ? Truth(*sOf(id) == k) : Truth();
+}
+
+size_t expected(const std::function<Truth(int)>& where) {
+    size_t count = 0;
+    for (int id = 0; id < kRows; ++id) {
+        Truth t = where(id);
+        count += t && *t;
+    }
+    return count;
+}
+
+size_t rows(const std::string& where) {
+    return query("SELECT id FROM t WHERE " + where).size();
+}
+
+void load() {
+    CHECK(execute("CREATE TABLE t (id INT, a INT, s STRING)"));
+    std::string sql = "INSERT INTO t VALUES ";
+    for (int id = 0; id < kRows; ++id) {
+        std::string a = aOf(id) ? std::to_string(*aOf(id)) : "NULL";
+        std::string s = sOf(id) ? "'" + *sOf(id) + "'" : "NULL";
+        sql += (id ? ", (" : "(") + std::to_string(id) + ", " + a + ", " + s + ")";
+    }
+    CHECK(execute(sql));
+}
+
+// A comparison with NULL is unknown, and NOT, AND and OR follow SQL's
+// three-valued logic, so NOT of an unknown row still filters it out
+void testNullLogic() {
+    CHECK(rows("a > 3") == expected([](int id) { return aGreater(id, 3); }));
+    CHECK(rows("NOT a > 3") == expected([](int id) { return notOf(aGreater(id, 3)); }));
+    CHECK(rows("a <> 1") == expected([](int id) { return notOf(aEquals(id, 1)); }));
+    CHECK(rows("a > 3 OR s = 'x'") ==
+          expected([](int id) { return orOf(aGreater(id, 3), sEquals(id, "x")); }));
+    CHECK(rows("NOT (a > 3 OR s = 'x')") ==
+          expected([](int id) { return notOf(orOf(aGreater(id, 3), sEquals(id, "x"))); }));
+    CHECK(rows("a > 3 AND NOT s = 'y'") ==
+          expected([](int id) { return andOf(aGreater(id, 3), notOf(sEquals(id, "y"))); }));
+    CHECK(rows("NOT (a > 3 AND s = 'y')") ==
+          expected([](int id) { return notOf(andOf(aGreater(id, 3), sEquals(id, "y"))); }));
+    CHECK(rows("a BETWEEN 2 AND 4") ==
+          expected([](int id) { return andOf(aGreater(id, 1), notOf(aGreater(id, 4))); }));
+    CHECK(rows("a NOT BETWEEN 2 AND 4") ==
+          expected([](int id) { return notOf(andOf(aGreater(id, 1), notOf(aGreater(id, 4)))); }));
+}
+
+// A bare word where a value belongs is a column name, not a string
+void testIdentifierIsNotLiteral() {
+    std::string error;
+    CHECK(!execute("SELECT id FROM t WHERE a = s", &error));
+    CHECK(error.find("Cannot compare column 'a' with column 's'") != std::string::npos);
+    CHECK(!execute("SELECT id FROM t WHERE s = x"));
+    CHECK(!execute("INSERT INTO t VALUES (1, 2, x)"));
+    CHECK(rows("s = 'x'") == expected([](int id) { return sEquals(id, "x"); }));
+}
+
+// Tokens left after a statement are an error, so a misspelled WHERE
+// cannot widen a write to the whole table
+void testTrailingTokens() {
+    std::string error;
+    CHECK(!execute("DELETE FROM t WERE id = 1", &error));
+    CHECK(error == "Unexpected token 'WERE'");
+    CHECK(!execute("UPDATE t SET a = 9 WERE id = 1", &error));
+    CHECK(error == "Unexpected token 'WERE'");
+    CHECK(rows("id >= 0") == kRows);
+    CHECK(rows("a = 9") == 0);
+
+    CHECK(!execute("SELECT * FROM t LIMIT 1 OFFSET 2", &error));
+    CHECK(error == "Unexpected token 'OFFSET'");
+    CHECK(!execute("INSERT INTO t VALUES (1, 2, 'x') junk", &error));
+    CHECK(!execute("SELECT * FROM t WERE id = 1"));
+    CHECK(!execute("DROP TABLE t t"));
+    CHECK(!execute("SELECT * FROM t;;"));
+    CHECK(rows("id >= 0") == kRows);
+
+    // One semicolon may end a statement
+    CHECK(execute("SELECT * FROM t WHERE id = 1;"));
+    CHECK(execute("UPDATE t SET a = 9 WHERE id = -1 ;"));
+}
+
+}
+
+int main() {
+    Database db;
+    load();
+    testNullLogic();
+    testIdentifierIsNotLiteral();
+    testTrailingTokens();
+    return report("predicate");
+}
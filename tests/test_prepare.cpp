@@ -0,0 +1,142 @@
+#include "test_support.h"
+#include "prepared_statement.h"
+
+using namespace InMemoryDB;
+using namespace InMemoryDB::Test;
+
+namespace {
+
+Value value(const std::string& sql) {
+    std::vector<Row> rows = query(sql);
+    return rows.size() == 1 && rows[0].size() == 1 ? rows[0][0] : Value("no single value");
+}
+
+void setUp() {
+    CHECK(execute("CREATE TABLE t (id INT, v INT, s STRING)"));
+    CHECK(execute("INSERT INTO t VALUES (1, 10, 'one'), (2, 20, 'two'), (3, -30, 'three')"));
+}
+
+// The plan the cache holds for sql, prepared now if it was not there
+std::shared_ptr<const PreparedStatement> cached(const std::string& sql) {
+    Row literals;
+    std::string error;
+    return PlanCache::instance().get(sql, literals, error);
+}
+
+// EXECUTE binds exactly as many values as the statement has placeholders
+void testParameters() {
+    Database db;
+    setUp();
+    CHECK(execute("PREPARE q AS SELECT s FROM t WHERE id = $1 AND v > $2"));
+    CHECK(value("EXECUTE q (2, 0)") == Value("two"));
+    CHECK(query("EXECUTE q (2, 25)").empty());
+
+    std::string error;
+    CHECK(!execute("EXECUTE q (1)", &error));
+    CHECK(error == "Statement expects 2 parameter(s), got 1");
+    CHECK(!execute("EXECUTE q (1, 2, 3)", &error));
+    CHECK(error == "Statement expects 2 parameter(s), got 3");
+    CHECK(!execute("EXECUTE q", &error));
+    CHECK(error == "Statement expects 2 parameter(s), got 0");
+    CHECK(!execute("EXECUTE missing (1)", &error));
+    CHECK(error == "Prepared statement 'missing' does not exist");
+
+    // -$n negates a bound number
+    CHECK(execute("PREPARE n AS SELECT id FROM t WHERE v < -$1"));
+    CHECK(value("EXECUTE n (20)") == Value(int64_t(3)));
+    CHECK(!execute("EXECUTE n ('x')"));
+
+    CHECK(execute("PREPARE w AS UPDATE t SET s = $2 WHERE id = $1"));
+    CHECK(execute("EXECUTE w (1, 'uno')"));
+    CHECK(value("SELECT s FROM t WHERE id = 1") == Value("uno"));
+    CHECK(execute("DEALLOCATE ALL"));
+    CHECK(!execute("EXECUTE w (1, 'one')"));
+}
+
+// Ad-hoc statements differing only in their literals share one plan,
+// each run with its own values
+void testSharedPlans() {
+    Database db;
+    setUp();
+    CHECK(execute("SET PLAN_CACHE_SIZE = 256"));
+    CHECK(value("SELECT s FROM t WHERE id = 1") == Value("one"));
+    size_t size = PlanCache::instance().size();
+    auto plan = cached("SELECT s FROM t WHERE id = 1");
+    CHECK(value("SELECT s FROM t WHERE id = 2") == Value("two"));
+    CHECK(value("SELECT  s FROM t WHERE id =  3") == Value("three"));
+    CHECK(cached("SELECT s FROM t WHERE id = 9") == plan);
+    CHECK(PlanCache::instance().size() == size);
+
+    // Negative numbers and strings are literals too
+    CHECK(value("SELECT id FROM t WHERE v < -25") == Value(int64_t(3)));
+    CHECK(value("SELECT id FROM t WHERE v < -5 AND s = 'three'") == Value(int64_t(3)));
+    CHECK(cached("SELECT id FROM t WHERE v < -5") == cached("SELECT id FROM t WHERE v < -25"));
+    CHECK(query("SELECT id FROM t WHERE v > 15 LIMIT 5").size() == 1);
+    CHECK(query("SELECT id FROM t WHERE v > 5 LIMIT 1").size() == 1);
+    CHECK(cached("SELECT id FROM t WHERE v > 15 LIMIT 5") == cached("SELECT id FROM t WHERE v > 5 LIMIT 1"));
+    CHECK(execute("INSERT INTO t VALUES (4, 40, 'four')"));
+    CHECK(execute("INSERT INTO t VALUES (5, 50, 'five')"));
+    CHECK(value("SELECT s FROM t WHERE id = 5") == Value("five"));
+    CHECK(cached("INSERT INTO t VALUES (4, 40, 'four')") == cached("INSERT INTO t VALUES (6, 0, '')"));
+
+    // Names with digits in them, and a different shape, are not literals
+    CHECK(cached("SELECT s FROM t WHERE id > 1") != plan);
+    CHECK(execute("CREATE TABLE t2 (id INT)"));
+    CHECK(execute("CREATE TABLE t3 (id INT)"));
+    CHECK(execute("INSERT INTO t2 VALUES (1)"));
+    CHECK(query("SELECT * FROM t3").empty());
+    CHECK(cached("SELECT * FROM t2") != cached("SELECT * FROM t3"));
+}
+
+// A full cache drops its least recently used plan
+void testEviction() {
+    Database db;
+    setUp();
+    CHECK(execute("SET PLAN_CACHE_SIZE = 3"));
+    CHECK(PlanCache::instance().size() <= 3);
+    auto a = cached("SELECT s FROM t WHERE id = 1");
+    auto b = cached("SELECT s FROM t WHERE v = 1");
+    auto c = cached("SELECT id FROM t WHERE s = 'x'");
+    CHECK(PlanCache::instance().size() == 3);
+    CHECK(cached("SELECT s FROM t WHERE id = 2") == a);  // a becomes the most recent
+    CHECK(value("SELECT s FROM t WHERE id < 2") == Value("one"));
+    CHECK(PlanCache::instance().size() == 3);
+    CHECK(cached("SELECT s FROM t WHERE id = 3") == a);
+    CHECK(cached("SELECT s FROM t WHERE v = 1") != b);
+
+    // Caching can be turned off, and statements still run
+    CHECK(execute("SET PLAN_CACHE_SIZE = 0"));
+    CHECK(PlanCache::instance().size() == 0);
+    CHECK(value("SELECT s FROM t WHERE id = 2") == Value("two"));
+    CHECK(PlanCache::instance().size() == 0);
+    CHECK(execute("SET PLAN_CACHE_SIZE = 256"));
+}
+
+// A plan is tokens, resolved against the catalog when it runs, so it
+// follows its table through DROP and re-CREATE
+void testRecreatedTable() {
+    Database db;
+    setUp();
+    CHECK(execute("PREPARE q AS SELECT s FROM t WHERE id = $1"));
+    CHECK(value("EXECUTE q (1)") == Value("one"));
+    CHECK(value("SELECT s FROM t WHERE id = 1") == Value("one"));
+
+    CHECK(execute("DROP TABLE t"));
+    CHECK(!execute("EXECUTE q (1)"));
+    CHECK(!execute("SELECT s FROM t WHERE id = 1"));
+
+    CHECK(execute("CREATE TABLE t (s STRING, id INT)"));
+    CHECK(execute("INSERT INTO t VALUES ('new', 1)"));
+    CHECK(value("EXECUTE q (1)") == Value("new"));
+    CHECK(value("SELECT s FROM t WHERE id = 1") == Value("new"));
+}
+
+}
+
+int main() {
+    testParameters();
+    testSharedPlans();
+    testEviction();
+    testRecreatedTable();
+    return report("prepare");
+}
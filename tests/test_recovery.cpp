@@ -0,0 +1,250 @@
+#include "test_support.h"
+#include "globals.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace InMemoryDB;
+using namespace InMemoryDB::Test;
+
+namespace {
+
+std::string g_directory;
+
+off_t fileSize(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+// A log in a fresh directory, with no snapshot next to it
+std::string logPath(const std::string& name) {
+    std::string path = g_directory + "/" + name;
+    std::remove(path.c_str());
+    std::remove((path + ".snapshot").c_str());
+    return path;
+}
+
+bool openLog(Database& db, const std::string& path) {
+    std::string error;
+    bool ok = db.engine().openLog(path, Durability::SYNC, error);
+    if (!ok) {
+        std::cerr << path << ": " << error << std::endl;
+    }
+    return ok;
+}
+
+Value value(const std::string& sql) {
+    std::vector<Row> rows = query(sql);
+    return rows.size() == 1 && rows[0].size() == 1 ? rows[0][0] : Value("no single value");
+}
+
+// The state writes() leaves behind
+void checkWrites() {
+    CHECK(value("SELECT COUNT(*) FROM w") == Value(int64_t(999)));
+    CHECK(value("SELECT s FROM w WHERE id = 7") == Value("updated"));
+    CHECK(value("SELECT d FROM w WHERE id = 8") == Value(0.5));
+    CHECK(value("SELECT COUNT(*) FROM w WHERE id = 9") == Value(int64_t(0)));
+    CHECK(value("SELECT COUNT(*) FROM w WHERE s >= ''") == Value(int64_t(899)));
+    CHECK(value("SELECT COUNT(*) FROM w WHERE s = 'rolled back'") == Value(int64_t(0)));
+    CHECK(value("SELECT COUNT(*) FROM w WHERE id >= 1000") == Value(int64_t(0)));
+    CHECK(g_storage_engine->getTable("w")->hasIndex("id"));
+    CHECK(!g_storage_engine->getTable("w")->hasIndex("d"));
+    CHECK(!g_storage_engine->getTable("dropped"));
+}
+
+// DDL, inserts, updates and deletes, some of them rolled back or undone
+void writes() {
+    CHECK(execute("CREATE TABLE w (id INT, s STRING, d DOUBLE)"));
+    CHECK(execute("CREATE TABLE dropped (id INT)"));
+    CHECK(execute("CREATE INDEX wi ON w (id) USING BTREE"));
+    CHECK(execute("CREATE INDEX wd ON w (d)"));
+    std::string sql = "INSERT INTO w VALUES ";
+    for (int id = 0; id < 1000; ++id) {
+        std::string s = id % 10 ? "'row " + std::to_string(id) + "'" : "NULL";
+        sql += (id ? ", (" : "(") + std::to_string(id) + ", " + s + ", " + std::to_string(id) + ".25)";
+    }
+    CHECK(execute(sql));
+
+    CHECK(execute("BEGIN"));
+    CHECK(execute("INSERT INTO w VALUES (1000, 'rolled back', 0)"));
+    CHECK(execute("UPDATE w SET s = 'rolled back' WHERE id < 500"));
+    CHECK(execute("DELETE FROM w WHERE id >= 500"));
+    CHECK(execute("ROLLBACK"));
+
+    CHECK(execute("UPDATE w SET s = 'updated' WHERE id = 7"));
+    CHECK(execute("UPDATE w SET d = 0.5 WHERE id = 8"));
+    CHECK(execute("DELETE FROM w WHERE id = 9"));
+    CHECK(execute("DROP INDEX wd"));
+    CHECK(execute("DROP TABLE dropped"));
+}
+
+// Every committed write, and none of the rolled-back ones, comes back
+// from the log
+void testReplay() {
+    std::string path = logPath("replay.wal");
+    {
+        Database db;
+        CHECK(openLog(db, path));
+        writes();
+    }
+    {
+        Database db;
+        CHECK(openLog(db, path));
+        checkWrites();
+
+        // Writes after replay go to the same log
+        CHECK(execute("INSERT INTO w VALUES (2000, 'after', 1)"));
+    }
+    Database db;
+    CHECK(openLog(db, path));
+    CHECK(value("SELECT s FROM w WHERE id = 2000") == Value("after"));
+    CHECK(value("SELECT COUNT(*) FROM w") == Value(int64_t(1000)));
+}
+
+// A record torn by a crash mid-write ends the log; the records before it
+// replay and later appends follow them. A length of 0xFFFFFFFF, with the
+// checksum of nothing, must not wrap the bounds check.
+void testTornRecord() {
+    const std::string tails[] = {std::string("\x40\x00\x00\x00\x12\x34\x56\x78\x05" "abc", 12),
+                                 std::string("\xff\xff\xff\xff\x00\x00\x00\x00\x05" "abc", 12)};
+    for (const std::string& tail : tails) {
+        std::string path = logPath("torn.wal");
+        {
+            Database db;
+            CHECK(openLog(db, path));
+            writes();
+        }
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::app);
+            out << tail;
+        }
+        {
+            Database db;
+            CHECK(openLog(db, path));
+            checkWrites();
+            CHECK(execute("INSERT INTO w VALUES (2000, 'after', 1)"));
+        }
+        Database db;
+        CHECK(openLog(db, path));
+        CHECK(value("SELECT s FROM w WHERE id = 2000") == Value("after"));
+    }
+}
+
+// A checkpoint replaces the log records it covers; recovery loads it and
+// replays only the writes that came after
+void testCheckpoint() {
+    std::string path = logPath("checkpoint.wal");
+    {
+        Database db;
+        CHECK(openLog(db, path));
+        writes();
+        off_t logged = fileSize(path);
+        CHECK(execute("CHECKPOINT"));
+        CHECK(fileSize(path) < logged);
+        CHECK(fileSize(path + ".snapshot") > 0);
+        CHECK(execute("INSERT INTO w VALUES (2000, 'after', 1)"));
+        CHECK(execute("DELETE FROM w WHERE id = 1"));
+    }
+    {
+        Database db;
+        CHECK(openLog(db, path));
+        CHECK(value("SELECT COUNT(*) FROM w") == Value(int64_t(999)));
+        CHECK(value("SELECT s FROM w WHERE id = 2000") == Value("after"));
+        CHECK(value("SELECT COUNT(*) FROM w WHERE id = 1") == Value(int64_t(0)));
+        CHECK(execute("INSERT INTO w VALUES (1, 'restored', 1)"));
+
+        // A second checkpoint covers the replayed writes too
+        CHECK(execute("CHECKPOINT"));
+        CHECK(execute("UPDATE w SET s = 'updated' WHERE id = 1"));
+        CHECK(execute("DELETE FROM w WHERE id = 2000"));
+    }
+    Database db;
+    CHECK(openLog(db, path));
+    checkWrites();
+}
+
+// A checkpoint whose snapshot cannot be written fails, and keeps the log
+// and the previous snapshot that recovery still needs
+void testFailedCheckpoint() {
+    std::string path = logPath("full.wal");
+    {
+        Database db;
+        CHECK(openLog(db, path));
+        CHECK(execute("CREATE TABLE p (id INT)"));
+        CHECK(execute("INSERT INTO p VALUES (1), (2)"));
+        CHECK(execute("CHECKPOINT"));
+        writes();
+        off_t logged = fileSize(path);
+        off_t snapshot = fileSize(path + ".snapshot");
+
+        // The snapshot is written to <log>.snapshot.tmp; make that a full disk
+        std::string temp_path = path + ".snapshot.tmp";
+        CHECK(::symlink("/dev/full", temp_path.c_str()) == 0);
+        std::string error;
+        CHECK(!execute("CHECKPOINT", &error));
+        CHECK(error.find("Cannot write snapshot") != std::string::npos);
+        CHECK(fileSize(path) == logged);
+        CHECK(fileSize(path + ".snapshot") == snapshot);
+        std::remove(temp_path.c_str());
+    }
+    Database db;
+    CHECK(openLog(db, path));
+    CHECK(value("SELECT COUNT(*) FROM p") == Value(int64_t(2)));
+    checkWrites();
+}
+
+// A snapshot of several storage blocks of every column type, NULLs
+// included, loads back row for row
+void testSnapshotColumns() {
+    std::string path = logPath("columns.wal");
+    std::vector<std::string> queries = {"SELECT * FROM c ORDER BY id", "SELECT id FROM c WHERE k BETWEEN 100 AND 120",
+                                        "SELECT id FROM c WHERE s = 'v7'", "SELECT id FROM c WHERE d > 30000",
+                                        "SELECT COUNT(*) FROM c WHERE b = TRUE"};
+    std::vector<std::vector<Row>> expected;
+    {
+        Database db;
+        CHECK(openLog(db, path));
+        CHECK(execute("CREATE TABLE c (id INT, k INT, s STRING, d DOUBLE, b BOOLEAN)"));
+        std::string sql = "INSERT INTO c VALUES ";
+        for (int id = 0; id < 40000; ++id) {
+            std::string k = id % 7 ? std::to_string(id / 100) : "NULL";
+            std::string s = id % 11 ? "'v" + std::to_string(id % 50) + "'" : "NULL";
+            std::string d = id % 13 ? std::to_string(id) + ".5" : "NULL";
+            std::string b = id % 17 ? (id % 3 ? "TRUE" : "FALSE") : "NULL";
+            sql += (id ? ", (" : "(") + std::to_string(id) + ", " + k + ", " + s + ", " + d + ", " + b + ")";
+        }
+        CHECK(execute(sql));
+        CHECK(execute("DELETE FROM c WHERE id < 300 OR (id > 20000 AND id < 21000)"));
+        for (const std::string& sql : queries) {
+            expected.push_back(query(sql));
+        }
+        CHECK(expected[0].size() == 40000 - 300 - 999);
+        CHECK(execute("CHECKPOINT"));
+    }
+    Database db;
+    CHECK(openLog(db, path));
+    for (size_t i = 0; i < queries.size(); ++i) {
+        CHECK(query(queries[i]) == expected[i]);
+    }
+}
+
+}
+
+int main() {
+    char directory[] = "/tmp/imdb_recoveryXXXXXX";
+    if (!::mkdtemp(directory)) {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    g_directory = directory;
+    testReplay();
+    testTornRecord();
+    testCheckpoint();
+    testFailedCheckpoint();
+    testSnapshotColumns();
+    std::system(("rm -rf " + g_directory).c_str());
+    return report("recovery");
+}
@@ -0,0 +1,67 @@
+#include "test_support.h"
+#include "globals.h"
+#include "cursor.h"
+#include "prepared_statement.h"
+#include <iostream>
+
+namespace InMemoryDB {
+
+StorageEngine* g_storage_engine = nullptr;
+
+namespace Test {
+
+namespace {
+
+int g_checks = 0;
+int g_failures = 0;
+
+}
+
+void check(bool condition, const char* text, const char* file, int line) {
+    g_checks++;
+    if (!condition) {
+        g_failures++;
+        std::cerr << file << ":" << line << ": check failed: " << text << std::endl;
+    }
+}
+
+int report(const char* name) {
+    std::cout << name << ": " << g_checks - g_failures << " of " << g_checks << " checks passed" << std::endl;
+    return g_failures ? 1 : 0;
+}
+
+Database::Database() {
+    g_storage_engine = &engine_;
+}
+
+Database::~Database() {
+    g_storage_engine = nullptr;
+}
+
+std::vector<Row> query(const std::string& sql) {
+    QueryResult result = executeSql(sql);
+    if (!result.success) {
+        std::cerr << sql << ": " << result.error_message << std::endl;
+    }
+    check(result.success, sql.c_str(), __FILE__, __LINE__);
+    if (!result.cursor) {
+        return result.rows;
+    }
+    std::vector<Row> rows;
+    RowBatch batch;
+    while (result.cursor->next(batch)) {
+        rows.insert(rows.end(), batch.rows.begin(), batch.rows.begin() + batch.size);
+    }
+    return rows;
+}
+
+bool execute(const std::string& sql, std::string* error) {
+    QueryResult result = executeSql(sql);
+    if (error) {
+        *error = result.error_message;
+    }
+    return result.success;
+}
+
+}
+}
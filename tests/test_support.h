@@ -0,0 +1,42 @@
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include "storage_engine.h"
+#include "types.h"
+#include <string>
+#include <vector>
+
+namespace InMemoryDB {
+namespace Test {
+
+// Records a failure, with where it happened, unless condition holds
+#define CHECK(condition) InMemoryDB::Test::check((condition), #condition, __FILE__, __LINE__)
+void check(bool condition, const char* text, const char* file, int line);
+
+// Prints how many checks failed; the exit status of a test's main
+int report(const char* name);
+
+// A fresh engine that the SQL helpers below run against while in scope
+class Database {
+private:
+    StorageEngine engine_;
+
+public:
+    Database();
+    ~Database();
+    Database(const Database&) = delete;
+    Database& operator=(const Database&) = delete;
+
+    StorageEngine& engine() { return engine_; }
+};
+
+// Runs sql, which must succeed, and returns its rows, draining any cursor
+std::vector<Row> query(const std::string& sql);
+
+// Runs sql; false, with the error in error if given, if it failed
+bool execute(const std::string& sql, std::string* error = nullptr);
+
+}
+}
+
+#endif
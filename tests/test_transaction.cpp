@@ -0,0 +1,155 @@
+#include "test_support.h"
+#include "session.h"
+#include <chrono>
+#include <thread>
+
+using namespace InMemoryDB;
+using namespace InMemoryDB::Test;
+
+namespace {
+
+// One client of several played on this thread: its statements run with
+// its transaction, if it has begun one, as the session's
+class Client {
+private:
+    std::shared_ptr<Transaction> transaction_;
+
+    template <typename F>
+    auto run(F statement) {
+        std::swap(Session::current().transaction, transaction_);
+        auto result = statement();
+        std::swap(Session::current().transaction, transaction_);
+        return result;
+    }
+
+public:
+    bool execute(const std::string& sql, std::string* error = nullptr) {
+        return run([&] { return Test::execute(sql, error); });
+    }
+    std::vector<Row> query(const std::string& sql) {
+        return run([&] { return Test::query(sql); });
+    }
+    Value value(const std::string& sql) {
+        std::vector<Row> rows = query(sql);
+        return rows.size() == 1 && rows[0].size() == 1 ? rows[0][0] : Value("no single value");
+    }
+};
+
+void setUp() {
+    CHECK(execute("CREATE TABLE a (id INT, v INT)"));
+    CHECK(execute("INSERT INTO a VALUES (1, 10), (2, 20), (3, 30)"));
+}
+
+// A transaction reads the snapshot it began with, plus its own writes;
+// nobody else sees those before it commits
+void testSnapshotIsolation() {
+    Database db;
+    setUp();
+    Client reader, writer;
+    CHECK(reader.execute("BEGIN"));
+    CHECK(reader.query("SELECT * FROM a").size() == 3);
+
+    CHECK(writer.execute("BEGIN"));
+    CHECK(writer.execute("INSERT INTO a VALUES (4, 40)"));
+    CHECK(writer.execute("UPDATE a SET v = 11 WHERE id = 1"));
+    CHECK(writer.execute("DELETE FROM a WHERE id = 2"));
+    CHECK(writer.query("SELECT * FROM a").size() == 3);
+    CHECK(writer.value("SELECT v FROM a WHERE id = 1") == Value(int64_t(11)));
+    CHECK(query("SELECT * FROM a WHERE id = 4").empty());
+    CHECK(query("SELECT v FROM a WHERE id = 1")[0][0] == Value(int64_t(10)));
+    CHECK(writer.execute("COMMIT"));
+
+    CHECK(reader.query("SELECT * FROM a").size() == 3);
+    CHECK(reader.value("SELECT v FROM a WHERE id = 1") == Value(int64_t(10)));
+    CHECK(reader.value("SELECT COUNT(*) FROM a WHERE id = 2") == Value(int64_t(1)));
+    CHECK(reader.execute("COMMIT"));
+    CHECK(reader.value("SELECT v FROM a WHERE id = 1") == Value(int64_t(11)));
+    CHECK(reader.value("SELECT COUNT(*) FROM a") == Value(int64_t(3)));
+}
+
+void testRollback() {
+    Database db;
+    setUp();
+    Client client;
+    CHECK(client.execute("BEGIN"));
+    CHECK(client.execute("INSERT INTO a VALUES (4, 40)"));
+    CHECK(client.execute("UPDATE a SET v = 0"));
+    CHECK(client.execute("DELETE FROM a WHERE id = 3"));
+    CHECK(client.execute("ROLLBACK"));
+    CHECK(query("SELECT * FROM a").size() == 3);
+    CHECK(query("SELECT * FROM a WHERE v = 0").empty());
+    CHECK(query("SELECT * FROM a WHERE id = 3").size() == 1);
+}
+
+// Two writers of one row: the first wins, the second is doomed and can
+// only roll back, whether the first has committed yet or not
+void testWriteConflicts() {
+    Database db;
+    setUp();
+    Client first, second;
+    std::string error;
+
+    CHECK(first.execute("BEGIN"));
+    CHECK(second.execute("BEGIN"));
+    CHECK(first.execute("UPDATE a SET v = 100 WHERE id = 1"));
+    CHECK(!second.execute("UPDATE a SET v = 200 WHERE id = 1", &error));
+    CHECK(error.find("conflict") != std::string::npos);
+    CHECK(!second.execute("UPDATE a SET v = 300 WHERE id = 2", &error));
+    CHECK(error.find("ROLLBACK required") != std::string::npos);
+    CHECK(!second.execute("COMMIT", &error));
+    CHECK(first.execute("COMMIT"));
+    CHECK(query("SELECT v FROM a WHERE id = 1")[0][0] == Value(int64_t(100)));
+    CHECK(query("SELECT v FROM a WHERE id = 2")[0][0] == Value(int64_t(20)));
+
+    // The row changed after this snapshot was taken
+    CHECK(second.execute("BEGIN"));
+    CHECK(first.execute("DELETE FROM a WHERE id = 3"));
+    CHECK(!second.execute("DELETE FROM a WHERE id = 3"));
+    CHECK(second.execute("ROLLBACK"));
+
+    // Rows the other writer did not touch do not conflict
+    CHECK(first.execute("BEGIN"));
+    CHECK(second.execute("BEGIN"));
+    CHECK(first.execute("UPDATE a SET v = 1 WHERE id = 1"));
+    CHECK(second.execute("UPDATE a SET v = 2 WHERE id = 2"));
+    CHECK(first.execute("COMMIT"));
+    CHECK(second.execute("COMMIT"));
+    CHECK(query("SELECT v FROM a WHERE id = 2")[0][0] == Value(int64_t(2)));
+}
+
+// Garbage collection keeps the versions a running transaction can see
+void testGarbageCollection() {
+    Database db;
+    setUp();
+    Client reader;
+    CHECK(reader.execute("BEGIN"));
+    CHECK(reader.query("SELECT * FROM a").size() == 3);
+    for (int i = 0; i < 5; ++i) {
+        CHECK(execute("UPDATE a SET v = " + std::to_string(i) + " WHERE id = 1"));
+    }
+    CHECK(execute("DELETE FROM a WHERE id = 2"));
+
+    db.engine().setCompactionThreshold(0.01);
+    db.engine().wakeCompactor();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    CHECK(reader.value("SELECT v FROM a WHERE id = 1") == Value(int64_t(10)));
+    CHECK(reader.value("SELECT v FROM a WHERE id = 2") == Value(int64_t(20)));
+    CHECK(reader.execute("COMMIT"));
+
+    // Once no transaction can see them, the old versions go
+    db.engine().wakeCompactor();
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    CHECK(db.engine().getTable("a")->deadRatio() == 0);
+    CHECK(query("SELECT * FROM a").size() == 2);
+    CHECK(query("SELECT v FROM a WHERE id = 1")[0][0] == Value(int64_t(4)));
+}
+
+}
+
+int main() {
+    testSnapshotIsolation();
+    testRollback();
+    testWriteConflicts();
+    testGarbageCollection();
+    return report("transaction");
+}
@@ -0,0 +1,139 @@
+#include "test_support.h"
+#include <functional>
+#include <optional>
+
+using namespace InMemoryDB;
+using namespace InMemoryDB::Test;
+
+namespace {
+
+// Six full storage blocks. id is sorted and a is not; r has long runs; n
+// is NULL for all of blocks 2 and 3; s repeats within a block and p
+// hardly repeats at all.
+constexpr int kBlock = 16384;
+constexpr int kRows = 6 * kBlock;
+
+int aOf(int id) { return id * 7919 % 100003; }
+int rOf(int id) { return id / 1000; }
+std::optional<int> nOf(int id) {
+    return id >= 2 * kBlock && id < 4 * kBlock ? std::optional<int>() : std::optional<int>(id % 500);
+}
+std::string sOf(int id) { return "v" + std::to_string(id / 100 % 50); }
+std::string pOf(int id) { return "p" + std::to_string(aOf(id)); }
+double dOf(int id) { return id + 0.5; }
+
+void load() {
+    CHECK(execute("CREATE TABLE z (id INT, a INT, r INT, n INT, s STRING, p STRING, d DOUBLE)"));
+    for (int first = 0; first < kRows; first += kBlock) {
+        std::string sql = "INSERT INTO z VALUES ";
+        for (int id = first; id < first + kBlock; ++id) {
+            std::string n = nOf(id) ? std::to_string(*nOf(id)) : "NULL";
+            sql += (id > first ? ", (" : "(") + std::to_string(id) + ", " + std::to_string(aOf(id)) + ", " +
+                   std::to_string(rOf(id)) + ", " + n + ", '" + sOf(id) + "', '" + pOf(id) + "', " +
+                   std::to_string(id) + ".5)";
+        }
+        CHECK(execute(sql));
+    }
+}
+
+std::string storage(const std::string& column) {
+    for (const Row& row : query("SHOW STORAGE z")) {
+        if (row[0] == Value(column)) return std::string(row[1].asString());
+    }
+    return "";
+}
+
+std::vector<int> ids(const std::string& where) {
+    std::vector<int> result;
+    for (const Row& row : query("SELECT id FROM z WHERE " + where + " ORDER BY id")) {
+        result.push_back(static_cast<int>(row[0].asInt()));
+    }
+    return result;
+}
+
+// What a scan of every row finds, with ids below rows
+std::vector<int> expected(const std::function<bool(int)>& where, int rows) {
+    std::vector<int> result;
+    for (int id = 0; id < rows; ++id) {
+        if (where(id)) result.push_back(id);
+    }
+    return result;
+}
+
+struct Case {
+    std::string where;
+    std::function<bool(int)> matches;
+};
+
+void checkCases(const std::vector<Case>& cases, int rows = kRows) {
+    for (const Case& c : cases) {
+        CHECK(ids(c.where) == expected(c.matches, rows));
+    }
+}
+
+// Range predicates that rule out some blocks, all of them or none
+void testRanges() {
+    Database db;
+    load();
+    CHECK(storage("id") == "BITPACK x6");
+    CHECK(storage("a") == "BITPACK x6");
+    CHECK(storage("r") == "RLE x6");
+    CHECK(storage("n") == "BITPACK x6");
+    CHECK(storage("s") == "DICTIONARY x6");
+    CHECK(storage("p") == "PLAIN x6");
+
+    checkCases({
+        {"id < 100", [](int id) { return id < 100; }},
+        {"id >= 40000 AND id <= 40010", [](int id) { return id >= 40000 && id <= 40010; }},
+        {"id BETWEEN 16383 AND 16384", [](int id) { return id == 16383 || id == 16384; }},
+        {"id < 3 OR id > 98300", [](int id) { return id < 3 || id > 98300; }},
+        {"id > 98303", [](int) { return false; }},
+        {"NOT id > 3", [](int id) { return id <= 3; }},
+        {"a < 50", [](int id) { return aOf(id) < 50; }},
+        {"a BETWEEN 1000 AND 1100", [](int id) { return aOf(id) >= 1000 && aOf(id) <= 1100; }},
+        {"a > 100002", [](int) { return false; }},
+        {"r = 50", [](int id) { return rOf(id) == 50; }},
+        {"r > 95 AND id > 97000", [](int id) { return rOf(id) > 95 && id > 97000; }},
+        {"r <> 0 AND r < 2", [](int id) { return rOf(id) == 1; }},
+        {"n > 450", [](int id) { return nOf(id) && *nOf(id) > 450; }},
+        {"n = 7 AND id > 30000", [](int id) { return nOf(id) == 7 && id > 30000; }},
+        {"n < 0", [](int) { return false; }},
+        {"NOT n > 5", [](int id) { return nOf(id) && *nOf(id) <= 5; }},
+        {"n <> 3 AND id BETWEEN 32000 AND 33000",
+         [](int id) { return nOf(id) && *nOf(id) != 3 && id >= 32000 && id <= 33000; }},
+        {"s = 'v7'", [](int id) { return sOf(id) == "v7"; }},
+        {"s > 'v47'", [](int id) { return sOf(id) > "v47"; }},
+        {"s < 'v0'", [](int) { return false; }},
+        {"p = 'p7919'", [](int id) { return pOf(id) == "p7919"; }},
+        {"p >= 'p99990'", [](int id) { return pOf(id) >= "p99990"; }},
+        {"d > 98000", [](int id) { return dOf(id) > 98000; }},
+        {"d BETWEEN 100 AND 200 OR d < 1", [](int id) { return (dOf(id) >= 100 && dOf(id) <= 200) || dOf(id) < 1; }},
+    });
+}
+
+// Writes widen a block's bounds, and zone maps keep up with them
+void testWrites() {
+    Database db;
+    load();
+    CHECK(execute("UPDATE z SET a = -5, n = 1000, s = 'a' WHERE id = 20000"));
+    CHECK(execute("UPDATE z SET n = 600 WHERE id = 40000"));
+    CHECK(execute("INSERT INTO z VALUES (98304, 0, 0, NULL, 'zz', 'p', 0.5)"));
+    CHECK(execute("DELETE FROM z WHERE id = 7"));
+    checkCases({
+        {"a < 0", [](int id) { return id == 20000; }},
+        {"n > 499", [](int id) { return id == 20000 || id == 40000; }},
+        {"n = 600", [](int id) { return id == 40000; }},
+        {"s < 'b'", [](int id) { return id == 20000; }},
+        {"s >= 'zz'", [](int id) { return id == 98304; }},
+        {"r = 0 AND id < 10", [](int id) { return id < 10 && id != 7; }},
+        {"id > 98303", [](int id) { return id == 98304; }},
+    }, kRows + 1);
+}
+
+}
+
+int main() {
+    testRanges();
+    testWrites();
+    return report("zonemap");
+}